@@ -0,0 +1,422 @@
+/** @file
+    @brief Microbenchmarks for the CPU-side hot paths of RenderManager:
+           distortion mesh construction, unstructured-mesh interpolation,
+           model-view and render-info construction, prediction, time warp
+           and display-descriptor parsing.
+
+    @date 2016
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com/osvr>
+*/
+
+// Copyright 2016 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include <osvr/RenderKit/RenderManager.h>
+#include <osvr/RenderKit/RenderManagerSoftware.h>
+#include <osvr/RenderKit/PoseSource.h>
+
+// Library/third-party includes
+#include <benchmark/benchmark.h>
+
+// Standard includes
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace osvr::renderkit;
+
+static const double pi = 3.14159265358979323846;
+
+// Display descriptors to run against.  Both describe a 1920x1080
+// side-by-side HMD; one uses polynomial distortion and the other the
+// built-in OSVR HDK 1.3 point-sample mesh.
+static const char* polynomialDisplay = R"({
+  "hmd": {
+    "device": { "vendor": "OSVR", "model": "HDK", "Version": "1.3" },
+    "field_of_view": {
+      "monocular_horizontal": 90, "monocular_vertical": 101.25,
+      "overlap_percent": 100, "pitch_tilt": 0
+    },
+    "resolutions": [ {
+      "width": 1920, "height": 1080, "video_inputs": 1,
+      "display_mode": "horz_side_by_side", "swap_eyes": 0
+    } ],
+    "distortion": {
+      "distance_scale_x": 1, "distance_scale_y": 1,
+      "polynomial_coeffs_red": [ 0, 1, -1.74, 5.15, -1.27, -2.23 ],
+      "polynomial_coeffs_green": [ 0, 1, -1.40, 4.10, -0.90, -1.90 ],
+      "polynomial_coeffs_blue": [ 0, 1, -1.00, 3.00, -0.50, -1.50 ]
+    },
+    "rendering": { "right_roll": 0, "left_roll": 0 },
+    "eyes": [
+      { "center_proj_x": 0.5, "center_proj_y": 0.5, "rotate_180": 0 },
+      { "center_proj_x": 0.5, "center_proj_y": 0.5, "rotate_180": 0 }
+    ]
+  }
+})";
+
+static const char* pointSampleDisplay = R"({
+  "hmd": {
+    "device": { "vendor": "OSVR", "model": "HDK", "Version": "1.3" },
+    "field_of_view": {
+      "monocular_horizontal": 90, "monocular_vertical": 101.25,
+      "overlap_percent": 100, "pitch_tilt": 0
+    },
+    "resolutions": [ {
+      "width": 1920, "height": 1080, "video_inputs": 1,
+      "display_mode": "horz_side_by_side", "swap_eyes": 0
+    } ],
+    "distortion": {
+      "type": "mono_point_samples",
+      "mono_point_samples_built_in": "OSVR_HDK_13_V1"
+    },
+    "rendering": { "right_roll": 0, "left_roll": 0 },
+    "eyes": [
+      { "center_proj_x": 0.5, "center_proj_y": 0.5, "rotate_180": 0 },
+      { "center_proj_x": 0.5, "center_proj_y": 0.5, "rotate_180": 0 }
+    ]
+  }
+})";
+
+/// Stream buffer that throws away everything written to it, used to keep
+/// the display-descriptor parser's progress messages out of the results.
+class NullBuffer : public std::streambuf {
+  protected:
+    int overflow(int c) override { return c; }
+};
+
+/// Redirects std::cout to nowhere for as long as it exists.
+class SilenceCout {
+  public:
+    SilenceCout() : m_saved(std::cout.rdbuf(&m_null)) {}
+    ~SilenceCout() { std::cout.rdbuf(m_saved); }
+
+  private:
+    NullBuffer m_null;
+    std::streambuf* m_saved;
+};
+
+/// Kinds of distortion the benchmarks run with.
+typedef enum {
+    PolynomialDistortion,
+    MonoPointDistortion,
+    RGBPointDistortion
+} DistortionKind;
+
+/// @brief Software RenderManager that exposes the internals being timed.
+class BenchmarkRenderManager : public RenderManagerSoftware {
+  public:
+    BenchmarkRenderManager(ConstructorParameters p)
+        : RenderManagerSoftware(nullptr, p) {}
+
+    using RenderManager::DistortionMesh;
+    using RenderManager::UnstructuredMeshInterpolator;
+    using RenderManager::ComputeDistortionMeshIndexed;
+    using RenderManager::ComputeAsynchronousTimeWarps;
+    using RenderManager::ConstructModelView;
+    using RenderManager::GetRenderInfoInternal;
+    using RenderManager::PredictFuturePose;
+
+    const ConstructorParameters& params() const { return m_params; }
+};
+
+/// Makes an orientation that is yawed by the specified angle.
+static OSVR_Quaternion yaw(double radians) {
+    OSVR_Quaternion q;
+    osvrQuatSetW(&q, std::cos(radians / 2));
+    osvrQuatSetX(&q, 0);
+    osvrQuatSetY(&q, std::sin(radians / 2));
+    osvrQuatSetZ(&q, 0);
+    return q;
+}
+
+/// Builds a pose source holding two seconds of a head turning at 90
+/// degrees per second and swaying side to side, reported at 1 kHz, with
+/// the clock set to the middle of it.
+static std::shared_ptr<ScriptedPoseSource> makePoseSource() {
+    std::shared_ptr<ScriptedPoseSource> source(new ScriptedPoseSource);
+    const double rate = 1000;
+    for (int i = 0; i < 2000; i++) {
+        double t = i / rate;
+        OSVR_TimeValue time;
+        time.seconds = static_cast<OSVR_TimeValue_Seconds>(i / 1000);
+        time.microseconds =
+            static_cast<OSVR_TimeValue_Microseconds>((i % 1000) * 1000);
+        OSVR_PoseState pose;
+        pose.translation.data[0] = 0.05 * std::sin(2 * t);
+        pose.translation.data[1] = 1.7;
+        pose.translation.data[2] = 0;
+        pose.rotation = yaw(t * pi / 2);
+        source->AddPose("/me/head", time, pose);
+    }
+    OSVR_TimeValue now = {1, 0};
+    source->SetTime(now);
+    source->Update();
+    return source;
+}
+
+/// Fills in the constructor parameters the way createRenderManager() does
+/// for the given kind of distortion.  The RGB point samples are made from
+/// the mono ones by scaling each color slightly about the center.
+static RenderManager::ConstructorParameters
+makeParameters(DistortionKind kind, std::shared_ptr<PoseSource> source) {
+    RenderManager::ConstructorParameters p;
+    p.m_renderLibrary = "Software";
+    p.m_poseSource = source;
+    p.m_distortionCorrection = true;
+    p.m_clientPredictionEnabled = true;
+    p.m_eyeDelaysMS = {8.0f, 8.0f};
+    {
+        SilenceCout quiet;
+        p.m_displayConfiguration = OSVRDisplayConfiguration(
+            kind == PolynomialDistortion ? polynomialDisplay
+                                         : pointSampleDisplay);
+    }
+    const OSVRDisplayConfiguration& d = p.m_displayConfiguration;
+    size_t numEyes = d.getEyes().size();
+
+    RenderManager::DistortionParameters distortion;
+    distortion.m_desiredTriangles = 200 * 64;
+    switch (kind) {
+    case PolynomialDistortion:
+        distortion.m_type = RenderManager::DistortionParameters::Type::
+            rgb_symmetric_polynomials;
+        distortion.m_distortionD = {d.getDistortionDistanceScaleX(),
+                                    d.getDistortionDistanceScaleY()};
+        distortion.m_distortionPolynomialRed = d.getDistortionPolynomalRed();
+        distortion.m_distortionPolynomialGreen =
+            d.getDistortionPolynomalGreen();
+        distortion.m_distortionPolynomialBlue = d.getDistortionPolynomalBlue();
+        for (size_t i = 0; i < numEyes; i++) {
+            distortion.m_distortionCOP = {
+                static_cast<float>(d.getEyes()[i].m_CenterProjX),
+                static_cast<float>(d.getEyes()[i].m_CenterProjY)};
+            p.m_distortionParameters.push_back(distortion);
+        }
+        break;
+    case MonoPointDistortion:
+        distortion.m_type =
+            RenderManager::DistortionParameters::Type::mono_point_samples;
+        distortion.m_monoPointSamples = d.getDistortionMonoPointMeshes();
+        p.m_distortionParameters.assign(numEyes, distortion);
+        break;
+    case RGBPointDistortion:
+        distortion.m_type =
+            RenderManager::DistortionParameters::Type::rgb_point_samples;
+        for (size_t color = 0; color < 3; color++) {
+            double scale = 1.0 + 0.01 * (static_cast<double>(color) - 1);
+            distortion.m_rgbPointSamples[color] =
+                d.getDistortionMonoPointMeshes();
+            for (auto& eye : distortion.m_rgbPointSamples[color]) {
+                for (auto& point : eye) {
+                    for (size_t i = 0; i < 2; i++) {
+                        point[1][i] = 0.5 + (point[1][i] - 0.5) * scale;
+                    }
+                }
+            }
+        }
+        p.m_distortionParameters.assign(numEyes, distortion);
+        break;
+    }
+    return p;
+}
+
+//=========================================================================
+// Distortion meshes.
+
+static void BM_ComputeDistortionMesh(benchmark::State& state,
+                                     DistortionKind kind,
+                                     RenderManager::DistortionMeshType type) {
+    BenchmarkRenderManager rm(makeParameters(kind, makePoseSource()));
+    const RenderManager::DistortionParameters& distort =
+        rm.params().m_distortionParameters[0];
+    size_t triangles = 0;
+    for (auto _ : state) {
+        BenchmarkRenderManager::DistortionMesh mesh =
+            rm.ComputeDistortionMeshIndexed(0, type, distort, false);
+        triangles = mesh.m_indices.size() / 3;
+        benchmark::DoNotOptimize(mesh);
+    }
+    state.counters["triangles"] = static_cast<double>(triangles);
+}
+BENCHMARK_CAPTURE(BM_ComputeDistortionMesh, polynomial_square,
+                  PolynomialDistortion, RenderManager::SQUARE)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_ComputeDistortionMesh, polynomial_radial,
+                  PolynomialDistortion, RenderManager::RADIAL)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_ComputeDistortionMesh, mono_point_square,
+                  MonoPointDistortion, RenderManager::SQUARE)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_ComputeDistortionMesh, rgb_point_square,
+                  RGBPointDistortion, RenderManager::SQUARE)
+    ->Unit(benchmark::kMillisecond);
+
+//=========================================================================
+// Unstructured-mesh interpolation.
+
+static MonoPointDistortionMeshDescription hdkMesh() {
+    SilenceCout quiet;
+    OSVRDisplayConfiguration d(pointSampleDisplay);
+    return d.getDistortionMonoPointMeshes()[0];
+}
+
+static void BM_UnstructuredMeshInterpolatorConstruct(benchmark::State& state) {
+    MonoPointDistortionMeshDescription points = hdkMesh();
+    for (auto _ : state) {
+        BenchmarkRenderManager::UnstructuredMeshInterpolator interp(points);
+        benchmark::DoNotOptimize(&interp);
+    }
+    state.counters["points"] = static_cast<double>(points.size());
+}
+BENCHMARK(BM_UnstructuredMeshInterpolatorConstruct)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_UnstructuredMeshInterpolatorQuery(benchmark::State& state) {
+    BenchmarkRenderManager::UnstructuredMeshInterpolator interp(hdkMesh());
+
+    // The same pseudo-random coordinates on every run.
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<Float2> queries(4096);
+    for (auto& q : queries) {
+        q = {unit(rng), unit(rng)};
+    }
+
+    size_t i = 0;
+    for (auto _ : state) {
+        const Float2& q = queries[i++ % queries.size()];
+        benchmark::DoNotOptimize(interp.interpolateNearestPoints(q[0], q[1]));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_UnstructuredMeshInterpolatorQuery);
+
+//=========================================================================
+// Poses, render info and time warp.
+
+static void BM_PredictFuturePose(benchmark::State& state) {
+    // Head turning at 90 degrees per second, reported as the rotation over
+    // one millisecond, predicted ahead the number of ms in the argument.
+    double dt = 1e-3;
+    OSVR_VelocityState vel;
+    vel.linearVelocityValid = true;
+    vel.linearVelocity.data[0] = 0.1;
+    vel.linearVelocity.data[1] = 0;
+    vel.linearVelocity.data[2] = 0;
+    vel.angularVelocityValid = true;
+    vel.angularVelocity.incrementalRotation = yaw(dt * pi / 2);
+    vel.angularVelocity.dt = dt;
+
+    OSVR_PoseState pose;
+    osvrPose3SetIdentity(&pose);
+    double interval = state.range(0) / 1e3;
+    for (auto _ : state) {
+        OSVR_PoseState predicted;
+        BenchmarkRenderManager::PredictFuturePose(pose, vel, interval,
+                                                  predicted);
+        benchmark::DoNotOptimize(predicted);
+    }
+}
+BENCHMARK(BM_PredictFuturePose)->Arg(5)->Arg(20)->Arg(50);
+
+static void BM_ConstructModelView(benchmark::State& state) {
+    BenchmarkRenderManager rm(
+        makeParameters(PolynomialDistortion, makePoseSource()));
+    RenderManager::RenderParams params;
+    for (auto _ : state) {
+        OSVR_PoseState eyeFromSpace;
+        rm.ConstructModelView(0, 0, params, eyeFromSpace);
+        benchmark::DoNotOptimize(eyeFromSpace);
+    }
+}
+BENCHMARK(BM_ConstructModelView);
+
+static void BM_GetRenderInfoInternal(benchmark::State& state) {
+    BenchmarkRenderManager rm(
+        makeParameters(PolynomialDistortion, makePoseSource()));
+    RenderManager::RenderParams params;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(rm.GetRenderInfoInternal(params));
+    }
+}
+BENCHMARK(BM_GetRenderInfoInternal);
+
+static void BM_ComputeAsynchronousTimeWarps(benchmark::State& state) {
+    std::shared_ptr<ScriptedPoseSource> source = makePoseSource();
+    BenchmarkRenderManager rm(makeParameters(PolynomialDistortion, source));
+
+    // Render info from when the frame was rendered and from one 90 Hz
+    // frame later, when it is being presented.
+    RenderManager::RenderParams params;
+    std::vector<RenderInfo> used = rm.GetRenderInfoInternal(params);
+    source->AdvanceTime(1.0 / 90);
+    std::vector<RenderInfo> current = rm.GetRenderInfoInternal(params);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            rm.ComputeAsynchronousTimeWarps(used, current));
+    }
+}
+BENCHMARK(BM_ComputeAsynchronousTimeWarps);
+
+//=========================================================================
+// Display descriptor parsing.
+
+static void BM_DisplayConfigurationParse(benchmark::State& state,
+                                         const char* descriptor) {
+    SilenceCout quiet;
+    std::string json(descriptor);
+    for (auto _ : state) {
+        OSVRDisplayConfiguration d(json);
+        benchmark::DoNotOptimize(&d);
+    }
+}
+BENCHMARK_CAPTURE(BM_DisplayConfigurationParse, polynomial, polynomialDisplay);
+BENCHMARK_CAPTURE(BM_DisplayConfigurationParse, built_in_point_samples,
+                  pointSampleDisplay)
+    ->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv) {
+    // Unless told to put them somewhere else, write the results as JSON
+    // next to the program so that runs can be compared across releases.
+    std::vector<char*> args(argv, argv + argc);
+    bool haveOut = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strncmp(argv[i], "--benchmark_out=", 16) == 0) {
+            haveOut = true;
+        }
+    }
+    std::string out = "--benchmark_out=RenderManagerBenchmarks.json";
+    std::string format = "--benchmark_out_format=json";
+    if (!haveOut) {
+        args.push_back(&out[0]);
+        args.push_back(&format[0]);
+    }
+    int count = static_cast<int>(args.size());
+    benchmark::Initialize(&count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(count, args.data())) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
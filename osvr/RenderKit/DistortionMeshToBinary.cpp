@@ -0,0 +1,198 @@
+/** @file
+    @brief Converts the point-sample distortion meshes in a JSON display
+    configuration (or external mesh file) into the packed binary format
+    described in PointMeshBinaryFormat.h, or into a C header that embeds it.
+
+    @date 2016
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com/osvr>
+*/
+
+// Copyright 2016 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include "PointMeshBinaryFormat.h"
+
+// Library/third-party includes
+#include <json/reader.h>
+#include <json/value.h>
+
+// Standard includes
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using osvr::renderkit::MonoPointDistortionMeshDescription;
+using osvr::renderkit::MonoPointDistortionMeshDescriptions;
+using osvr::renderkit::RGBPointDistortionMeshDescriptions;
+
+static void Usage(const char* name) {
+    std::cerr << "Usage: " << name
+              << " [--header ARRAY_NAME] input.json output" << std::endl;
+    std::cerr << "  Reads the mono_point_samples or the red/green/blue"
+              << std::endl;
+    std::cerr << "  _point_samples from the display/hmd/distortion section"
+              << std::endl;
+    std::cerr << "  of the input and" << std::endl;
+    std::cerr << "  writes them in binary form.  With --header, writes a C"
+              << std::endl;
+    std::cerr << "  header that defines ARRAY_NAME as the binary data."
+              << std::endl;
+}
+
+/// Reads one list of per-eye meshes from JSON.
+static bool parseEyeMeshes(Json::Value const& eyeArray,
+                           MonoPointDistortionMeshDescriptions& meshOut) {
+    meshOut.clear();
+    for (auto& pointArray : eyeArray) {
+        MonoPointDistortionMeshDescription eye;
+        for (auto& elt : pointArray) {
+            if ((elt.size() != 2) || (elt[0].size() != 2) ||
+                (elt[1].size() != 2)) {
+                std::cerr << "Malformed point-sample entry" << std::endl;
+                return false;
+            }
+            MonoPointDistortionMeshDescription::value_type point;
+            point[0][0] = elt[0][0].asDouble();
+            point[0][1] = elt[0][1].asDouble();
+            point[1][0] = elt[1][0].asDouble();
+            point[1][1] = elt[1][1].asDouble();
+            eye.push_back(point);
+        }
+        meshOut.push_back(eye);
+    }
+    return true;
+}
+
+/// Writes the data as a C array definition, in the same style as the
+/// other built-in distortion headers.
+static bool writeHeader(std::ostream& out, std::string const& arrayName,
+                        std::string const& data) {
+    out << "static const unsigned char " << arrayName << "[] = {";
+    for (size_t i = 0; i < data.size(); i++) {
+        if (i % 12 == 0) {
+            out << "\n ";
+        }
+        char hex[8];
+        sprintf(hex, " 0x%02x",
+                static_cast<unsigned>(static_cast<unsigned char>(data[i])));
+        out << hex;
+        if (i + 1 < data.size()) {
+            out << ",";
+        }
+    }
+    out << "\n};\n";
+    return static_cast<bool>(out);
+}
+
+int main(int argc, char* argv[]) {
+    std::string arrayName;
+    std::string inName, outName;
+    int realParams = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--header") == 0) {
+            if (++i >= argc) {
+                Usage(argv[0]);
+                return 1;
+            }
+            arrayName = argv[i];
+        } else if (argv[i][0] == '-') {
+            Usage(argv[0]);
+            return 1;
+        } else {
+            switch (++realParams) {
+            case 1:
+                inName = argv[i];
+                break;
+            case 2:
+                outName = argv[i];
+                break;
+            default:
+                Usage(argv[0]);
+                return 1;
+            }
+        }
+    }
+    if (realParams != 2) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    // Read the JSON and find the distortion section.
+    std::ifstream in(inName.c_str());
+    if (!in.is_open()) {
+        std::cerr << "Could not open " << inName << std::endl;
+        return 2;
+    }
+    Json::Value root;
+    Json::Reader reader;
+    if (!reader.parse(in, root)) {
+        std::cerr << "Could not parse " << inName << ": "
+                  << reader.getFormattedErrorMessages() << std::endl;
+        return 2;
+    }
+    Json::Value const& distortion = root["display"]["hmd"]["distortion"];
+
+    // Encode whichever kind of mesh is present.
+    std::ostringstream binary;
+    if (distortion.isMember("mono_point_samples")) {
+        MonoPointDistortionMeshDescriptions mesh;
+        if (!parseEyeMeshes(distortion["mono_point_samples"], mesh) ||
+            !osvr::renderkit::writeMonoPointMeshBinary(binary, mesh)) {
+            return 3;
+        }
+    } else if (distortion.isMember("red_point_samples")) {
+        const char* names[] = {"red_point_samples", "green_point_samples",
+                               "blue_point_samples"};
+        RGBPointDistortionMeshDescriptions mesh;
+        for (size_t clr = 0; clr < 3; clr++) {
+            if (!parseEyeMeshes(distortion[names[clr]], mesh[clr])) {
+                return 3;
+            }
+        }
+        if (!osvr::renderkit::writeRGBPointMeshBinary(binary, mesh)) {
+            return 3;
+        }
+    } else {
+        std::cerr << "No point-sample meshes found in " << inName
+                  << std::endl;
+        return 3;
+    }
+
+    // Write the output.
+    std::ofstream out(outName.c_str(), arrayName.empty()
+                                           ? std::ios::out | std::ios::binary
+                                           : std::ios::out);
+    if (!out.is_open()) {
+        std::cerr << "Could not open " << outName << " for writing"
+                  << std::endl;
+        return 4;
+    }
+    if (arrayName.empty()) {
+        out << binary.str();
+    } else {
+        writeHeader(out, arrayName, binary.str());
+    }
+    if (!out) {
+        std::cerr << "Could not write " << outName << std::endl;
+        return 4;
+    }
+    return 0;
+}
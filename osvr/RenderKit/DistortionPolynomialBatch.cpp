@@ -0,0 +1,311 @@
+/** @file
+    @brief Implementation of batched rgb_symmetric_polynomials distortion.
+
+    @date 2016
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com/osvr>
+*/
+
+// Copyright 2016 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include "DistortionPolynomialBatch.h"
+
+// Library/third-party includes
+// - none
+
+// Standard includes
+#include <cmath>
+
+// The SSE2 kernel is used whenever the compiler targets SSE2, which is
+// always the case on x86-64.  The AVX kernel is compiled on any x86
+// compiler that lets us build individual functions for AVX, and is only
+// called if the processor and OS support it.
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||            \
+    defined(_M_IX86)
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OSVR_RM_BATCH_SSE2
+#endif
+#if defined(_MSC_VER) || defined(__clang__) ||                                 \
+    (defined(__GNUC__) &&                                                      \
+     (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#define OSVR_RM_BATCH_AVX
+#endif
+#endif
+
+#if defined(OSVR_RM_BATCH_SSE2) || defined(OSVR_RM_BATCH_AVX)
+#include <immintrin.h>
+#endif
+#if defined(OSVR_RM_BATCH_AVX) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(OSVR_RM_BATCH_AVX) && !defined(_MSC_VER)
+#define OSVR_RM_TARGET_AVX __attribute__((target("avx")))
+#else
+#define OSVR_RM_TARGET_AVX
+#endif
+
+namespace osvr {
+namespace renderkit {
+
+    /// Distorts the coordinates in [begin, end) one at a time.  This
+    /// follows RenderManager::DistortionCorrectTextureCoordinate()
+    /// operation for operation, and is also used for the tail of a batch
+    /// that does not fill a whole SIMD register.
+    static void distortScalar(RGBPolynomialDistortion const& params,
+                              size_t begin, size_t end, const float* xIn,
+                              const float* yIn,
+                              std::array<float*, 3> const& xOut,
+                              std::array<float*, 3> const& yOut) {
+        const float overfill = params.m_overfillFactor;
+        for (size_t i = begin; i < end; i++) {
+            // Overfill space to normalized space to D space, relative to
+            // the center of projection.
+            float xN = (xIn[i] - 0.5f) * overfill + 0.5f;
+            float yN = (yIn[i] - 0.5f) * overfill + 0.5f;
+            float xDiff = xN * params.m_D[0] - params.m_COP[0];
+            float yDiff = yN * params.m_D[1] - params.m_COP[1];
+            float rMag2 = xDiff * xDiff + yDiff * yDiff;
+            if (rMag2 == 0) { // We're at the center -- no distortion
+                for (size_t clr = 0; clr < 3; clr++) {
+                    xOut[clr][i] = xIn[i];
+                    yOut[clr][i] = yIn[i];
+                }
+                continue;
+            }
+            float rMag = std::sqrt(rMag2);
+            float xNorm = xDiff / rMag;
+            float yNorm = yDiff / rMag;
+
+            for (size_t clr = 0; clr < 3; clr++) {
+                std::vector<float> const& poly = params.m_polynomials[clr];
+                float rFactor = 1;
+                float rNew = poly[0];
+                for (size_t p = 1; p < poly.size(); p++) {
+                    rFactor *= rMag;
+                    rNew += poly[p] * rFactor;
+                }
+                float xNNew = (params.m_COP[0] + rNew * xNorm) / params.m_D[0];
+                float yNNew = (params.m_COP[1] + rNew * yNorm) / params.m_D[1];
+                xOut[clr][i] = (xNNew - 0.5f) / overfill + 0.5f;
+                yOut[clr][i] = (yNNew - 0.5f) / overfill + 0.5f;
+            }
+        }
+    }
+
+#ifdef OSVR_RM_BATCH_SSE2
+    /// Distorts four coordinates at a time, returning how many were done.
+    static size_t distortSSE2(RGBPolynomialDistortion const& params,
+                              size_t count, const float* xIn, const float* yIn,
+                              std::array<float*, 3> const& xOut,
+                              std::array<float*, 3> const& yOut) {
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 overfill = _mm_set1_ps(params.m_overfillFactor);
+        const __m128 copX = _mm_set1_ps(params.m_COP[0]);
+        const __m128 copY = _mm_set1_ps(params.m_COP[1]);
+        const __m128 dX = _mm_set1_ps(params.m_D[0]);
+        const __m128 dY = _mm_set1_ps(params.m_D[1]);
+
+        size_t done = count - count % 4;
+        for (size_t i = 0; i < done; i += 4) {
+            __m128 x = _mm_loadu_ps(xIn + i);
+            __m128 y = _mm_loadu_ps(yIn + i);
+            __m128 xN = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(x, half), overfill),
+                                   half);
+            __m128 yN = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(y, half), overfill),
+                                   half);
+            __m128 xDiff = _mm_sub_ps(_mm_mul_ps(xN, dX), copX);
+            __m128 yDiff = _mm_sub_ps(_mm_mul_ps(yN, dY), copY);
+            __m128 rMag2 = _mm_add_ps(_mm_mul_ps(xDiff, xDiff),
+                                      _mm_mul_ps(yDiff, yDiff));
+            // Lanes at the center of projection pass through unchanged.
+            __m128 center = _mm_cmpeq_ps(rMag2, zero);
+            __m128 rMag = _mm_sqrt_ps(rMag2);
+            __m128 xNorm = _mm_div_ps(xDiff, rMag);
+            __m128 yNorm = _mm_div_ps(yDiff, rMag);
+
+            for (size_t clr = 0; clr < 3; clr++) {
+                std::vector<float> const& poly = params.m_polynomials[clr];
+                __m128 rFactor = _mm_set1_ps(1.0f);
+                __m128 rNew = _mm_set1_ps(poly[0]);
+                for (size_t p = 1; p < poly.size(); p++) {
+                    rFactor = _mm_mul_ps(rFactor, rMag);
+                    rNew = _mm_add_ps(
+                        rNew, _mm_mul_ps(_mm_set1_ps(poly[p]), rFactor));
+                }
+                __m128 xNNew =
+                    _mm_div_ps(_mm_add_ps(copX, _mm_mul_ps(rNew, xNorm)), dX);
+                __m128 yNNew =
+                    _mm_div_ps(_mm_add_ps(copY, _mm_mul_ps(rNew, yNorm)), dY);
+                __m128 xRet = _mm_add_ps(
+                    _mm_div_ps(_mm_sub_ps(xNNew, half), overfill), half);
+                __m128 yRet = _mm_add_ps(
+                    _mm_div_ps(_mm_sub_ps(yNNew, half), overfill), half);
+                xRet = _mm_or_ps(_mm_and_ps(center, x),
+                                 _mm_andnot_ps(center, xRet));
+                yRet = _mm_or_ps(_mm_and_ps(center, y),
+                                 _mm_andnot_ps(center, yRet));
+                _mm_storeu_ps(xOut[clr] + i, xRet);
+                _mm_storeu_ps(yOut[clr] + i, yRet);
+            }
+        }
+        return done;
+    }
+#endif
+
+#ifdef OSVR_RM_BATCH_AVX
+    /// Distorts eight coordinates at a time, returning how many were done.
+    OSVR_RM_TARGET_AVX static size_t
+    distortAVX(RGBPolynomialDistortion const& params, size_t count,
+               const float* xIn, const float* yIn,
+               std::array<float*, 3> const& xOut,
+               std::array<float*, 3> const& yOut) {
+        const __m256 half = _mm256_set1_ps(0.5f);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 overfill = _mm256_set1_ps(params.m_overfillFactor);
+        const __m256 copX = _mm256_set1_ps(params.m_COP[0]);
+        const __m256 copY = _mm256_set1_ps(params.m_COP[1]);
+        const __m256 dX = _mm256_set1_ps(params.m_D[0]);
+        const __m256 dY = _mm256_set1_ps(params.m_D[1]);
+
+        size_t done = count - count % 8;
+        for (size_t i = 0; i < done; i += 8) {
+            __m256 x = _mm256_loadu_ps(xIn + i);
+            __m256 y = _mm256_loadu_ps(yIn + i);
+            __m256 xN = _mm256_add_ps(
+                _mm256_mul_ps(_mm256_sub_ps(x, half), overfill), half);
+            __m256 yN = _mm256_add_ps(
+                _mm256_mul_ps(_mm256_sub_ps(y, half), overfill), half);
+            __m256 xDiff = _mm256_sub_ps(_mm256_mul_ps(xN, dX), copX);
+            __m256 yDiff = _mm256_sub_ps(_mm256_mul_ps(yN, dY), copY);
+            __m256 rMag2 = _mm256_add_ps(_mm256_mul_ps(xDiff, xDiff),
+                                         _mm256_mul_ps(yDiff, yDiff));
+            // Lanes at the center of projection pass through unchanged.
+            __m256 center = _mm256_cmp_ps(rMag2, zero, _CMP_EQ_OQ);
+            __m256 rMag = _mm256_sqrt_ps(rMag2);
+            __m256 xNorm = _mm256_div_ps(xDiff, rMag);
+            __m256 yNorm = _mm256_div_ps(yDiff, rMag);
+
+            for (size_t clr = 0; clr < 3; clr++) {
+                std::vector<float> const& poly = params.m_polynomials[clr];
+                __m256 rFactor = _mm256_set1_ps(1.0f);
+                __m256 rNew = _mm256_set1_ps(poly[0]);
+                for (size_t p = 1; p < poly.size(); p++) {
+                    rFactor = _mm256_mul_ps(rFactor, rMag);
+                    rNew = _mm256_add_ps(
+                        rNew, _mm256_mul_ps(_mm256_set1_ps(poly[p]), rFactor));
+                }
+                __m256 xNNew = _mm256_div_ps(
+                    _mm256_add_ps(copX, _mm256_mul_ps(rNew, xNorm)), dX);
+                __m256 yNNew = _mm256_div_ps(
+                    _mm256_add_ps(copY, _mm256_mul_ps(rNew, yNorm)), dY);
+                __m256 xRet = _mm256_add_ps(
+                    _mm256_div_ps(_mm256_sub_ps(xNNew, half), overfill), half);
+                __m256 yRet = _mm256_add_ps(
+                    _mm256_div_ps(_mm256_sub_ps(yNNew, half), overfill), half);
+                _mm256_storeu_ps(xOut[clr] + i,
+                                 _mm256_blendv_ps(xRet, x, center));
+                _mm256_storeu_ps(yOut[clr] + i,
+                                 _mm256_blendv_ps(yRet, y, center));
+            }
+        }
+        return done;
+    }
+
+    /// Does the processor support AVX, and does the OS save the AVX
+    /// registers on a context switch?
+    static bool processorHasAVX() {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx) {
+            return false;
+        }
+        // Both the SSE and AVX register state must be enabled.
+        return (_xgetbv(0) & 0x6) == 0x6;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx") != 0;
+#endif
+    }
+#endif
+
+    namespace {
+        enum BatchImplementation { BATCH_SCALAR, BATCH_SSE2, BATCH_AVX };
+
+        BatchImplementation selectImplementation() {
+#ifdef OSVR_RM_BATCH_AVX
+            if (processorHasAVX()) {
+                return BATCH_AVX;
+            }
+#endif
+#ifdef OSVR_RM_BATCH_SSE2
+            return BATCH_SSE2;
+#else
+            return BATCH_SCALAR;
+#endif
+        }
+
+        BatchImplementation getImplementation() {
+            // Checked once; function-local static initialization is
+            // thread-safe.
+            static const BatchImplementation impl = selectImplementation();
+            return impl;
+        }
+    } // namespace
+
+    void distortRGBPolynomialBatch(RGBPolynomialDistortion const& params,
+                                   size_t count, const float* xIn,
+                                   const float* yIn,
+                                   std::array<float*, 3> const& xOut,
+                                   std::array<float*, 3> const& yOut) {
+        size_t done = 0;
+        switch (getImplementation()) {
+#ifdef OSVR_RM_BATCH_AVX
+        case BATCH_AVX:
+            done = distortAVX(params, count, xIn, yIn, xOut, yOut);
+            break;
+#endif
+#ifdef OSVR_RM_BATCH_SSE2
+        case BATCH_SSE2:
+            done = distortSSE2(params, count, xIn, yIn, xOut, yOut);
+            break;
+#endif
+        default:
+            break;
+        }
+        distortScalar(params, done, count, xIn, yIn, xOut, yOut);
+    }
+
+    const char* distortRGBPolynomialBatchImplementation() {
+        switch (getImplementation()) {
+        case BATCH_AVX:
+            return "avx";
+        case BATCH_SSE2:
+            return "sse2";
+        default:
+            return "scalar";
+        }
+    }
+
+} // namespace renderkit
+} // namespace osvr
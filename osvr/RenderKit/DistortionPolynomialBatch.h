@@ -0,0 +1,79 @@
+/** @file
+    @brief Header for batched evaluation of rgb_symmetric_polynomials
+    distortion, with SIMD implementations selected at runtime.
+
+    @date 2016
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com/osvr>
+*/
+
+// Copyright 2016 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_DistortionPolynomialBatch_h_GUID_E2B7A0C4_61D8_4F35_B9C2_7A4D18E3F056
+#define INCLUDED_DistortionPolynomialBatch_h_GUID_E2B7A0C4_61D8_4F35_B9C2_7A4D18E3F056
+
+// Internal Includes
+// - none
+
+// Library/third-party includes
+// - none
+
+// Standard includes
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace osvr {
+namespace renderkit {
+
+    /// @brief Description of an rgb_symmetric_polynomials distortion,
+    /// as used by RenderManager::DistortionCorrectTextureCoordinate().
+    struct RGBPolynomialDistortion {
+        float m_overfillFactor; //< Render overfill factor
+        float m_COP[2];         //< Center of projection, in D space
+        float m_D[2];           //< Size of the unit square in D space
+        /// Coefficients for the red, green, and blue polynomials, lowest
+        /// order first.  Each needs at least two coefficients.
+        std::array<std::vector<float>, 3> m_polynomials;
+    };
+
+    /// @brief Distort a batch of texture coordinates for all three colors.
+    ///
+    /// Produces the same results as calling
+    /// RenderManager::DistortionCorrectTextureCoordinate() on each
+    /// coordinate for each color, but computes the shared per-coordinate
+    /// terms once and processes several coordinates at a time using SSE
+    /// or AVX when the processor supports them.
+    /// @param params Distortion to apply.
+    /// @param count Number of coordinates.
+    /// @param xIn, yIn Input texture coordinates (count each).
+    /// @param xOut, yOut Output texture coordinates for red, green, and
+    ///        blue (count each).
+    void distortRGBPolynomialBatch(RGBPolynomialDistortion const& params,
+                                   size_t count, const float* xIn,
+                                   const float* yIn,
+                                   std::array<float*, 3> const& xOut,
+                                   std::array<float*, 3> const& yOut);
+
+    /// @brief Name of the implementation that distortRGBPolynomialBatch()
+    /// selected for this processor ("avx", "sse2", or "scalar").
+    const char* distortRGBPolynomialBatchImplementation();
+
+} // namespace renderkit
+} // namespace osvr
+
+#endif // INCLUDED_DistortionPolynomialBatch_h_GUID_E2B7A0C4_61D8_4F35_B9C2_7A4D18E3F056
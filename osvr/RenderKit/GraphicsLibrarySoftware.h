@@ -0,0 +1,66 @@
+/** @file
+@brief Header file describing the OSVR software (headless) rendering library
+callback info
+
+@date 2016
+
+@author
+Sensics, Inc.
+<http://sensics.com/osvr>
+*/
+
+// Copyright 2016 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace osvr {
+namespace renderkit {
+
+    /// @brief Describes the software rendering library being used
+    ///
+    /// This is one of the members of the GraphicsLibrary union
+    /// from RenderManager.h.  The software renderer draws into
+    /// images in CPU memory and needs no device or context, so
+    /// there is nothing to describe yet.  It is in a separate
+    /// include file so that only code that actually uses this
+    /// needs to include it.
+
+    class GraphicsLibrarySoftware {};
+
+    /// @brief Describes an image in CPU memory to be rendered
+    ///
+    /// This is one of the members of the RenderBuffer union
+    /// from RenderManager.h.  It stores the pixels for a buffer
+    /// drawn by the software renderer.  The pixels are RGBA with
+    /// 8 bits per channel, and the bottom row comes first, to
+    /// match the texture coordinates used by OpenGL.  The depth
+    /// buffer is optional; when it is filled in, it has the same
+    /// layout and holds the window depth an OpenGL depth buffer
+    /// would, for use by time warp.
+
+    class RenderBufferSoftware {
+      public:
+        size_t width = 0;  //< Width of the image in pixels
+        size_t height = 0; //< Height of the image in pixels
+        std::vector<uint8_t> colorBuffer; //< width * height * 4 bytes
+        std::vector<float> depthBuffer;   //< width * height, or empty
+    };
+
+} // namespace renderkit
+} // namespace osvr
@@ -0,0 +1,233 @@
+/** @file
+    @brief Implementation of the packed binary point-sample distortion mesh
+    file format.
+
+    @date 2016
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com/osvr>
+*/
+
+// Copyright 2016 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include "PointMeshBinaryFormat.h"
+
+// Library/third-party includes
+// - none
+
+// Standard includes
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace osvr {
+namespace renderkit {
+
+    static const char POINT_MESH_BINARY_MAGIC[8] = "OSVRPMB";
+
+    // The points are copied directly to and from the file, so they must
+    // not have any padding.
+    static_assert(sizeof(MonoPointDistortionMeshDescription::value_type) ==
+                      4 * sizeof(double),
+                  "Unexpected padding in point-sample mesh entries");
+
+    bool isPointMeshBinary(const char* data, size_t size) {
+        return data != nullptr && size >= sizeof(PointMeshBinaryHeader) &&
+               memcmp(data, POINT_MESH_BINARY_MAGIC,
+                      sizeof(POINT_MESH_BINARY_MAGIC)) == 0;
+    }
+
+    bool loadPointMeshBinaryFile(const std::string& fileName,
+                                 std::vector<char>& dataOut) {
+        std::ifstream fs(fileName.c_str(), std::ios::in | std::ios::binary);
+        if (!fs.is_open()) {
+            std::cerr << "loadPointMeshBinaryFile: Could not open "
+                      << fileName << std::endl;
+            return false;
+        }
+        fs.seekg(0, std::ios::end);
+        std::streamoff size = fs.tellg();
+        fs.seekg(0, std::ios::beg);
+        if (size < 0) {
+            std::cerr << "loadPointMeshBinaryFile: Could not get size of "
+                      << fileName << std::endl;
+            return false;
+        }
+        dataOut.resize(static_cast<size_t>(size));
+        if (size > 0 && !fs.read(dataOut.data(), size)) {
+            std::cerr << "loadPointMeshBinaryFile: Could not read "
+                      << fileName << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    /// Decodes the meshes for all colors and eyes in the binary data,
+    /// checking that there are the expected number of colors.
+    static bool
+    parsePointMeshBinary(const char* data, size_t size, uint32_t numColors,
+                         std::vector<MonoPointDistortionMeshDescriptions>&
+                             meshesOut) {
+        if (!isPointMeshBinary(data, size)) {
+            std::cerr << "parsePointMeshBinary: Not a binary point mesh"
+                      << std::endl;
+            return false;
+        }
+        PointMeshBinaryHeader header;
+        memcpy(&header, data, sizeof(header));
+        if (header.m_version != POINT_MESH_BINARY_VERSION) {
+            std::cerr << "parsePointMeshBinary: Unsupported version "
+                      << header.m_version << std::endl;
+            return false;
+        }
+        if (header.m_numColors != numColors) {
+            std::cerr << "parsePointMeshBinary: Expected " << numColors
+                      << " colors, found " << header.m_numColors << std::endl;
+            return false;
+        }
+
+        // Read the table of point counts, making sure that it and all of
+        // the points it describes fit within the data.
+        size_t numMeshes =
+            static_cast<size_t>(header.m_numColors) * header.m_numEyes;
+        size_t offset = sizeof(header);
+        if (numMeshes > (size - offset) / sizeof(uint64_t)) {
+            std::cerr << "parsePointMeshBinary: Truncated count table"
+                      << std::endl;
+            return false;
+        }
+        std::vector<uint64_t> counts(numMeshes);
+        if (numMeshes > 0) {
+            memcpy(counts.data(), data + offset, numMeshes * sizeof(uint64_t));
+        }
+        offset += numMeshes * sizeof(uint64_t);
+
+        typedef MonoPointDistortionMeshDescription::value_type Point;
+        std::vector<MonoPointDistortionMeshDescriptions> meshes(
+            header.m_numColors);
+        for (size_t clr = 0; clr < header.m_numColors; clr++) {
+            meshes[clr].resize(header.m_numEyes);
+            for (size_t eye = 0; eye < header.m_numEyes; eye++) {
+                uint64_t count = counts[clr * header.m_numEyes + eye];
+                if (count > (size - offset) / sizeof(Point)) {
+                    std::cerr << "parsePointMeshBinary: Truncated mesh for "
+                                 "color "
+                              << clr << ", eye " << eye << std::endl;
+                    return false;
+                }
+                MonoPointDistortionMeshDescription& mesh = meshes[clr][eye];
+                mesh.resize(static_cast<size_t>(count));
+                if (count > 0) {
+                    memcpy(mesh.data(), data + offset,
+                           mesh.size() * sizeof(Point));
+                }
+                offset += mesh.size() * sizeof(Point);
+            }
+        }
+
+        meshesOut.swap(meshes);
+        return true;
+    }
+
+    bool
+    parseMonoPointMeshBinary(const char* data, size_t size,
+                             MonoPointDistortionMeshDescriptions& meshOut) {
+        std::vector<MonoPointDistortionMeshDescriptions> meshes;
+        if (!parsePointMeshBinary(data, size, 1, meshes)) {
+            return false;
+        }
+        meshOut.swap(meshes[0]);
+        return true;
+    }
+
+    bool parseRGBPointMeshBinary(const char* data, size_t size,
+                                 RGBPointDistortionMeshDescriptions& meshOut) {
+        std::vector<MonoPointDistortionMeshDescriptions> meshes;
+        if (!parsePointMeshBinary(data, size, 3, meshes)) {
+            return false;
+        }
+        for (size_t clr = 0; clr < 3; clr++) {
+            meshOut[clr].swap(meshes[clr]);
+        }
+        return true;
+    }
+
+    /// Encodes the meshes for all colors, which must each have the same
+    /// number of eyes.
+    static bool writePointMeshBinary(
+        std::ostream& out,
+        std::vector<const MonoPointDistortionMeshDescriptions*> const& colors) {
+        size_t numEyes = colors.empty() ? 0 : colors[0]->size();
+        for (size_t clr = 0; clr < colors.size(); clr++) {
+            if (colors[clr]->size() != numEyes) {
+                std::cerr << "writePointMeshBinary: Colors have different "
+                             "numbers of eyes"
+                          << std::endl;
+                return false;
+            }
+        }
+
+        PointMeshBinaryHeader header;
+        memcpy(header.m_magic, POINT_MESH_BINARY_MAGIC, sizeof(header.m_magic));
+        header.m_version = POINT_MESH_BINARY_VERSION;
+        header.m_numColors = static_cast<uint32_t>(colors.size());
+        header.m_numEyes = static_cast<uint32_t>(numEyes);
+        header.m_reserved = 0;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        for (size_t clr = 0; clr < colors.size(); clr++) {
+            for (size_t eye = 0; eye < numEyes; eye++) {
+                uint64_t count = (*colors[clr])[eye].size();
+                out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+            }
+        }
+        for (size_t clr = 0; clr < colors.size(); clr++) {
+            for (size_t eye = 0; eye < numEyes; eye++) {
+                MonoPointDistortionMeshDescription const& mesh =
+                    (*colors[clr])[eye];
+                if (!mesh.empty()) {
+                    out.write(reinterpret_cast<const char*>(mesh.data()),
+                              mesh.size() * sizeof(mesh[0]));
+                }
+            }
+        }
+        if (!out) {
+            std::cerr << "writePointMeshBinary: Could not write mesh"
+                      << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool writeMonoPointMeshBinary(
+        std::ostream& out, MonoPointDistortionMeshDescriptions const& mesh) {
+        std::vector<const MonoPointDistortionMeshDescriptions*> colors;
+        colors.push_back(&mesh);
+        return writePointMeshBinary(out, colors);
+    }
+
+    bool writeRGBPointMeshBinary(
+        std::ostream& out, RGBPointDistortionMeshDescriptions const& mesh) {
+        std::vector<const MonoPointDistortionMeshDescriptions*> colors;
+        for (size_t clr = 0; clr < 3; clr++) {
+            colors.push_back(&mesh[clr]);
+        }
+        return writePointMeshBinary(out, colors);
+    }
+
+} // namespace renderkit
+} // namespace osvr
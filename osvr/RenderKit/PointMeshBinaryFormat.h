@@ -0,0 +1,97 @@
+/** @file
+    @brief Header describing a packed binary file format for the point-sample
+    distortion meshes, which can be loaded without parsing JSON.
+
+    @date 2016
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com/osvr>
+*/
+
+// Copyright 2016 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_PointMeshBinaryFormat_h_GUID_9611CB1F_2A4D_43DD_8A30_87BF9EF6F798
+#define INCLUDED_PointMeshBinaryFormat_h_GUID_9611CB1F_2A4D_43DD_8A30_87BF9EF6F798
+
+// Internal Includes
+#include "MonoPointMeshTypes.h"
+#include "RGBPointMeshTypes.h"
+
+// Library/third-party includes
+// - none
+
+// Standard includes
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace osvr {
+namespace renderkit {
+
+    /// @brief Packed binary description of point-sample distortion meshes.
+    ///  The file starts with this header, which is followed by a table of
+    /// m_numColors * m_numEyes 64-bit point counts (all of the eyes for the
+    /// first color, then all of the eyes for the next color).  This is
+    /// followed by the points for each mesh, in the same order, stored as
+    /// contiguous 64-bit floats: from X, from Y, to X, to Y.  This is the
+    /// same layout as a MonoPointDistortionMeshDescription, so each mesh
+    /// can be loaded with a single copy.  All values are little-endian.
+    struct PointMeshBinaryHeader {
+        char m_magic[8];      //< "OSVRPMB" plus a terminating zero
+        uint32_t m_version;   //< POINT_MESH_BINARY_VERSION
+        uint32_t m_numColors; //< 1 for mono meshes, 3 for RGB meshes
+        uint32_t m_numEyes;   //< Number of meshes for each color
+        uint32_t m_reserved;  //< Always 0
+    };
+
+    static const uint32_t POINT_MESH_BINARY_VERSION = 1;
+
+    /// @brief Does the data start with the binary point-mesh signature?
+    bool isPointMeshBinary(const char* data, size_t size);
+
+    /// @brief Load the contents of a file into a buffer.
+    /// @return True on success, false on failure.
+    bool loadPointMeshBinaryFile(const std::string& fileName,
+                                 std::vector<char>& dataOut);
+
+    /// @brief Decode binary data holding mono point-sample meshes.
+    /// @return True on success, false (with meshOut unchanged) on
+    /// failure.
+    bool parseMonoPointMeshBinary(const char* data, size_t size,
+                                  MonoPointDistortionMeshDescriptions& meshOut);
+
+    /// @brief Decode binary data holding RGB point-sample meshes.
+    /// @return True on success, false (with meshOut unchanged) on
+    /// failure.
+    bool parseRGBPointMeshBinary(const char* data, size_t size,
+                                 RGBPointDistortionMeshDescriptions& meshOut);
+
+    /// @brief Encode mono point-sample meshes into the binary format.
+    /// @return True on success, false on failure.
+    bool writeMonoPointMeshBinary(
+        std::ostream& out, MonoPointDistortionMeshDescriptions const& mesh);
+
+    /// @brief Encode RGB point-sample meshes into the binary format.
+    /// @return True on success, false on failure.
+    bool writeRGBPointMeshBinary(
+        std::ostream& out, RGBPointDistortionMeshDescriptions const& mesh);
+
+} // namespace renderkit
+} // namespace osvr
+
+#endif // INCLUDED_PointMeshBinaryFormat_h_GUID_9611CB1F_2A4D_43DD_8A30_87BF9EF6F798
@@ -0,0 +1,195 @@
+/** @file
+    @brief Header describing structure-of-arrays storage for point-sample
+    distortion meshes.
+
+    @date 2016
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com/osvr>
+*/
+
+// Copyright 2016 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_PointMeshSoA_h_GUID_5C0E8F3A_7B21_4D6E_9A4F_2E81C7D3B960
+#define INCLUDED_PointMeshSoA_h_GUID_5C0E8F3A_7B21_4D6E_9A4F_2E81C7D3B960
+
+// Internal Includes
+#include "MonoPointMeshTypes.h"
+#include "RGBPointMeshTypes.h"
+
+// Library/third-party includes
+// - none
+
+// Standard includes
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+namespace osvr {
+namespace renderkit {
+
+    /// @brief Allocator that hands out memory aligned to Alignment bytes,
+    /// so that loops over the arrays can use aligned vector loads.
+    template <typename T, size_t Alignment> class AlignedAllocator {
+      public:
+        typedef T value_type;
+        template <typename U> struct rebind {
+            typedef AlignedAllocator<U, Alignment> other;
+        };
+
+        AlignedAllocator() {}
+        template <typename U>
+        AlignedAllocator(AlignedAllocator<U, Alignment> const&) {}
+
+        T* allocate(size_t n) {
+            // Over-allocate so that we can both align the block and store
+            // the pointer that we need to free just in front of it.
+            size_t bytes = n * sizeof(T) + Alignment + sizeof(void*);
+            void* raw = std::malloc(bytes);
+            if (raw == nullptr) {
+                throw std::bad_alloc();
+            }
+            uintptr_t start = reinterpret_cast<uintptr_t>(raw) + sizeof(void*);
+            uintptr_t aligned = (start + Alignment - 1) & ~(Alignment - 1);
+            reinterpret_cast<void**>(aligned)[-1] = raw;
+            return reinterpret_cast<T*>(aligned);
+        }
+
+        void deallocate(T* p, size_t) {
+            if (p != nullptr) {
+                std::free(reinterpret_cast<void**>(p)[-1]);
+            }
+        }
+
+        template <typename U>
+        bool operator==(AlignedAllocator<U, Alignment> const&) const {
+            return true;
+        }
+        template <typename U>
+        bool operator!=(AlignedAllocator<U, Alignment> const&) const {
+            return false;
+        }
+    };
+
+    /// Alignment of each of the structure-of-arrays coordinate arrays;
+    /// large enough for AVX loads.
+    static const size_t POINT_MESH_SOA_ALIGNMENT = 32;
+
+    typedef std::vector<double,
+                        AlignedAllocator<double, POINT_MESH_SOA_ALIGNMENT> >
+        PointMeshCoordinateArray;
+
+    /// @brief Structure-of-arrays version of a
+    /// MonoPointDistortionMeshDescription.
+    ///  Point i maps from (m_fromX[i], m_fromY[i]) to (m_toX[i], m_toY[i]).
+    /// Keeping each coordinate in its own aligned array lets distance
+    /// computations over many points be vectorized by the compiler.
+    class MonoPointDistortionMeshSoA {
+      public:
+        MonoPointDistortionMeshSoA() {}
+
+        /// Adapter from the array-of-structures description.
+        explicit MonoPointDistortionMeshSoA(
+            MonoPointDistortionMeshDescription const& points) {
+            reserve(points.size());
+            for (auto const& point : points) {
+                push_back(point[0][0], point[0][1], point[1][0], point[1][1]);
+            }
+        }
+
+        /// Adapter back to the array-of-structures description.
+        MonoPointDistortionMeshDescription toDescription() const {
+            MonoPointDistortionMeshDescription ret(size());
+            for (size_t i = 0; i < size(); i++) {
+                ret[i][0][0] = m_fromX[i];
+                ret[i][0][1] = m_fromY[i];
+                ret[i][1][0] = m_toX[i];
+                ret[i][1][1] = m_toY[i];
+            }
+            return ret;
+        }
+
+        size_t size() const { return m_fromX.size(); }
+        bool empty() const { return m_fromX.empty(); }
+
+        void clear() {
+            m_fromX.clear();
+            m_fromY.clear();
+            m_toX.clear();
+            m_toY.clear();
+        }
+
+        void reserve(size_t n) {
+            m_fromX.reserve(n);
+            m_fromY.reserve(n);
+            m_toX.reserve(n);
+            m_toY.reserve(n);
+        }
+
+        void push_back(double fromX, double fromY, double toX, double toY) {
+            m_fromX.push_back(fromX);
+            m_fromY.push_back(fromY);
+            m_toX.push_back(toX);
+            m_toY.push_back(toY);
+        }
+
+        /// The "from" location of point i, as used by the
+        /// array-of-structures code.
+        std::array<double, 2> from(size_t i) const {
+            std::array<double, 2> ret = {{m_fromX[i], m_fromY[i]}};
+            return ret;
+        }
+
+        PointMeshCoordinateArray m_fromX; //< Input X coordinates
+        PointMeshCoordinateArray m_fromY; //< Input Y coordinates
+        PointMeshCoordinateArray m_toX;   //< Output X coordinates
+        PointMeshCoordinateArray m_toY;   //< Output Y coordinates
+    };
+
+    typedef std::vector< //!< One mapping per eye
+        MonoPointDistortionMeshSoA> MonoPointDistortionMeshSoAs;
+
+    typedef std::array< //!< One mapping per color red, green, blue
+        MonoPointDistortionMeshSoAs, 3> RGBPointDistortionMeshSoAs;
+
+    /// Adapter from the per-eye array-of-structures descriptions.
+    inline MonoPointDistortionMeshSoAs
+    toSoA(MonoPointDistortionMeshDescriptions const& meshes) {
+        MonoPointDistortionMeshSoAs ret;
+        ret.reserve(meshes.size());
+        for (auto const& mesh : meshes) {
+            ret.emplace_back(mesh);
+        }
+        return ret;
+    }
+
+    /// Adapter from the per-color, per-eye array-of-structures
+    /// descriptions.
+    inline RGBPointDistortionMeshSoAs
+    toSoA(RGBPointDistortionMeshDescriptions const& meshes) {
+        RGBPointDistortionMeshSoAs ret;
+        for (size_t clr = 0; clr < meshes.size(); clr++) {
+            ret[clr] = toSoA(meshes[clr]);
+        }
+        return ret;
+    }
+
+} // namespace renderkit
+} // namespace osvr
+#endif // INCLUDED_PointMeshSoA_h_GUID_5C0E8F3A_7B21_4D6E_9A4F_2E81C7D3B960
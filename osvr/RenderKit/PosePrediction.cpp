@@ -0,0 +1,276 @@
+/** @file
+    @brief Implementation of tracker pose prediction.
+
+    @date 2016
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com/osvr>
+*/
+
+// Copyright 2016 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include "PosePrediction.h"
+
+// Library/third-party includes
+#include <osvr/Util/QuaternionC.h>
+#include <osvr/Util/TimeValueC.h>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+// Standard includes
+#include <cmath>
+
+namespace osvr {
+namespace renderkit {
+
+    static Eigen::Quaterniond toEigen(OSVR_Quaternion const& q) {
+        return Eigen::Quaterniond(osvrQuatGetW(&q), osvrQuatGetX(&q),
+                                  osvrQuatGetY(&q), osvrQuatGetZ(&q));
+    }
+
+    static void fromEigen(Eigen::Quaterniond const& in, OSVR_Quaternion& q) {
+        osvrQuatSetW(&q, in.w());
+        osvrQuatSetX(&q, in.x());
+        osvrQuatSetY(&q, in.y());
+        osvrQuatSetZ(&q, in.z());
+    }
+
+    bool angularRateFromIncrementalRotation(
+        OSVR_IncrementalQuaternion const& vel, AngularRate& rateOut) {
+        rateOut.fill(0);
+        if (!(vel.dt > 0)) {
+            return false;
+        }
+
+        // q and -q are the same rotation; pick the one with a non-negative
+        // real part so that the angle we get is the short way around.
+        Eigen::Quaterniond q = toEigen(vel.incrementalRotation);
+        double norm = q.norm();
+        if (norm == 0) {
+            return false;
+        }
+        q.coeffs() /= norm;
+        if (q.w() < 0) {
+            q.coeffs() *= -1;
+        }
+
+        // The angle is 2*atan2(|v|, w), which stays accurate for the very
+        // small rotations reported by high-rate trackers, where acos(w)
+        // would not.
+        Eigen::Vector3d v = q.vec();
+        double sinHalf = v.norm();
+        if (sinHalf == 0) {
+            return true;
+        }
+        double angle = 2 * std::atan2(sinHalf, q.w());
+        Eigen::Vector3d rate = v * (angle / (sinHalf * vel.dt));
+        rateOut = {{rate[0], rate[1], rate[2]}};
+        return true;
+    }
+
+    void rotateByAngularRate(OSVR_Quaternion const& in,
+                             AngularRate const& rate, double seconds,
+                             OSVR_Quaternion& out) {
+        Eigen::Vector3d omega(rate[0], rate[1], rate[2]);
+        double speed = omega.norm();
+        if (speed == 0) {
+            out = in;
+            return;
+        }
+        Eigen::Quaterniond delta(
+            Eigen::AngleAxisd(speed * seconds, omega / speed));
+        fromEigen(delta * toEigen(in), out);
+    }
+
+    void predictPose(OSVR_PoseState const& poseIn,
+                     OSVR_VelocityState const& vel,
+                     double predictionIntervalSec, OSVR_PoseState& poseOut) {
+        // Make a copy of the pose state so that we can handle the
+        // case where the out and in pose are the same.
+        OSVR_PoseState out = poseIn;
+
+        // If we have a change in orientation, make it.
+        AngularRate rate;
+        if (vel.angularVelocityValid &&
+            angularRateFromIncrementalRotation(vel.angularVelocity, rate)) {
+            rotateByAngularRate(poseIn.rotation, rate, predictionIntervalSec,
+                                out.rotation);
+        }
+
+        // If we have a linear velocity, apply it.
+        if (vel.linearVelocityValid) {
+            for (size_t i = 0; i < 3; i++) {
+                out.translation.data[i] +=
+                    vel.linearVelocity.data[i] * predictionIntervalSec;
+            }
+        }
+
+        // @todo Make sure the above transformation happens in
+        // the correct space, so we're rotating about the object
+        // center and translating in external (not object-local)
+        // space.
+
+        poseOut = out;
+    }
+
+    void predictPose(OSVR_PoseState const& poseIn,
+                     OSVR_VelocityState const& vel,
+                     OSVR_AccelerationState const& accel,
+                     double predictionIntervalSec, OSVR_PoseState& poseOut) {
+        OSVR_PoseState out = poseIn;
+        double t = predictionIntervalSec;
+
+        // Rotate by the rotation vector w*t + a*t*t/2.
+        AngularRate rate;
+        if (vel.angularVelocityValid &&
+            angularRateFromIncrementalRotation(vel.angularVelocity, rate)) {
+            AngularRate rateChange;
+            if (accel.angularAccelerationValid &&
+                angularRateFromIncrementalRotation(accel.angularAcceleration,
+                                                   rateChange)) {
+                double scale = 0.5 * t / accel.angularAcceleration.dt;
+                for (size_t i = 0; i < 3; i++) {
+                    rate[i] += rateChange[i] * scale;
+                }
+            }
+            rotateByAngularRate(poseIn.rotation, rate, t, out.rotation);
+        }
+
+        // Translate by v*t + a*t*t/2.
+        for (size_t i = 0; i < 3; i++) {
+            if (vel.linearVelocityValid) {
+                out.translation.data[i] += vel.linearVelocity.data[i] * t;
+            }
+            if (accel.linearAccelerationValid) {
+                out.translation.data[i] +=
+                    0.5 * accel.linearAcceleration.data[i] * t * t;
+            }
+        }
+
+        poseOut = out;
+    }
+
+    void ConstantVelocityPredictor::AddReport(
+        OSVR_TimeValue const& /* timestamp */, OSVR_PoseState const& pose,
+        OSVR_VelocityState const& vel,
+        OSVR_AccelerationState const& /* accel */) {
+        m_haveReport = true;
+        m_pose = pose;
+        m_velocity = vel;
+    }
+
+    bool ConstantVelocityPredictor::Predict(double predictionIntervalSec,
+                                            OSVR_PoseState& poseOut) {
+        if (!m_haveReport) {
+            return false;
+        }
+        predictPose(m_pose, m_velocity, predictionIntervalSec, poseOut);
+        return true;
+    }
+
+    void ConstantAccelerationPredictor::AddReport(
+        OSVR_TimeValue const& timestamp, OSVR_PoseState const& pose,
+        OSVR_VelocityState const& vel, OSVR_AccelerationState const& accel) {
+        ConstantVelocityPredictor::AddReport(timestamp, pose, vel, accel);
+        m_acceleration = accel;
+    }
+
+    bool ConstantAccelerationPredictor::Predict(double predictionIntervalSec,
+                                                OSVR_PoseState& poseOut) {
+        if (!m_haveReport) {
+            return false;
+        }
+        predictPose(m_pose, m_velocity, m_acceleration, predictionIntervalSec,
+                    poseOut);
+        return true;
+    }
+
+    AlphaBetaPredictor::AlphaBetaPredictor(double alpha, double beta,
+                                           double maxGapSec)
+        : m_alpha(alpha), m_beta(beta), m_maxGapSec(maxGapSec) {}
+
+    void AlphaBetaPredictor::AddReport(OSVR_TimeValue const& timestamp,
+                                       OSVR_PoseState const& pose,
+                                       OSVR_VelocityState const& /* vel */,
+                                       OSVR_AccelerationState const&
+                                       /* accel */) {
+        double dt = 0;
+        if (m_reports > 0) {
+            dt = osvrTimeValueDurationSeconds(&timestamp, &m_lastTime);
+            if (dt <= 0) {
+                // The same report we have already seen (or an older one).
+                return;
+            }
+        }
+        m_lastTime = timestamp;
+        m_lastPose = pose;
+
+        if (m_reports == 0 || dt > m_maxGapSec) {
+            // Start over from rest at the reported pose.
+            m_reports = 1;
+            m_estimate = pose;
+            m_linearVelocity.fill(0);
+            m_angularRate.fill(0);
+            return;
+        }
+        m_reports++;
+
+        // Predict the filtered pose forward to this report, then correct
+        // the pose and rates by the residual.
+        for (size_t i = 0; i < 3; i++) {
+            double expected =
+                m_estimate.translation.data[i] + m_linearVelocity[i] * dt;
+            double residual = pose.translation.data[i] - expected;
+            m_estimate.translation.data[i] = expected + m_alpha * residual;
+            m_linearVelocity[i] += (m_beta / dt) * residual;
+        }
+
+        OSVR_Quaternion expected;
+        rotateByAngularRate(m_estimate.rotation, m_angularRate, dt, expected);
+        // The residual rotation, applied on the left like the rates are,
+        // expressed as a rotation vector (its rate over one second).
+        OSVR_IncrementalQuaternion residual;
+        fromEigen(toEigen(pose.rotation) * toEigen(expected).inverse(),
+                  residual.incrementalRotation);
+        residual.dt = 1;
+        AngularRate residualVector;
+        angularRateFromIncrementalRotation(residual, residualVector);
+        rotateByAngularRate(expected, residualVector, m_alpha,
+                            m_estimate.rotation);
+        for (size_t i = 0; i < 3; i++) {
+            m_angularRate[i] += (m_beta / dt) * residualVector[i];
+        }
+    }
+
+    bool AlphaBetaPredictor::Predict(double predictionIntervalSec,
+                                     OSVR_PoseState& poseOut) {
+        if (m_reports == 0) {
+            return false;
+        }
+        OSVR_PoseState out = m_lastPose;
+        for (size_t i = 0; i < 3; i++) {
+            out.translation.data[i] +=
+                m_linearVelocity[i] * predictionIntervalSec;
+        }
+        rotateByAngularRate(m_lastPose.rotation, m_angularRate,
+                            predictionIntervalSec, out.rotation);
+        poseOut = out;
+        return true;
+    }
+
+} // namespace renderkit
+} // namespace osvr
@@ -0,0 +1,186 @@
+/** @file
+    @brief Header for prediction of tracker poses, used both to predict
+    the head pose for rendering and for time warp.
+
+    @date 2016
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com/osvr>
+*/
+
+// Copyright 2016 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_PosePrediction_h_GUID_5C0E8F3A_9B27_4D61_A4E8_2F71C6D93B15
+#define INCLUDED_PosePrediction_h_GUID_5C0E8F3A_9B27_4D61_A4E8_2F71C6D93B15
+
+// Internal Includes
+// - none
+
+// Library/third-party includes
+#include <osvr/Util/ClientReportTypesC.h>
+#include <osvr/Util/TimeValueC.h>
+
+// Standard includes
+#include <array>
+#include <cstddef>
+
+namespace osvr {
+namespace renderkit {
+
+    /// @brief Angular velocity as a rotation axis scaled by the rate of
+    /// rotation about it, in radians per second, in the same (room) space
+    /// as the incremental rotation it was computed from.
+    typedef std::array<double, 3> AngularRate;
+
+    /// @brief Convert an OSVR incremental rotation over dt seconds into an
+    /// angular rate.
+    ///
+    /// The incremental rotation is taken the short way around, so rates
+    /// of up to half a turn per dt are represented.
+    /// @return False (with rateOut zeroed) if dt is not positive.
+    bool angularRateFromIncrementalRotation(
+        OSVR_IncrementalQuaternion const& vel, AngularRate& rateOut);
+
+    /// @brief Rotate an orientation at a constant angular rate for the
+    /// specified (possibly negative) time.
+    ///
+    /// The rotation is applied on the left, in the space the rate is
+    /// expressed in, and is computed in closed form with one exponential
+    /// map no matter how long the interval.  out may be the same as in.
+    void rotateByAngularRate(OSVR_Quaternion const& in,
+                             AngularRate const& rate, double seconds,
+                             OSVR_Quaternion& out);
+
+    /// @brief Predict a future pose based on initial pose and velocity.
+    ///
+    /// Integrates whichever of the linear and angular velocities are
+    /// marked valid over the prediction interval, assuming both are
+    /// constant.  poseOut may be the same structure as poseIn.
+    void predictPose(OSVR_PoseState const& poseIn,
+                     OSVR_VelocityState const& vel,
+                     double predictionIntervalSec, OSVR_PoseState& poseOut);
+
+    /// @brief Predict a future pose based on initial pose, velocity and
+    /// acceleration.
+    ///
+    /// Like predictPose(), but also integrates whichever of the linear and
+    /// angular accelerations are marked valid (an angular acceleration is
+    /// only used along with a valid angular velocity).  The angular
+    /// acceleration's incremental rotation is the change in rotation rate
+    /// over its dt, expressed as the rotation that rate change would
+    /// produce over dt.  The rotation is exact when the angular velocity
+    /// and acceleration are about the same axis.
+    void predictPose(OSVR_PoseState const& poseIn,
+                     OSVR_VelocityState const& vel,
+                     OSVR_AccelerationState const& accel,
+                     double predictionIntervalSec, OSVR_PoseState& poseOut);
+
+    /// @brief Predicts the pose of one tracked interface.
+    ///
+    /// RenderManager hands each predictor every report it reads for the
+    /// interface, which will include the same report more than once when
+    /// no new one has arrived, and asks it where the interface will be a
+    /// given time after the most recent report.
+    class PosePredictor {
+      public:
+        virtual ~PosePredictor() {}
+
+        /// @brief Pass in the most-recent report for the interface.  The
+        /// velocity and acceleration have their valid flags cleared if
+        /// the tracker does not report them.
+        virtual void AddReport(OSVR_TimeValue const& timestamp,
+                               OSVR_PoseState const& pose,
+                               OSVR_VelocityState const& vel,
+                               OSVR_AccelerationState const& accel) = 0;
+
+        /// @brief Predict the pose the specified time after the most
+        /// recent report.
+        /// @return False (with poseOut unchanged) if there has been no
+        /// report.
+        virtual bool Predict(double predictionIntervalSec,
+                             OSVR_PoseState& poseOut) = 0;
+    };
+
+    /// @brief Predicts using the velocity reported by the tracker, or not
+    /// at all if there is none.
+    class ConstantVelocityPredictor : public PosePredictor {
+      public:
+        void AddReport(OSVR_TimeValue const& timestamp,
+                       OSVR_PoseState const& pose,
+                       OSVR_VelocityState const& vel,
+                       OSVR_AccelerationState const& accel) override;
+        bool Predict(double predictionIntervalSec,
+                     OSVR_PoseState& poseOut) override;
+
+      protected:
+        bool m_haveReport = false;
+        OSVR_PoseState m_pose;
+        OSVR_VelocityState m_velocity;
+    };
+
+    /// @brief Predicts using the velocity and acceleration reported by the
+    /// tracker, using whichever of them are available.
+    class ConstantAccelerationPredictor : public ConstantVelocityPredictor {
+      public:
+        void AddReport(OSVR_TimeValue const& timestamp,
+                       OSVR_PoseState const& pose,
+                       OSVR_VelocityState const& vel,
+                       OSVR_AccelerationState const& accel) override;
+        bool Predict(double predictionIntervalSec,
+                     OSVR_PoseState& poseOut) override;
+
+      protected:
+        OSVR_AccelerationState m_acceleration;
+    };
+
+    /// @brief Predicts using linear and angular velocities estimated from
+    /// the history of reported poses by an alpha-beta filter, for
+    /// trackers that do not report velocity.
+    ///
+    /// Each new report corrects the filter's estimated pose by alpha times
+    /// the difference between the reported and the expected pose, and its
+    /// velocity by beta times that difference per second since the last
+    /// report.  Predictions start from the reported pose, so the filter
+    /// smooths the velocity without adding lag.  The filter starts over
+    /// when reports stop for longer than maxGapSec.
+    class AlphaBetaPredictor : public PosePredictor {
+      public:
+        AlphaBetaPredictor(double alpha, double beta, double maxGapSec = 0.25);
+
+        void AddReport(OSVR_TimeValue const& timestamp,
+                       OSVR_PoseState const& pose,
+                       OSVR_VelocityState const& vel,
+                       OSVR_AccelerationState const& accel) override;
+        bool Predict(double predictionIntervalSec,
+                     OSVR_PoseState& poseOut) override;
+
+      protected:
+        double m_alpha;
+        double m_beta;
+        double m_maxGapSec;
+
+        size_t m_reports = 0;      //< Reports since the filter started
+        OSVR_TimeValue m_lastTime; //< Timestamp of the latest report
+        OSVR_PoseState m_lastPose; //< Latest reported pose
+        OSVR_PoseState m_estimate; //< Filtered pose at m_lastTime
+        std::array<double, 3> m_linearVelocity; //< Meters per second
+        AngularRate m_angularRate;
+    };
+
+} // namespace renderkit
+} // namespace osvr
+
+#endif // INCLUDED_PosePrediction_h_GUID_5C0E8F3A_9B27_4D61_A4E8_2F71C6D93B15
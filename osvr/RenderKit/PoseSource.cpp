@@ -0,0 +1,234 @@
+/** @file
+    @brief Implementation of the scripted PoseSource.
+
+    @date 2016
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com/osvr>
+*/
+
+// Copyright 2016 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include "PoseSource.h"
+
+// Library/third-party includes
+#include <osvr/Util/QuatlibInteropC.h>
+#include <quat.h>
+
+// Standard includes
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+
+namespace osvr {
+namespace renderkit {
+
+    /// Convert a (possibly fractional) number of seconds into a time value.
+    static OSVR_TimeValue timeFromSeconds(double seconds) {
+        OSVR_TimeValue ret;
+        double whole = std::floor(seconds);
+        ret.seconds = static_cast<OSVR_TimeValue_Seconds>(whole);
+        ret.microseconds = static_cast<OSVR_TimeValue_Microseconds>(
+            std::floor((seconds - whole) * 1e6 + 0.5));
+        if (ret.microseconds >= 1000000) {
+            ret.seconds++;
+            ret.microseconds -= 1000000;
+        }
+        return ret;
+    }
+
+    static bool earlierThan(const OSVR_TimeValue& a, const OSVR_TimeValue& b) {
+        return (a.seconds < b.seconds) ||
+               ((a.seconds == b.seconds) && (a.microseconds < b.microseconds));
+    }
+
+    ScriptedPoseSource::ScriptedPoseSource() {
+        m_now.seconds = 0;
+        m_now.microseconds = 0;
+    }
+
+    void ScriptedPoseSource::AddPose(const std::string& path,
+                                     const OSVR_TimeValue& time,
+                                     const OSVR_PoseState& pose) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        Report report;
+        report.m_time = time;
+        report.m_pose = pose;
+
+        // Keep the reports sorted, with reports at the same time kept in
+        // the order they were added.
+        std::vector<Report>& reports = m_trajectories[path].m_reports;
+        reports.insert(std::upper_bound(reports.begin(), reports.end(), report,
+                                        [](const Report& a, const Report& b) {
+                                            return earlierThan(a.m_time,
+                                                               b.m_time);
+                                        }),
+                       report);
+    }
+
+    bool ScriptedPoseSource::LoadTrajectory(const std::string& path,
+                                            std::istream& in) {
+        std::string line;
+        size_t lineNumber = 0;
+        while (std::getline(in, line)) {
+            lineNumber++;
+            size_t first = line.find_first_not_of(" \t\r");
+            if ((first == std::string::npos) || (line[first] == '#')) {
+                continue;
+            }
+            std::istringstream s(line);
+            double seconds;
+            OSVR_PoseState pose;
+            double w, x, y, z;
+            if (!(s >> seconds >> pose.translation.data[0] >>
+                  pose.translation.data[1] >> pose.translation.data[2] >> w >>
+                  x >> y >> z)) {
+                std::cerr << "ScriptedPoseSource::LoadTrajectory: Could not "
+                             "parse line "
+                          << lineNumber << " for " << path << std::endl;
+                return false;
+            }
+            osvrQuatSetW(&pose.rotation, w);
+            osvrQuatSetX(&pose.rotation, x);
+            osvrQuatSetY(&pose.rotation, y);
+            osvrQuatSetZ(&pose.rotation, z);
+            AddPose(path, timeFromSeconds(seconds), pose);
+        }
+        return true;
+    }
+
+    void ScriptedPoseSource::SetStringParameter(const std::string& path,
+                                                const std::string& value) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_strings[path] = value;
+    }
+
+    void ScriptedPoseSource::SetTime(const OSVR_TimeValue& now) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_now = now;
+    }
+
+    void ScriptedPoseSource::AdvanceTime(double seconds) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        OSVR_TimeValue interval = timeFromSeconds(seconds);
+        osvrTimeValueSum(&m_now, &interval);
+    }
+
+    bool ScriptedPoseSource::Update() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (auto& t : m_trajectories) {
+            Trajectory& traj = t.second;
+            traj.m_latched = false;
+            traj.m_velocity.linearVelocityValid = false;
+            traj.m_velocity.angularVelocityValid = false;
+
+            // Find the first report later than now; the one before it is
+            // the one that would have most recently arrived.
+            auto next = std::upper_bound(
+                traj.m_reports.begin(), traj.m_reports.end(), m_now,
+                [](const OSVR_TimeValue& now, const Report& r) {
+                    return earlierThan(now, r.m_time);
+                });
+            if (next == traj.m_reports.begin()) {
+                continue;
+            }
+            const Report& current = *(next - 1);
+            traj.m_latched = true;
+            traj.m_current = current;
+
+            // Difference with the previous report to get the velocity.
+            if (next - 1 == traj.m_reports.begin()) {
+                continue;
+            }
+            const Report& previous = *(next - 2);
+            double dt =
+                osvrTimeValueDurationSeconds(&current.m_time, &previous.m_time);
+            if (dt <= 0) {
+                continue;
+            }
+            for (size_t i = 0; i < 3; i++) {
+                traj.m_velocity.linearVelocity.data[i] =
+                    (current.m_pose.translation.data[i] -
+                     previous.m_pose.translation.data[i]) /
+                    dt;
+            }
+            traj.m_velocity.linearVelocityValid = true;
+
+            // The incremental rotation is the one that takes the previous
+            // orientation to the current one when applied on the left,
+            // which is how RenderManager applies it when predicting.
+            q_type from, to, fromInverse, increment;
+            osvrQuatToQuatlib(from, &previous.m_pose.rotation);
+            osvrQuatToQuatlib(to, &current.m_pose.rotation);
+            q_invert(fromInverse, from);
+            q_mult(increment, to, fromInverse);
+            osvrQuatFromQuatlib(
+                &traj.m_velocity.angularVelocity.incrementalRotation,
+                increment);
+            traj.m_velocity.angularVelocity.dt = dt;
+            traj.m_velocity.angularVelocityValid = true;
+        }
+        return true;
+    }
+
+    void ScriptedPoseSource::GetTimeNow(OSVR_TimeValue& now) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        now = m_now;
+    }
+
+    bool ScriptedPoseSource::GetPoseState(const std::string& path,
+                                          OSVR_TimeValue& timestamp,
+                                          OSVR_PoseState& pose) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto t = m_trajectories.find(path);
+        if ((t == m_trajectories.end()) || !t->second.m_latched) {
+            return false;
+        }
+        timestamp = t->second.m_current.m_time;
+        pose = t->second.m_current.m_pose;
+        return true;
+    }
+
+    bool ScriptedPoseSource::GetVelocityState(const std::string& path,
+                                              OSVR_TimeValue& timestamp,
+                                              OSVR_VelocityState& velocity) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto t = m_trajectories.find(path);
+        if ((t == m_trajectories.end()) || !t->second.m_latched) {
+            return false;
+        }
+        timestamp = t->second.m_current.m_time;
+        velocity = t->second.m_velocity;
+        return true;
+    }
+
+    bool ScriptedPoseSource::GetStringParameter(const std::string& path,
+                                                std::string& value) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto s = m_strings.find(path);
+        if (s == m_strings.end()) {
+            return false;
+        }
+        value = s->second;
+        return true;
+    }
+
+} // namespace renderkit
+} // namespace osvr
@@ -0,0 +1,178 @@
+/** @file
+    @brief Header describing where RenderManager gets its tracker poses
+    and display configuration, along with a scripted source that replays
+    recorded trajectories without needing an OSVR server.
+
+    @date 2016
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com/osvr>
+*/
+
+// Copyright 2016 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// Internal Includes
+#include <osvr/RenderKit/Export.h>
+
+// Library/third-party includes
+#include <osvr/Util/ClientReportTypesC.h>
+#include <osvr/Util/TimeValueC.h>
+
+// Standard includes
+#include <istream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace osvr {
+namespace renderkit {
+
+    /// @brief Source of the tracker state and configuration RenderManager
+    /// reads.
+    ///
+    /// By default, RenderManager reads poses, velocities and the time from
+    /// an OSVR client context, and createRenderManager() waits for a server
+    /// to provide the display and RenderManager configuration.  Passing
+    /// an object implementing this interface in place of the context lets
+    /// the application (or a test or benchmark) provide all of these
+    /// itself.  Paths are OSVR path names like "/me/head".  Methods may be
+    /// called from more than one thread, so implementations must be
+    /// thread-safe.
+    class PoseSource {
+      public:
+        virtual ~PoseSource() {}
+
+        /// @brief Bring the state up to date (called where RenderManager
+        /// would otherwise call osvrClientUpdate()).
+        /// @return False on failure.
+        virtual bool Update() = 0;
+
+        /// @brief Read the current time on the clock the report timestamps
+        /// are measured against.
+        virtual void GetTimeNow(OSVR_TimeValue& now) = 0;
+
+        /// @brief Read the most-recent pose reported for a path.
+        /// @return False if there is no pose for that path.
+        virtual bool GetPoseState(const std::string& path,
+                                  OSVR_TimeValue& timestamp,
+                                  OSVR_PoseState& pose) = 0;
+
+        /// @brief Read the most-recent velocity reported for a path.
+        /// @return False if there is no velocity for that path.
+        virtual bool GetVelocityState(const std::string& path,
+                                      OSVR_TimeValue& timestamp,
+                                      OSVR_VelocityState& velocity) = 0;
+
+        /// @brief Read the most-recent acceleration reported for a path.
+        /// The default reports none.
+        /// @return False if there is no acceleration for that path.
+        virtual bool
+        GetAccelerationState(const std::string& /* path */,
+                             OSVR_TimeValue& /* timestamp */,
+                             OSVR_AccelerationState& /* accel */) {
+            return false;
+        }
+
+        /// @brief Read a configuration string, which is asked for using
+        /// "/display" and "/renderManagerConfig".
+        /// @return False if there is no string for that path.
+        virtual bool GetStringParameter(const std::string& path,
+                                        std::string& value) = 0;
+    };
+
+    /// @brief PoseSource that replays scripted trajectories
+    ///
+    /// Holds a list of timestamped poses for each path and a clock that
+    /// only moves when it is told to.  Each Update() latches, for every
+    /// path, the last pose whose timestamp is not later than the clock,
+    /// just as a tracker report would have arrived by then, and reports
+    /// the velocity between it and the pose before it.  This makes the
+    /// poses, prediction and time warp repeatable from run to run.
+    class ScriptedPoseSource : public PoseSource {
+      public:
+        OSVR_RENDERMANAGER_EXPORT ScriptedPoseSource();
+
+        /// @brief Add a pose report for a path.  Reports may be added in
+        /// any order.
+        OSVR_RENDERMANAGER_EXPORT void AddPose(const std::string& path,
+                                               const OSVR_TimeValue& time,
+                                               const OSVR_PoseState& pose);
+
+        /// @brief Read pose reports for a path from a stream.
+        ///
+        /// Each line holds one report as "seconds x y z qw qx qy qz", with
+        /// the time in seconds (fractions allowed).  Blank lines and
+        /// lines starting with # are ignored.
+        /// @return False if a line could not be parsed; the reports
+        /// before it will have been added.
+        OSVR_RENDERMANAGER_EXPORT bool LoadTrajectory(const std::string& path,
+                                                      std::istream& in);
+
+        /// @brief Set the string returned for a configuration path, such
+        /// as "/display" or "/renderManagerConfig".
+        OSVR_RENDERMANAGER_EXPORT void
+        SetStringParameter(const std::string& path, const std::string& value);
+
+        /// @brief Set the clock.  It may be moved backwards to restart a
+        /// replay.
+        OSVR_RENDERMANAGER_EXPORT void SetTime(const OSVR_TimeValue& now);
+
+        /// @brief Move the clock forward by the specified time.
+        OSVR_RENDERMANAGER_EXPORT void AdvanceTime(double seconds);
+
+        //===================================================================
+        // PoseSource interface.
+        OSVR_RENDERMANAGER_EXPORT bool Update() override;
+        OSVR_RENDERMANAGER_EXPORT void GetTimeNow(OSVR_TimeValue& now) override;
+        OSVR_RENDERMANAGER_EXPORT bool
+        GetPoseState(const std::string& path, OSVR_TimeValue& timestamp,
+                     OSVR_PoseState& pose) override;
+        OSVR_RENDERMANAGER_EXPORT bool
+        GetVelocityState(const std::string& path, OSVR_TimeValue& timestamp,
+                         OSVR_VelocityState& velocity) override;
+        OSVR_RENDERMANAGER_EXPORT bool
+        GetStringParameter(const std::string& path,
+                           std::string& value) override;
+
+      protected:
+        /// One scripted pose report.
+        class Report {
+          public:
+            OSVR_TimeValue m_time;
+            OSVR_PoseState m_pose;
+        };
+
+        /// Reports for one path, sorted by time, and what was latched from
+        /// them by the most recent Update().
+        class Trajectory {
+          public:
+            std::vector<Report> m_reports;
+            bool m_latched = false; //< Was a report latched?
+            Report m_current;       //< Latched report
+            OSVR_VelocityState m_velocity; //< Velocity at latched report
+        };
+
+        std::mutex m_mutex; //< Guards all of the state below
+        OSVR_TimeValue m_now;
+        std::map<std::string, Trajectory> m_trajectories;
+        std::map<std::string, std::string> m_strings;
+    };
+
+} // namespace renderkit
+} // namespace osvr
@@ -27,8 +27,10 @@ Russ Taylor working through ReliaSolve.com for Sensics, Inc.
 // Internal Includes
 #include <osvr/RenderKit/Export.h>
 #include "MonoPointMeshTypes.h"
+#include "PointMeshSoA.h"
 #include "osvr_display_configuration.h"
 #include "RenderKitGraphicsTransforms.h"
+#include "PoseSource.h"
 
 // Library/third-party includes
 #include <osvr/ClientKit/ContextC.h>
@@ -41,10 +43,17 @@ Russ Taylor working through ReliaSolve.com for Sensics, Inc.
 #include <memory>
 #include <mutex>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
 
 namespace osvr {
 namespace renderkit {
 
+    class PosePredictor;
+
     //=========================================================================
     // Handles optimizing rendering given a description of the desired rendering
     // style and set of callback routines to handle rendering in various spaces.
@@ -66,12 +75,15 @@ namespace renderkit {
     /// and also #include the appropriate file that describes the class.
     class GraphicsLibraryD3D11;
     class GraphicsLibraryOpenGL;
+    class GraphicsLibrarySoftware;
     class GraphicsLibrary {
       public:
         GraphicsLibraryD3D11* D3D11 =
             nullptr; //< #include <osvr/RenderKit/GraphicsLibraryD3D11.h>
         GraphicsLibraryOpenGL* OpenGL =
             nullptr; //< #include <osvr/RenderKit/GraphicsLibraryOpenGL.h>
+        GraphicsLibrarySoftware* Software =
+            nullptr; //< #include <osvr/RenderKit/GraphicsLibrarySoftware.h>
     };
 
     /// @brief Used to pass Render Texture targets to be rendered
@@ -84,17 +96,21 @@ namespace renderkit {
     /// file that describes the class.
     class RenderBufferD3D11;
     class RenderBufferOpenGL;
+    class RenderBufferSoftware;
     class RenderBuffer {
       public:
         OSVR_RENDERMANAGER_EXPORT RenderBuffer() {
             D3D11 = nullptr;
             OpenGL = nullptr;
+            Software = nullptr;
         }
 
         RenderBufferD3D11*
             D3D11; //< #include <osvr/RenderKit/GraphicsLibraryD3D11.h>
         RenderBufferOpenGL*
             OpenGL; //< #include <osvr/RenderKit/GraphicsLibraryOpenGL.h>
+        RenderBufferSoftware*
+            Software; //< #include <osvr/RenderKit/GraphicsLibrarySoftware.h>
     };
 
     /// @brief Returns timing information about the rendering system
@@ -113,6 +129,61 @@ namespace renderkit {
         // presented.
     } RenderTimingInfo;
 
+    /// @brief Timing of one presented frame
+    ///
+    /// Recorded by RenderManager each time it presents a frame, whether
+    /// through Render() or PresentRenderBuffers().  Absolute times are on
+    /// the same clock as tracker reports; durations are CPU wall-clock
+    /// milliseconds.
+    class FrameTiming {
+      public:
+        static const size_t MAX_EYES = 4; //< Eyes past this are not timed
+
+        uint64_t frame = 0; //< Count of frames presented before this one
+        OSVR_TimeValue trackerSampleTime = {0, 0}; //< Timestamp of the head
+        // pose the frame was rendered with; (0,0) if not known
+        double getRenderInfoMS = 0; //< Time spent computing the RenderInfo
+        // the frame was rendered with
+        OSVR_TimeValue presentStart = {0, 0}; //< Presentation was requested
+        double busyWaitMS = 0; //< Time spent waiting to get close to vsync
+        double timeWarpMS = 0; //< Time spent computing time warp
+        size_t numEyes = 0;    //< Number of valid entries in presentEyeMS
+        std::array<double, MAX_EYES> presentEyeMS = {}; //< Time spent in
+        // PresentEye() for each eye
+        double presentMS = 0; //< Time from presentStart to swapComplete
+        OSVR_TimeValue swapComplete = {0, 0}; //< Presentation finished
+        bool missedVsync = false; //< Presentation finished more than half
+        // a display interval after the vsync that was next when time warp
+        // started, so the frame was shown at a later vsync than it aimed
+        // for; false if the display timing is not known
+    };
+
+    /// @brief Median, 99th percentile, and maximum of a set of durations
+    class TimingPercentiles {
+      public:
+        double p50 = 0;
+        double p99 = 0;
+        double max = 0;
+    };
+
+    /// @brief Summary of the frames recorded in the FrameTiming history
+    class FrameTimingStatistics {
+      public:
+        size_t frames = 0;       //< Number of frames summarized
+        /// Frames with missedVsync set: those that were shown at a later
+        /// vsync than the one they were presented for.  Gaps between
+        /// presents, such as an application presenting every other vsync
+        /// on purpose or pausing between frames, are not counted.
+        size_t missedVsyncs = 0;
+        TimingPercentiles getRenderInfoMS;
+        TimingPercentiles busyWaitMS;
+        TimingPercentiles timeWarpMS;
+        TimingPercentiles presentEyeMS; //< Over all eyes of all frames
+        TimingPercentiles presentMS;
+        TimingPercentiles trackerToSwapMS; //< Age of the head pose when
+        // the frame finished presenting, for frames where it is known
+    };
+
     /// @brief Describes the parameters for a display callback handler.
     ///
     /// Description of the type of a Display callback handler.  The user defines
@@ -376,6 +447,10 @@ namespace renderkit {
         /// modelview matrices will be in world space; the client is
         /// responsible for converting hand space and such into the
         /// correct coordinate system.
+        ///  NOTE: This does not wait for a PresentRenderBuffers() that
+        /// is in progress on another thread, so a pipelined application
+        /// can get the info for the next frame while the previous one is
+        /// waiting for vsync.
         ///  @return Returns an empty vector on failure.
         inline std::vector<RenderInfo> OSVR_RENDERMANAGER_EXPORT
         GetRenderInfo(const RenderParams& params = RenderParams()) {
@@ -421,6 +496,25 @@ namespace renderkit {
         RegisterRenderBuffers(const std::vector<RenderBuffer>& buffers,
                               bool appWillNotOverwriteBeforeNewPresent = false);
 
+        /// @brief Tells whether the depth buffers that go along with the
+        /// render buffers should be used by time warp.
+        ///
+        /// Time warp normally treats the whole scene as if it were at
+        /// m_timeWarpDepth, so head translation moves nearer and farther
+        /// objects by the wrong amount.  When this is enabled, each
+        /// presented buffer's depth is used to move each part of the image
+        /// by the amount its own depth calls for.  The depth must hold
+        /// window depth (0 at the near and 1 at the far clipping plane of
+        /// the projection in the RenderInfo the buffer was rendered with)
+        /// and have the same layout as the color buffer.  For OpenGL,
+        /// depthStencilBufferName must name a 2D depth texture (not a
+        /// renderbuffer), which is checked when the buffers are
+        /// registered; for the software renderer, fill in
+        /// RenderBufferSoftware::depthBuffer.
+        /// Buffers without depth, and graphics libraries that do not yet
+        /// support this (Direct3D), keep using the single assumed depth.
+        void OSVR_RENDERMANAGER_EXPORT SetTimeWarpUsesDepth(bool useDepth);
+
         /// @brief Sends texture buffers needed to render all eyes and displays.
         ///
         /// Sends a set of textures appropriate for the rendering engine being
@@ -473,6 +567,66 @@ namespace renderkit {
                                      std::vector<OSVR_ViewportDescription>(),
                              bool flipInY = false);
 
+        //=============================================================
+        // Pipelined version of GetRenderInfo()/PresentRenderBuffers().
+        // Each frame is started with BeginFrame(), which latches the
+        // RenderInfo for that frame and returns a token naming it.  The
+        // frame is finished by passing the token to PresentFrame() (or
+        // to CancelFrame() if the application drops it), which presents
+        // using the poses that were latched for that frame, so that time
+        // warp corrects from exactly the poses the frame was rendered
+        // with.  Up to MAX_FRAMES_IN_FLIGHT frames may be begun before
+        // the first of them is finished, so that an engine can simulate
+        // and record one frame while the GPU renders the ones before it.
+
+        /// Identifies a frame begun with BeginFrame().  Zero is never used.
+        typedef uint64_t FrameToken;
+
+        /// Number of frames that can be begun without being finished.
+        static const size_t MAX_FRAMES_IN_FLIGHT = 3;
+
+        /// @brief Start a frame, latching the RenderInfo for it.
+        ///
+        /// Like LatchRenderInfo(), this does not wait for a present that
+        /// is in progress on another thread.  Any pointers in params must
+        /// remain valid until the frame has been presented or cancelled.
+        ///  @param[out] tokenOut Token naming the frame.
+        ///  @return The number of RenderInfos latched for the frame, one
+        /// per surface, or 0 on failure (including when
+        /// MAX_FRAMES_IN_FLIGHT frames are already in flight).
+        size_t OSVR_RENDERMANAGER_EXPORT
+        BeginFrame(FrameToken& tokenOut,
+                   const RenderParams& params = RenderParams());
+
+        /// @brief Get a RenderInfo latched by BeginFrame() for a frame.
+        /// @return The RenderInfo, or a default-constructed one if the
+        /// frame is not in flight or the index is out of range.
+        RenderInfo OSVR_RENDERMANAGER_EXPORT
+        GetFrameRenderInfo(FrameToken token, size_t index);
+
+        /// @brief Present the buffers rendered for a frame and finish it.
+        ///
+        /// The buffers, viewports and flipInY are as described for
+        /// PresentRenderBuffers(); the RenderInfo and RenderParams are
+        /// the ones latched by BeginFrame().  Frames must be presented in
+        /// the order they were begun; a frame that is to be skipped must
+        /// be cancelled before the ones after it can be presented.  The
+        /// frame is finished even if presentation fails.
+        ///  @return True on success, false on failure or if the frame is
+        /// not in flight.
+        bool OSVR_RENDERMANAGER_EXPORT
+        PresentFrame(FrameToken token, const std::vector<RenderBuffer>& buffers,
+                     const std::vector<OSVR_ViewportDescription>&
+                         normalizedCroppingViewports =
+                             std::vector<OSVR_ViewportDescription>(),
+                     bool flipInY = false);
+
+        /// @brief Finish a frame without presenting it.
+        /// @return False if the frame is not in flight or is being
+        /// presented by PresentFrame() on another thread (in which case
+        /// PresentFrame() finishes it).
+        bool OSVR_RENDERMANAGER_EXPORT CancelFrame(FrameToken token);
+
         ///-------------------------------------------------------------
         /// @brief Get rendering-time statistics
         ///
@@ -492,6 +646,37 @@ namespace renderkit {
             return false;
         }
 
+        /// Number of frames of FrameTiming history kept.
+        static const size_t FRAME_TIMING_HISTORY = 512;
+
+        /// @brief Get timing records for the most recently presented frames
+        ///
+        /// Fills in up to FRAME_TIMING_HISTORY records, oldest first.
+        /// Unlike the other public methods, this does not lock the
+        /// RenderManager: it reads a lock-free ring buffer, so it can be
+        /// called from a monitoring thread without stalling rendering.
+        /// @return Number of records returned.
+        size_t OSVR_RENDERMANAGER_EXPORT
+        GetFrameTimings(std::vector<FrameTiming>& timingsOut);
+
+        /// @brief Summarize the recorded frame timing
+        ///
+        /// Like GetFrameTimings(), this does not block rendering.
+        /// @return False (with default statistics) if no frames have been
+        /// presented yet.
+        bool OSVR_RENDERMANAGER_EXPORT
+        GetFrameTimingStatistics(FrameTimingStatistics& statsOut);
+
+        /// @brief Write the recorded frame-phase trace as Chrome trace-event
+        /// JSON, which can be loaded into chrome://tracing or Perfetto.
+        ///
+        /// The trace covers all RenderManagers and threads in the process,
+        /// including the asynchronous time warp thread.  Events are only
+        /// recorded when RenderManager was configured with
+        /// RM_ENABLE_TRACING; otherwise an empty trace is written.
+        /// @return False if tracing was not compiled in or the write failed.
+        static bool OSVR_RENDERMANAGER_EXPORT WriteTrace(std::ostream& out);
+
         ///-------------------------------------------------------------
         /// Class that stores one of a set of possible distortion parameters.
         /// The type of parameters is determined by the m_type, and which
@@ -571,6 +756,7 @@ namespace renderkit {
                 m_distortionPolynomialGreen = {0, 1};
                 m_distortionPolynomialBlue = {0, 1};
                 m_desiredTriangles = 2;
+                m_meshTolerancePixels = 0;
             };
 
             // Parameters valid for all mesh types
@@ -578,6 +764,10 @@ namespace renderkit {
             // below are valid.
             size_t m_desiredTriangles; //< How many triangles would we like in
             // the mesh?
+            float m_meshTolerancePixels; //< If > 0, SQUARE meshes are
+            // refined adaptively until their texture coordinates are within
+            // this many pixels of the true distortion, using no more than
+            // m_desiredTriangles worth of resolution anywhere.
 
             // Parameters valid for a mesh of type mono_point_samples
             MonoPointDistortionMeshDescriptions m_monoPointSamples;
@@ -630,8 +820,15 @@ namespace renderkit {
                 m_enableTimeWarp = true;
                 m_asynchronousTimeWarp = false;
                 m_maxMSBeforeVsyncTimeWarp = 3.0f;
+                m_sleepBeforeVsync = true;
+                m_rollingShutterTimeWarp = false;
+                m_scanOutMS = 0;
+                m_timeWarpDepth = 2.0f;
 
                 m_distortionCorrection = false;
+                m_distortionMethod = MeshDistortion;
+                m_distortionLookupResolution = 512;
+                m_distortionMeshCacheDirectory = "";
 
                 m_clientPredictionEnabled = false;
                 m_clientPredictionLocalTimeOverride = false;
@@ -645,6 +842,35 @@ namespace renderkit {
                 TwoSeventy
             } Display_Rotation;
 
+            /// How distortion correction is applied when presenting.
+            typedef enum {
+                MeshDistortion,     //< Render a precomputed distortion mesh
+                AnalyticDistortion, //< Evaluate rgb_symmetric_polynomials
+                                    /// distortion per pixel in a shader
+                LookupTextureDistortion //< Look point-sample distortion up
+                                        /// in a precomputed texture
+            } Distortion_Method;
+
+            /// How the pose of a tracked interface is predicted.
+            typedef enum {
+                ConstantVelocityPrediction, //< Integrate reported velocity
+                ConstantAccelerationPrediction, //< Integrate reported
+                                                /// velocity and acceleration
+                AlphaBetaPrediction //< Estimate velocity from the pose
+                                    /// history with an alpha-beta filter
+            } Prediction_Model;
+
+            /// Prediction model and its settings for one interface.
+            class PredictionModel {
+              public:
+                PredictionModel()
+                    : m_model(ConstantVelocityPrediction), m_alpha(0.5),
+                      m_beta(0.1) {}
+                Prediction_Model m_model;
+                double m_alpha; //< AlphaBetaPrediction pose gain
+                double m_beta;  //< AlphaBetaPrediction velocity gain
+            };
+
             bool m_directMode; //< Should we render using DirectMode?
 
             void addCandidatePNPID(const char* pnpid);
@@ -703,6 +929,20 @@ namespace renderkit {
             std::vector<DistortionParameters>
                 m_distortionParameters; //< One set per eye x display
 
+            /// Which way to apply distortion correction.  Rendering
+            /// libraries that do not support a method, or distortion
+            /// parameters that it cannot handle, fall back to a mesh.
+            Distortion_Method m_distortionMethod;
+
+            /// Width and height of each distortion lookup texture baked for
+            /// the LookupTextureDistortion method.
+            size_t m_distortionLookupResolution;
+
+            /// Directory in which to keep computed distortion meshes between
+            /// runs, so that they are read back rather than recomputed when
+            /// the parameters have not changed.  Empty disables the cache.
+            std::string m_distortionMeshCacheDirectory;
+
             bool m_enableTimeWarp;       //< Use time warp?
             bool m_asynchronousTimeWarp; //< Use Asynchronous time warp?
                                          //(requires enable)
@@ -711,17 +951,48 @@ namespace renderkit {
             /// timewarp (requires enable)
             float m_maxMSBeforeVsyncTimeWarp;
 
+            /// Sleep for most of the wait until m_maxMSBeforeVsyncTimeWarp
+            /// before vsync, only busy-waiting for the last part of it,
+            /// rather than busy-waiting the whole time.
+            bool m_sleepBeforeVsync;
+
+            /// Time warp each part of an eye to the pose predicted for when
+            /// it is scanned out, rather than the whole eye to when its
+            /// first line is.  The display is assumed to scan out from the
+            /// top to the bottom of the image it is sent.  Only has an
+            /// effect with time warp and client-side prediction enabled.
+            bool m_rollingShutterTimeWarp;
+
+            /// How long the display takes to scan out from its top line to
+            /// its bottom line, for m_rollingShutterTimeWarp.  Zero uses the
+            /// display interval from GetTimingInfo().
+            float m_scanOutMS;
+
+            /// Distance in meters at which time warp assumes the scene to
+            /// be, for buffers that have no depth to go by.  Translation is
+            /// only corrected exactly for objects at this distance.
+            float m_timeWarpDepth;
+
             /// Prediction settings.
             bool m_clientPredictionEnabled; //< Use client-side prediction?
             /// Static Delay + Delay from present to eye start
             std::vector<float> m_eyeDelaysMS;
             bool m_clientPredictionLocalTimeOverride;  //< Override tracker timestamp?
+            /// Prediction model for each interface path.  The head uses
+            /// ConstantVelocityPrediction unless it is listed here; the
+            /// spaces of render callbacks are only predicted if they are.
+            std::map<std::string, PredictionModel> m_predictionModels;
 
             OSVRDisplayConfiguration
                 m_displayConfiguration; //< Display configuration
 
             std::string m_roomFromHeadName; //< Transform to use for head space
 
+            /// Where to read poses and the time from instead of the OSVR
+            /// context, if the pointer is non-NULL.  Filled in by the
+            /// createRenderManager() overload that takes a PoseSource.
+            std::shared_ptr<PoseSource> m_poseSource;
+
             /// Graphics library (device/context) to use instead of creating one
             /// if the pointer is non-NULL.  Note that the appropriate context
             /// pointer for the m_renderLibrary must be filled in.
@@ -766,6 +1037,23 @@ namespace renderkit {
                 distort //< Distortion parameters
             );
 
+        //=============================================================
+        // Recompute only the texture coordinates of the existing distortion
+        // meshes using new parameters, keeping their vertex positions and
+        // (where the rendering library allows it) their buffers.  This is
+        // much cheaper than UpdateDistortionMeshes() and is meant for tools
+        // that adjust the distortion parameters interactively, such as
+        // calibration.  Falls back to rebuilding the meshes if they do not
+        // exist yet or if their layout would change.  Never reads from or
+        // writes to the distortion mesh cache.
+        virtual OSVR_RENDERMANAGER_EXPORT bool
+        UpdateDistortionMeshTextureCoordinates(
+            DistortionMeshType type //< Type of mesh to produce
+            ,
+            std::vector<DistortionParameters> const&
+                distort //< Distortion parameters
+            );
+
         //=============================================================
         // Updates the internal "room to world" transformation (applied to all
         // tracker data for this client context instance) based on the user's
@@ -793,9 +1081,23 @@ namespace renderkit {
         /// Mutex to provide thread safety to this class and its
         /// subclasses.  NOTE: All subclasses must lock this mutex
         /// for the duration of all public methods besides their
-        /// constructor.
+        /// constructor, except for LatchRenderInfo() and GetRenderInfo(),
+        /// which only lock m_renderInfoMutex so that they can run while
+        /// another thread is presenting.
         std::mutex m_mutex;
 
+        /// Mutex guarding the tracker state (the OSVR context or pose
+        /// source, m_roomFromHead and m_roomFromHeadTimestamp) and the
+        /// latched render info.  GetRenderInfoInternal(),
+        /// UpdateTrackingState() and ConstructModelView() must be called
+        /// with it locked.  Code that needs both mutexes must lock m_mutex
+        /// first.  It is held only while poses are read and updated, never
+        /// while waiting for vsync or presenting, so a pipelined
+        /// application can get the RenderInfo for the next frame while the
+        /// current one is being presented.  Adding and removing callbacks
+        /// locks both, so holding either one keeps m_callbacks stable.
+        std::mutex m_renderInfoMutex;
+
         /// Internal versions of functions that require a mutex, so that
         /// we can call them from functions with a mutex without blocking.
         virtual std::vector<RenderInfo>
@@ -821,12 +1123,55 @@ namespace renderkit {
                 distort //< Distortion parameters
             ) = 0;
 
+        /// Default implementation rebuilds the meshes completely; derived
+        /// classes override it to update their existing buffers in place.
+        virtual bool UpdateDistortionMeshTextureCoordinatesInternal(
+            DistortionMeshType type //< Type of mesh to produce
+            ,
+            std::vector<DistortionParameters> const&
+                distort //< Distortion parameters
+            );
+
         std::vector<RenderInfo>
             m_latchedRenderInfo; //< Stores vector of latched RenderInfo
 
-        /// OSVR context to use.
+        /// OSVR context to use.  NULL when m_params.m_poseSource is
+        /// used instead.
         OSVR_ClientContext m_context;
 
+        //=============================================================
+        // Read the tracker state, from m_params.m_poseSource if there is
+        // one and from the OSVR context otherwise.  Those that update or
+        // read poses are called with m_renderInfoMutex held.
+
+        /// @brief Bring the tracker state up to date.
+        /// @return False if the update failed.
+        bool UpdateTrackingState();
+
+        /// @brief Read the current time on the tracker clock.
+        void GetTrackingTimeNow(OSVR_TimeValue& now);
+
+        /// @brief Read the most-recent head pose.
+        /// @return False if there is none.
+        bool GetRoomFromHeadState(OSVR_TimeValue& timestamp,
+                                  OSVR_PoseState& pose);
+
+        /// @brief Read the most-recent velocity and acceleration for a
+        /// path, or for its interface when reading from the OSVR context.
+        /// The valid flags are cleared for whatever is not reported.
+        void GetMotionState(const std::string& path,
+                            OSVR_ClientInterface iface,
+                            OSVR_VelocityState& velocity,
+                            OSVR_AccelerationState& acceleration);
+
+        /// @brief Is the space for a render callback world space?
+        bool IsWorldSpace(size_t whichSpace);
+
+        /// @brief Read the most-recent pose for a render callback's space.
+        /// @return False if there is none.
+        bool GetSpaceState(size_t whichSpace, OSVR_TimeValue& timestamp,
+                           OSVR_PoseState& pose);
+
         // Variables describing the desired characteristics of the
         // rendering, parsed from the display configuration file
         // (vendor, resolution, etc.) and from the pipeline configuration
@@ -835,9 +1180,97 @@ namespace renderkit {
         ConstructorParameters m_params;
 
         /// Head space to use, or nullptr in case of none (which should
-        /// be checked for, but is sort of an error).
+        /// be checked for, but is sort of an error).  Also nullptr when
+        /// poses come from m_params.m_poseSource, which is asked for
+        /// m_roomFromHeadPath instead.
         OSVR_ClientInterface m_roomFromHeadInterface;
+        std::string m_roomFromHeadPath;
         OSVR_PoseState m_roomFromHead; //< Transform to use for head space
+        OSVR_TimeValue m_roomFromHeadTimestamp; //< When m_roomFromHead was
+        // reported by the tracker; (0,0) if it was not read from a tracker
+
+        /// Predictor for each interface path that has been predicted, or
+        /// nullptr for one that is not to be predicted; created on first
+        /// use from m_params.m_predictionModels.  Guarded by
+        /// m_renderInfoMutex.
+        std::map<std::string, std::shared_ptr<PosePredictor> >
+            m_posePredictors;
+
+        /// When the poses being computed are to be predicted to.
+        typedef enum {
+            PredictToPresent, //< When a newly-rendered frame is presented
+            PredictToScanout, //< When each eye's first line is scanned out
+            PredictToScanoutEnd //< When each eye's last line is scanned out
+        } Prediction_Target;
+
+        /// Set to one of the scan-out targets while the poses for time warp
+        /// are computed, and PredictToPresent otherwise.  Guarded by
+        /// m_renderInfoMutex.
+        Prediction_Target m_predictionTarget;
+
+        //=============================================================
+        // Per-frame timing history, filled in by
+        // PresentRenderBuffersInternal() and read by GetFrameTimings().
+        // It is a ring buffer of seqlock-protected slots so that it
+        // can be read without taking m_mutex: each slot's sequence
+        // number is odd while it is being written, and is 2*(n+1)
+        // once it holds frame n.
+
+        /// One entry in the frame-timing ring buffer.
+        class FrameTimingSlot {
+          public:
+            std::atomic<uint64_t> m_sequence; //< Which frame, see above
+            FrameTiming m_timing;
+        };
+        std::array<FrameTimingSlot, FRAME_TIMING_HISTORY> m_frameTimings;
+        std::atomic<uint64_t> m_framesTimed; //< Frames recorded so far
+
+        /// Store the timing for the next frame into the ring buffer,
+        /// filling in its frame number.  Only one thread may call this
+        /// at a time; PresentRenderBuffersInternal() is guarded by m_mutex.
+        void RecordFrameTiming(FrameTiming& timing);
+
+        /// State of a frame begun with BeginFrame() and not yet finished.
+        class FrameInFlight {
+          public:
+            FrameToken m_token = 0; //< Zero when the slot is not in use
+            RenderParams m_params;
+            std::vector<RenderInfo> m_renderInfo;
+            double m_getRenderInfoMS = 0;
+            OSVR_TimeValue m_trackerSampleTime = {0, 0};
+        };
+        // Guarded by m_renderInfoMutex.
+        std::array<FrameInFlight, MAX_FRAMES_IN_FLIGHT> m_framesInFlight;
+        FrameToken m_lastFrameToken; //< Token of the latest frame begun
+        FrameToken m_presentingToken; //< Frame PresentFrame() is presenting,
+        // which cannot be cancelled; zero if none
+
+        /// Free the slot of a frame in flight.  Called with
+        /// m_renderInfoMutex held.
+        /// @param caller Name of the public method, for error messages.
+        /// @return False if the frame is not in flight.
+        bool FinishFrameInternal(FrameToken token, const char* caller);
+
+        /// Frame being presented by PresentFrame(), whose timing is used
+        /// in place of the latched RenderInfo's; nullptr otherwise.
+        /// Guarded by m_mutex.
+        const FrameInFlight* m_presentingFrame;
+
+        // Guarded by m_renderInfoMutex.
+        double m_getRenderInfoMS; //< Time to compute the latched RenderInfo
+        OSVR_TimeValue m_getRenderInfoTrackerTime; //< Head pose timestamp
+        // used for the latched RenderInfo
+
+        /// @brief Sleep for most of the time until we need to stop
+        /// waiting for vsync, leaving the rest to be busy-waited.
+        ///
+        /// How early to wake up is tuned from how late the previous
+        /// sleeps woke up, so that timers with coarse resolution end up
+        /// not sleeping at all rather than missing vsync.
+        void SleepBeforeVsync(double msUntilDone //< Time until we're done
+                              );
+        double m_vsyncWakeLatenessMS; //< Recent worst late wakeup, decayed
+        // each frame
 
         /// @brief Stores display callback information
         ///
@@ -987,12 +1420,45 @@ namespace renderkit {
         typedef struct { float data[16]; } matrix16;
         std::vector<matrix16> m_asynchronousTimeWarps;
 
+        /// Asynchronous time warp matrices for the bottom line of each eye
+        /// when m_rollingShutterTimeWarp is in effect, in which case
+        /// m_asynchronousTimeWarps holds those for the top line; empty
+        /// otherwise.
+        std::vector<matrix16> m_asynchronousTimeWarpsEnd;
+
+        /// What is needed to correct an eye's time warp for the depth of
+        /// each part of the image, rather than assuming it is all at the
+        /// depth the time warp matrix was computed for.  The warped texture
+        /// coordinate of a point at depth d moves by
+        /// (1/d - m_inverseAssumedDepth) * m_parallax.
+        class TimeWarpDepth {
+          public:
+            float m_parallax[2]; //< Texture-coordinate shift per 1/meter
+            float m_inverseAssumedDepth; //< 1/depth the ATW matrix assumes
+            float m_nearClip; //< Clipping planes of the projection used to
+            float m_farClip;  //  render, to convert depth to meters
+        };
+
+        /// @brief Compute m_timeWarpDepths from the same information as
+        /// ComputeAsynchronousTimeWarps().  The parallax comes from the
+        /// translation of the head between the two poses.
+        ///  @return True on success, false (with empty vector) on failure.
+        bool
+        ComputeTimeWarpDepths(const std::vector<RenderInfo>& usedRenderInfo,
+                              const std::vector<RenderInfo>& currentRenderInfo,
+                              float assumedDepth);
+
+        /// One per eye when the time warp is using depth buffers, empty
+        /// otherwise.
+        std::vector<TimeWarpDepth> m_timeWarpDepths;
+
         /// Holds a pointer to the graphics library state.
         GraphicsLibrary m_library; //!< Graphics library to use
         RenderBuffer m_buffers;    //!< Buffers to use to render into.
 
         bool m_renderBuffersRegistered; //!< Keeps track of whether we have
         //! registered buffers
+        bool m_timeWarpUsesDepth; //!< Set by SetTimeWarpUsesDepth()
 
         //=============================================================
         // These methods are helper methods for the Render* callback
@@ -1064,6 +1530,39 @@ namespace renderkit {
                 eyeFromSpace //< Output info needed to make ModelView
             );
 
+        /// @brief How far past a tracker report made at reportTime to
+        /// predict the poses used to render an eye: the time since the
+        /// report plus the time until the eye is presented, or until it is
+        /// next scanned out as set by m_predictionTarget.
+        double PredictionIntervalSec(size_t whichEye,
+                                     const OSVR_TimeValue& reportTime);
+
+        /// @brief How long it takes to scan out an eye from its top line to
+        /// its bottom line: the part of m_params.m_scanOutMS (or of the
+        /// display interval) spent on the lines its viewport covers.
+        /// @return 0 if that is not known.
+        double EyeScanOutMS(size_t whichEye);
+
+        /// @brief Replace a pose just read from a path (or its interface)
+        /// with the one predicted for when an eye will be presented, using
+        /// the path's predictor.  Called with m_renderInfoMutex held.
+        /// @return False (with pose unchanged) if the path is not predicted.
+        bool PredictPose(const std::string& path, OSVR_ClientInterface iface,
+                         const OSVR_TimeValue& timestamp, size_t whichEye,
+                         OSVR_PoseState& pose);
+
+        /// @brief Predict a future pose based on initial pose and velocity.
+        ///  Integrates whichever of the linear and angular velocities are
+        /// marked valid over the prediction interval, in constant time
+        /// however long the interval.  poseOut may be the same structure
+        /// as poseIn.
+        static void PredictFuturePose(
+            const OSVR_PoseState& poseIn //< Pose to predict from
+            , const OSVR_VelocityState& vel //< Velocity to integrate
+            , double predictionIntervalSec //< How far ahead to predict
+            , OSVR_PoseState& poseOut //< Predicted pose
+            );
+
         /// @brief Compute in-display rotations/flip matrix.
         ///  Assumes that it is starting in a world-space quad render that has
         /// (-1,-1) at the lower left corner of the screen and (1,1) at the
@@ -1107,95 +1606,102 @@ namespace renderkit {
         /// @brief Spatial-calculation-acceleration structure.
         ///  This class makes a spatial data structure that makes it faster
         /// to determine the interpolated coordinates between vertices
-        /// in an unstructured mesh.  It pre-fills in a small list of the
-        /// nearest unstructured vertices to each location in a regular
-        /// grid and then uses these to more-rapidly identify the nearest
-        /// points when a large number of interpolations need to be done.
+        /// in an unstructured mesh.  It builds a 2D k-d tree over the
+        /// input locations of the unstructured vertices once, and then
+        /// uses it to find the nearest points in O(log n) time without
+        /// allocating memory when a large number of interpolations need
+        /// to be done.
         class UnstructuredMeshInterpolator {
         public:
           /// Constructor, provided the list of points it is to use.
           /// Fills in the acceleration structure so that calls to
           /// interpolate will be faster.
-          /// @param points Unstructured mesh points to use for interpolation
-          /// @param numSamplesX Optional parameter describing the size of
-          ///        the acceleration mesh structure.
-          /// @param numSamplesY Optional parameter describing the size of
-          ///        the acceleration mesh structure.
+          /// @param points Unstructured mesh points to use for
+          ///        interpolation.  These are copied into
+          ///        structure-of-arrays storage in k-d tree order.
           UnstructuredMeshInterpolator(
-            const MonoPointDistortionMeshDescription& points,
-            int numSamplesX = 20,
-            int numSamplesY = 20
+            const MonoPointDistortionMeshDescription& points
           );
 
           /// Find an interpolation of the value based on the three
           /// nearest non-collinear points in the unstructured mesh.
-          /// Attempts to use the spatial acceleration structure to
-          /// speed up the query if it can.
+          /// Uses the spatial acceleration structure to speed up the
+          /// query.
           /// @param xN Normalized x coordinate
           /// @param yN Normalized y coordinate
           /// @return Normalized coordinate interpolated from
           ///  unstructured distortion map mesh.
-          Float2 interpolateNearestPoints(float xN, float yN);
+          Float2 interpolateNearestPoints(float xN, float yN) const;
 
         protected:
+          /// Number of nearest neighbors gathered from the tree for each
+          /// query.  The three points used for interpolation are picked
+          /// from among these; the whole mesh is only searched if these
+          /// are all collinear.
+          static const size_t MAX_NEIGHBORS = 8;
+
+          /// Subtrees with at most this many points are not split
+          /// further; their points are contiguous in m_points and are
+          /// checked with a single (vectorizable) distance loop.
+          static const size_t LEAF_SIZE = 16;
+
+          /// Fixed-capacity list of the nearest points found so far,
+          /// sorted by increasing squared distance (then by index, so
+          /// that ties resolve the same way every time).
+          class NeighborList {
+          public:
+            /// Insert a point if it is closer than the farthest one
+            /// kept so far (or if the list is not yet full).
+            void insert(double dist2, size_t index);
+            bool full() const { return m_count == MAX_NEIGHBORS; }
+            /// Squared distance to the farthest point kept.
+            double worst() const { return m_dist2[m_count - 1]; }
+            size_t size() const { return m_count; }
+            size_t operator[](size_t i) const { return m_index[i]; }
+
+          private:
+            std::array<double, MAX_NEIGHBORS> m_dist2;
+            std::array<size_t, MAX_NEIGHBORS> m_index;
+            size_t m_count = 0;
+          };
 
-          /// Return the three nearest non-collinear points in the
-          /// unstructured mesh description passed in.  If there are
-          /// not three such points, can return fewer.
+          /// Recursively sort the entries of order in [begin, end) so
+          /// that they form a balanced k-d tree whose root is at the
+          /// middle of the range, splitting on X at even depths and Y at
+          /// odd.
+          void buildTree(const MonoPointDistortionMeshDescription& points,
+                         std::vector<size_t>& order, size_t begin,
+                         size_t end, unsigned depth);
+
+          /// Fill dist2Out with the squared distances from (x,y) to the
+          /// count points starting at index begin in m_points.
+          void squaredDistances(double x, double y, size_t begin,
+                                size_t count, double* dist2Out) const;
+
+          /// Recursively add the points from the [begin, end) subtree
+          /// that are among the nearest to (x,y) to the list.
+          void findNearest(double x, double y, size_t begin, size_t end,
+                           unsigned depth, NeighborList& nearest) const;
+
+          /// Find the indices of the three nearest non-collinear points
+          /// in the unstructured mesh.  If there are not three such
+          /// points, can return fewer.
           /// @param xN Normalized texture coordinate in X
           /// @param yN Normalized texture coordinate in Y
-          /// @param points Vector of points to search in.
-          /// @return vector of up to three points.
-          MonoPointDistortionMeshDescription getNearestPoints(
-            float xN, float yN,
-            const MonoPointDistortionMeshDescription &points);
-
-          const MonoPointDistortionMeshDescription m_points;
-
-          /// Structure to store points from the m_points array
-          /// in a regular mesh covering the range of
-          /// normalized texture coordinates from (0,0) to (1,1).
-          ///  It is filled by the constructor and is used by the
-          /// interpolator to hopefully provide a fast way to get
-          /// a list of the three nearest non-collinear points.
-          /// If there are not three such points here, the acceleration
-          /// has failed for a location and the full point list is
-          /// searched.
-          std::vector<    // Range in X
-            std::vector<  // Range in Y
-              MonoPointDistortionMeshDescription //< Points
-            >
-          > m_grid;
-          int m_numSamplesX = 0; //< Size of the grid in X
-          int m_numSamplesY = 0; //< Size of the grid in Y
-
-          // Return the index of the closest grid point to a
-          // specified location.  Clamps to the range of
-          // the grid even for points outside it.
-          /// @param xN [in] Normalized X coordinate
-          /// @param yN [in] Normalized Y coordinate
-          /// @param xIndexOut [out] Index of nearest grid point
-          /// @param yIndexOut [out] Index of nearest grid point
-          /// @return True on success, false on no samples in X,Y
-          inline bool getIndex(double xN, double yN,
-            int &xIndexOut, int &yIndexOut) {
-            if (m_numSamplesX * m_numSamplesY == 0) {
-              return false;
-            }
-            int xIndex = static_cast<int>(0.5 + xN * (m_numSamplesX - 1));
-            if (xIndex < 0) { xIndex = 0; }
-            if (xIndex >= m_numSamplesX) { xIndex = m_numSamplesX - 1; }
-            int yIndex = static_cast<int>(0.5 + yN * (m_numSamplesY - 1));
-            if (yIndex < 0) { yIndex = 0; }
-            if (yIndex >= m_numSamplesY) { yIndex = m_numSamplesY - 1; }
-            xIndexOut = xIndex;
-            yIndexOut = yIndex;
-            return true;
-          };
+          /// @param indicesOut [out] Indices of up to three points.
+          /// @return Number of indices filled in.
+          size_t getNearestPoints(float xN, float yN,
+                                  std::array<size_t, 3>& indicesOut) const;
+
+          /// The mesh points, arranged as an implicit balanced k-d tree
+          /// on the input locations.  The root of each subtree is the
+          /// middle element of its range.  It is filled by the
+          /// constructor and never changes after that.
+          MonoPointDistortionMeshSoA m_points;
         };
 
         /// Vector of interpolators constructed by the
-        /// ComputeDistortionMesh() function to be used by the
+        /// ComputeDistortionMeshIndexed() function to be used by the
         /// DistortionCorrectTextureCoordinate() function based on
         /// the number of meshes needed (1 per color, the mesh is
         /// computed per eye so we only need to keep those around
@@ -1219,7 +1725,7 @@ namespace renderkit {
         Float2 DistortionCorrectTextureCoordinate(
             size_t eye //< Eye this relates to
             , Float2 const& inCoords //< Coordinates to modify
-            , DistortionParameters distort //< Distortion parameters
+            , DistortionParameters const& distort //< Distortion parameters
             , size_t color //< 0 = red, 1 = green, 2 = blue
             );
 
@@ -1243,6 +1749,14 @@ namespace renderkit {
             Float2 m_texBlue;         //< U,V
         };
 
+        /// Describes an indexed mesh: a set of unique vertices plus a list
+        /// of indices into it, three per triangle.
+        class DistortionMesh {
+          public:
+            std::vector<DistortionMeshVertex> m_vertices; //< Unique vertices
+            std::vector<uint32_t> m_indices; //< Sets of 3 vertex indices
+        };
+
         /// @brief Constructs a mesh to correct lens distortions
         ///  Constructs a set of vertices in the range (-1,-1) to (1,1),
         /// with (-1,-1) at the lower-left corner and (1,1) at the upper
@@ -1257,16 +1771,101 @@ namespace renderkit {
         /// will be in the subset of the range (0,0) to (1,1) that falls
         /// onto the screen after distortion is applied.  There is one
         /// pair for red, one for green, and one for blue.
-        ///  There are sets of 3 vertices produced, suitable for sending
-        /// as a set of triangles to the rendering system.
-        ///  @todo Consider switching to an indexed-based mesh.
+        ///  Each vertex is produced once and is shared by all of the
+        /// triangles that use it, with the triangles described by sets of
+        /// 3 indices, suitable for sending to the rendering system as an
+        /// indexed triangle list.
+        ///  The distortion parameters are only referenced, never copied,
+        /// so the point-sample meshes are shared by every lookup made
+        /// while the mesh is being built.
+        ///  Square meshes are built in bands of columns on multiple
+        /// threads; the result is the same as building on one thread.
+        ///  Unless the mesh is adaptive (m_meshTolerancePixels > 0), the
+        /// vertex positions and indices depend only on the mesh type and
+        /// m_desiredTriangles, never on the distortion itself.
+        ///  @return Indexed mesh, empty on failure.
+        DistortionMesh ComputeDistortionMeshIndexed(
+            size_t eye //< Which eye?
+            , DistortionMeshType type //< Type of mesh to produce
+            , DistortionParameters const& distort //< Distortion parameters
+            , bool useCache = true //< Use the persistent mesh cache?
+            );
+
+        /// @brief Constructs an adaptively-refined square mesh
+        ///  Starts from a coarse grid and splits each quad into four
+        /// until linear interpolation across its two triangles matches
+        /// DistortionCorrectTextureCoordinate() to within
+        /// distort.m_meshTolerancePixels at its edge midpoints and center,
+        /// or until it reaches the size of the quads in a uniform mesh
+        /// with maxQuadsPerSide (rounded up to a power of two).  Quads
+        /// that border smaller ones are drawn as triangle fans around
+        /// their centers so that the mesh has no cracks.
+        ///  Used by ComputeDistortionMeshIndexed(), which must have set
+        /// up the interpolators for the eye before calling it.
+        ///  @return True on success, false on failure.
+        bool ComputeAdaptiveDistortionMesh(
+            size_t eye //< Which eye?
+            , DistortionParameters const& distort //< Distortion parameters
+            , int maxQuadsPerSide //< Finest resolution to refine to
+            , DistortionMesh& meshOut //< Filled in with the mesh
+            );
+
+        /// @brief Constructs a non-indexed mesh to correct lens distortions
+        ///  Produces the same mesh as ComputeDistortionMeshIndexed(), but
+        /// with the vertices repeated for each triangle that uses them, as
+        /// sets of 3 vertices suitable for sending as a set of triangles to
+        /// the rendering system.
         ///  @return Vector of triangles (sets of 3 vertices), empty on failure.
         std::vector<DistortionMeshVertex> ComputeDistortionMesh(
             size_t eye //< Which eye?
             , DistortionMeshType type //< Type of mesh to produce
-            , DistortionParameters distort //< Distortion parameters
+            , DistortionParameters const& distort //< Distortion parameters
+            );
+
+        /// @brief Bake point-sample distortion into a lookup table
+        ///  Fills tableOut with resolution x resolution pairs of distorted
+        /// texture coordinates, the same values that
+        /// DistortionCorrectTextureCoordinate() returns, sampled at texel
+        /// centers across the Presented texture.  Rows run from the bottom
+        /// (v = 0) to the top, as OpenGL expects for texture uploads.
+        ///  Only mono_point_samples and rgb_point_samples are handled.
+        /// This builds its own interpolator and touches no member state,
+        /// so it can be run on a background thread.
+        ///  @return True on success, false (with tableOut cleared) on
+        /// failure.
+        static bool ComputeDistortionLookupTable(
+            size_t eye //< Which eye?
+            , size_t color //< 0 = red, 1 = green, 2 = blue
+            , DistortionParameters const& distort //< Distortion parameters
+            , float overfillFactor //< m_params.m_renderOverfillFactor
+            , size_t resolution //< Width and height of the table
+            , std::vector<float>& tableOut //< Filled in with u,v pairs
             );
 
+        //=============================================================
+        // Persistent cache of computed distortion meshes, used by
+        // ComputeDistortionMeshIndexed() when
+        // m_params.m_distortionMeshCacheDirectory is not empty.  Each
+        // mesh is stored in its own binary file named by a hash of
+        // everything that affects it.
+
+        /// @brief Hash everything that affects the mesh for an eye
+        uint64_t DistortionMeshCacheKey(size_t eye, DistortionMeshType type,
+                                        DistortionParameters const& distort);
+
+        /// @brief Name of the cache file for a given key
+        std::string DistortionMeshCachePath(uint64_t key);
+
+        /// @brief Read a mesh from the cache
+        /// @return True if a valid mesh was found, false (with meshOut
+        /// unchanged) if not.
+        bool ReadCachedDistortionMesh(uint64_t key, DistortionMesh& meshOut);
+
+        /// @brief Store a mesh in the cache
+        /// @return True on success, false on failure.
+        bool WriteCachedDistortionMesh(uint64_t key,
+                                       DistortionMesh const& mesh);
+
         //=============================================================
         // These methods must be implemented by all derived classes.
         //  They enable the Render() method above to do the generic work
@@ -1353,7 +1952,10 @@ namespace renderkit {
                 m_flipInY = false;
                 m_buffer.D3D11 = nullptr;
                 m_buffer.OpenGL = nullptr;
+                m_buffer.Software = nullptr;
                 m_ATW = nullptr;
+                m_ATWEnd = nullptr;
+                m_ATWDepth = nullptr;
             }
 
             size_t m_index;         //< Which eye (0-indexed)
@@ -1371,6 +1973,14 @@ namespace renderkit {
             OSVR_ViewportDescription m_normalizedCroppingViewport;
             matrix16* m_ATW; //< Asynchronous Time Warp matrix to use (nullptr
             // for none)
+            /// Asynchronous Time Warp matrix for the bottom line of the eye
+            /// as it is scanned out, or nullptr to use m_ATW for the whole
+            /// eye.  Each line of the eye should be warped by the blend of
+            /// the two matrices for how far down the eye it is.
+            matrix16* m_ATWEnd;
+            /// Correction of the time warp for the depth in the buffer, or
+            /// nullptr to use the assumed depth for the whole eye.
+            TimeWarpDepth* m_ATWDepth;
         };
         virtual bool PresentEye(PresentEyeParameters params) = 0;
 
@@ -1384,7 +1994,7 @@ namespace renderkit {
 
         friend class RenderManagerNVidiaD3D11OpenGL;
         friend RenderManager OSVR_RENDERMANAGER_EXPORT*
-        createRenderManager(OSVR_ClientContext context,
+        createRenderManager(std::shared_ptr<PoseSource> poseSource,
                             const std::string& renderLibraryName,
                             GraphicsLibrary graphicsLibrary);
     };
@@ -1401,7 +2011,8 @@ namespace renderkit {
     ///        that functionality become available, for now a separate one
     ///        is created and used).
     /// @param renderLibraryName Name of the rendering library to use.  It can
-    ///        currently be one of: OpenGL, Direct3D11.
+    ///        currently be one of: OpenGL, Direct3D11, Software.  Software
+    ///        renders into images in memory without opening a window.
     /// @param graphicsLibrary Graphics device to use.  If this is NULL, then
     /// a device and context appropriate to the rendering library defined in the
     /// renderLibraryName parameter will be created.  If the user creates one,
@@ -1418,6 +2029,22 @@ namespace renderkit {
                         const std::string& renderLibraryName,
                         GraphicsLibrary graphicsLibrary = GraphicsLibrary());
 
+    /// @brief Factory to create a RenderManager that reads from a PoseSource
+    ///
+    /// Works like the factory above, but reads the "/display" and
+    /// "/renderManagerConfig" strings and all poses, velocities and times
+    /// from the given source rather than from an OSVR server, so it
+    /// neither waits for nor needs a server.  Together with the Software
+    /// rendering library and a ScriptedPoseSource, this lets the whole
+    /// pipeline be run and timed deterministically in-process.
+    /// @param poseSource Source to read from.  If this is NULL, the
+    ///        configuration and poses come from an OSVR server as they do
+    ///        for the factory above.
+    RenderManager OSVR_RENDERMANAGER_EXPORT*
+    createRenderManager(std::shared_ptr<PoseSource> poseSource,
+                        const std::string& renderLibraryName,
+                        GraphicsLibrary graphicsLibrary = GraphicsLibrary());
+
     //=========================================================================
     /// C API for the RenderManager (will be in a separate file).
     /// @todo
@@ -24,6 +24,7 @@ Russ Taylor working through ReliaSolve.com for Sensics, Inc.
 
 // Internal Includes
 #include "RenderManager.h"
+#include "RenderManagerTrace.h"
 #include <RenderManagerBackends.h>
 
 #ifdef RM_USE_D3D11
@@ -47,7 +48,13 @@ Russ Taylor working through ReliaSolve.com for Sensics, Inc.
 #include "RenderManagerOpenGL.h"
 #endif
 
+#ifdef RM_USE_SOFTWARE
+#include "RenderManagerSoftware.h"
+#endif
+
 #include "VendorIdTools.h"
+#include "DistortionPolynomialBatch.h"
+#include "PosePrediction.h"
 
 // OSVR Includes
 #include <osvr/ClientKit/InterfaceStateC.h>
@@ -71,13 +78,33 @@ Russ Taylor working through ReliaSolve.com for Sensics, Inc.
 // Standard includes
 #include <chrono>
 #include <thread>
+#include <system_error>
+#include <functional>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <exception>
 #include <memory>
 #include <map>
+#include <unordered_map>
 #include <algorithm>
+#include <iomanip>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <cerrno>
+#include <atomic>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#include <process.h>
+#else
+#include <sys/types.h>
+#include <unistd.h>
+#endif
 
 
 // @todo Consider pulling this function into Core.
@@ -96,65 +123,13 @@ Russ Taylor working through ReliaSolve.com for Sensics, Inc.
 /// @param[out] poseOut The place to store the predicted
 ///  pose.  May be a reference to the same structure as
 ///  poseIn.
-static void PredictFuturePose(
+void osvr::renderkit::RenderManager::PredictFuturePose(
   const OSVR_PoseState &poseIn,
   const OSVR_VelocityState &vel,
   double predictionIntervalSec,
   OSVR_PoseState &poseOut)
 {
-  // Make a copy of the pose state so that we can handle the
-  // case where the out and in pose are the same.
-  OSVR_PoseState out = poseIn;
-
-  // If we have a change in orientation, make it.
-  if (vel.angularVelocityValid) {
-
-    // Start out the new orientation at the original one
-    // from OSVR.
-    q_type newOrientation;
-    osvrQuatToQuatlib(newOrientation, &poseIn.rotation);
-
-    // Rotate it by the amount to rotate once for every integral multiple
-    // of the rotation time we've been asked to go.
-    q_type rotationAmount;
-    osvrQuatToQuatlib(rotationAmount,
-      &vel.angularVelocity.incrementalRotation);
-
-    // @todo
-    double remaining = predictionIntervalSec;
-    while (remaining > vel.angularVelocity.dt) {
-      q_mult(newOrientation, rotationAmount, newOrientation);
-      remaining -= vel.angularVelocity.dt;
-    }
-
-    // Then rotate it by the remaining fractional amount.
-    double fractionTime = remaining / vel.angularVelocity.dt;
-    q_type identity = { 0, 0, 0, 1 };
-    q_type fractionRotation;
-    q_slerp(fractionRotation, identity, rotationAmount, fractionTime);
-    q_mult(newOrientation, fractionRotation, newOrientation);
-
-    // Then put it back into OSVR format in the output pose.
-    osvrQuatFromQuatlib(&out.rotation, newOrientation);
-  }
-
-  // If we have a linear velocity, apply it.
-  if (vel.linearVelocityValid) {
-    out.translation.data[0] += vel.linearVelocity.data[0]
-      * predictionIntervalSec;
-    out.translation.data[1] += vel.linearVelocity.data[1]
-      * predictionIntervalSec;
-    out.translation.data[2] += vel.linearVelocity.data[2]
-      * predictionIntervalSec;
-  }
-
-  // @todo Make sure the above transformation happens in
-  // the correct space, so we're rotating about the object
-  // center and translating in external (not object-local)
-  // space.
-
-  // Copy the resulting pose.
-  poseOut = out;
+  predictPose(poseIn, vel, predictionIntervalSec, poseOut);
 }
 
 /// Used to determine if we have three 2D points that are almost
@@ -257,6 +232,38 @@ static void OSVR_from_q(OSVR_PoseState& pose, const q_xyz_quat_type& xform) {
     osvrQuatSetW(&pose.rotation, xform.quat[Q_W]);
 }
 
+/// @brief Static helper function to find the milliseconds since a time
+static double
+millisecondsSince(const std::chrono::steady_clock::time_point& start) {
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+/// @brief Static helper function to convert a time value to milliseconds
+static double milliseconds(const OSVR_TimeValue& t) {
+    return t.seconds * 1e3 + t.microseconds / 1e3;
+}
+
+/// @brief Static helper function to find the nearest-rank percentiles of
+/// a set of values.  Sorts the values.
+static osvr::renderkit::TimingPercentiles
+percentiles(std::vector<double>& values) {
+    osvr::renderkit::TimingPercentiles ret;
+    if (values.empty()) {
+        return ret;
+    }
+    std::sort(values.begin(), values.end());
+    auto rank = [&](double fraction) {
+        size_t index = static_cast<size_t>(std::ceil(fraction * values.size()));
+        return values[(index > 0) ? index - 1 : 0];
+    };
+    ret.p50 = rank(0.50);
+    ret.p99 = rank(0.99);
+    ret.max = values.back();
+    return ret;
+}
+
 namespace osvr {
 namespace renderkit {
 
@@ -291,7 +298,11 @@ namespace renderkit {
         m_displayWidth = m_params.m_displayConfiguration.getDisplayWidth();
         m_displayHeight = m_params.m_displayConfiguration.getDisplayHeight();
 
-        if (osvrClientGetInterface(m_context, headSpaceName.c_str(),
+        // A pose source is asked for the head by name each time.
+        m_roomFromHeadPath = headSpaceName;
+        m_roomFromHeadInterface = nullptr;
+        if (!m_params.m_poseSource &&
+            osvrClientGetInterface(m_context, headSpaceName.c_str(),
                                    &m_roomFromHeadInterface) ==
             OSVR_RETURN_FAILURE) {
             std::cerr << "RenderManager::RenderManager(): Can't get interface "
@@ -299,9 +310,30 @@ namespace renderkit {
             throw std::runtime_error("Can't get head interface.");
         }
         osvrPose3SetIdentity(&m_roomFromHead);
+        m_roomFromHeadTimestamp.seconds = 0;
+        m_roomFromHeadTimestamp.microseconds = 0;
+
+        // No frames have been timed yet.
+        for (auto& slot : m_frameTimings) {
+            slot.m_sequence = 0;
+        }
+        m_framesTimed = 0;
+        m_getRenderInfoMS = 0;
+        m_getRenderInfoTrackerTime = m_roomFromHeadTimestamp;
+
+        // No frames have been begun yet.
+        m_lastFrameToken = 0;
+        m_presentingFrame = nullptr;
+        m_presentingToken = 0;
+        m_predictionTarget = PredictToPresent;
+
+        // Be pessimistic about how late sleeps wake up until we've seen
+        // some.
+        m_vsyncWakeLatenessMS = 1.0;
 
         // We haven't yet registered our render buffers, so can't present them
         m_renderBuffersRegistered = false;
+        m_timeWarpUsesDepth = false;
     }
 
     bool RenderManager::SetDisplayCallback(DisplayCallback callback,
@@ -351,6 +383,9 @@ namespace renderkit {
         // All public methods that use internal state should be guarded
         // by a mutex.
         std::lock_guard<std::mutex> lock(m_mutex);
+        // Also lock the tracker state, because the callback list and OSVR
+        // context are used to read poses.
+        std::lock_guard<std::mutex> stateLock(m_renderInfoMutex);
 
         // Make sure we have valid data
         if (callback == nullptr) {
@@ -370,8 +405,10 @@ namespace renderkit {
         osvrPose3SetIdentity(&cb.m_state);
 
         // If this is not world space, construct an interface
-        // description so we can render objects here.
-        if ((interfaceName.size() > 0) && (interfaceName != "/")) {
+        // description so we can render objects here.  A pose source is
+        // asked for the space by name instead.
+        if (!m_params.m_poseSource && (interfaceName.size() > 0) &&
+            (interfaceName != "/")) {
             if (osvrClientGetInterface(m_context, interfaceName.c_str(),
                                        &cb.m_interface) ==
                 OSVR_RETURN_FAILURE) {
@@ -392,6 +429,9 @@ namespace renderkit {
         // All public methods that use internal state should be guarded
         // by a mutex.
         std::lock_guard<std::mutex> lock(m_mutex);
+        // Also lock the tracker state, because the callback list and OSVR
+        // context are used to read poses.
+        std::lock_guard<std::mutex> stateLock(m_renderInfoMutex);
 
         // Look up an entry matching all three paramaters.  If we
         // find one, remove it from the list after removing its
@@ -435,6 +475,7 @@ namespace renderkit {
         // All public methods that use internal state should be guarded
         // by a mutex.
         std::lock_guard<std::mutex> lock(m_mutex);
+        RM_TRACE_SCOPE("Render");
 
         // Make sure we're doing okay.
         if (!doingOkay()) {
@@ -443,25 +484,35 @@ namespace renderkit {
             return false;
         }
 
-        // Update the transformations so that we have the most-recent
-        // state in them.
-        if (osvrClientUpdate(m_context) == OSVR_RETURN_FAILURE) {
-            std::cerr
-                << "RenderManager::Render(): client context update failed."
-                << std::endl;
-            return false;
-        }
+        {
+            std::lock_guard<std::mutex> stateLock(m_renderInfoMutex);
+
+            // Update the transformations so that we have the most-recent
+            // state in them.
+            if (!UpdateTrackingState()) {
+                std::cerr
+                    << "RenderManager::Render(): client context update failed."
+                    << std::endl;
+                return false;
+            }
 
-        // Read the transformations
-        m_renderParamsForRender = params;
-        m_renderInfoForRender = GetRenderInfoInternal(params);
+            // Read the transformations
+            m_renderParamsForRender = params;
+            auto start = std::chrono::steady_clock::now();
+            m_renderInfoForRender = GetRenderInfoInternal(params);
+            m_getRenderInfoMS = millisecondsSince(start);
+            m_getRenderInfoTrackerTime = m_roomFromHeadTimestamp;
+        }
 
         /// @todo Use acceleration and velocity to predict viewpoint at the
         // time we expect to render.
 
         // Initialize the rendering for the whole frame.
-        if (!RenderFrameInitialize()) {
-            return false;
+        {
+            RM_TRACE_SCOPE("RenderFrameInitialize");
+            if (!RenderFrameInitialize()) {
+                return false;
+            }
         }
 
         // One of the RenderDisplayInitialize() or RenderEyeInitialize()
@@ -495,11 +546,14 @@ namespace renderkit {
                 // as well.
                 // Every eye is on its own display now, so we need to
                 // initialize and finalize the displays as well.
-                if (!RenderEyeInitialize(eye)) {
-                    std::cerr
-                        << "RenderManager::Render(): Could not initialize eye."
-                        << std::endl;
-                    return false;
+                {
+                    RM_TRACE_SCOPE("RenderEyeInitialize");
+                    if (!RenderEyeInitialize(eye)) {
+                        std::cerr << "RenderManager::Render(): Could not "
+                                     "initialize eye."
+                                  << std::endl;
+                        return false;
+                    }
                 }
                 if (m_viewCallback.m_callback != nullptr) {
                     m_viewCallback.m_callback(
@@ -528,9 +582,14 @@ namespace renderkit {
                     /// might
                     /// not be defined.
                     OSVR_PoseState pose;
-                    if (!ConstructModelView(i, eye, params, pose)) {
-                        continue;
+                    {
+                        std::lock_guard<std::mutex> stateLock(
+                            m_renderInfoMutex);
+                        if (!ConstructModelView(i, eye, params, pose)) {
+                            continue;
+                        }
                     }
+                    RM_TRACE_SCOPE("RenderSpace");
                     if (!RenderSpace(i, eye, pose,
                                      m_renderInfoForRender[eye].viewport,
                                      m_renderInfoForRender[eye].projection)) {
@@ -539,11 +598,14 @@ namespace renderkit {
                 }
 
                 // Done with this eye.
-                if (!RenderEyeFinalize(eye)) {
-                    std::cerr
-                        << "RenderManager::Render(): Could not finalize eye."
-                        << std::endl;
-                    return false;
+                {
+                    RM_TRACE_SCOPE("RenderEyeFinalize");
+                    if (!RenderEyeFinalize(eye)) {
+                        std::cerr << "RenderManager::Render(): Could not "
+                                     "finalize eye."
+                                  << std::endl;
+                        return false;
+                    }
                 }
             }
 
@@ -567,18 +629,20 @@ namespace renderkit {
     }
 
     size_t RenderManager::LatchRenderInfo(const RenderParams& params) {
-        // All public methods that use internal state should be guarded
-        // by a mutex.
-        std::lock_guard<std::mutex> lock(m_mutex);
+        // This only needs the tracker state and not the presentation
+        // state, so it does not wait for a present on another thread.
+        std::lock_guard<std::mutex> lock(m_renderInfoMutex);
 
+        auto start = std::chrono::steady_clock::now();
         m_latchedRenderInfo = GetRenderInfoInternal(params);
+        m_getRenderInfoMS = millisecondsSince(start);
+        m_getRenderInfoTrackerTime = m_roomFromHeadTimestamp;
         return m_latchedRenderInfo.size();
     }
 
     RenderInfo RenderManager::GetRenderInfo(size_t index) {
-        // All public methods that use internal state should be guarded
-        // by a mutex.
-        std::lock_guard<std::mutex> lock(m_mutex);
+        // Like LatchRenderInfo(), this does not wait for presentation.
+        std::lock_guard<std::mutex> lock(m_renderInfoMutex);
 
         RenderInfo ret;
         if (index < m_latchedRenderInfo.size()) {
@@ -587,12 +651,141 @@ namespace renderkit {
         return ret;
     }
 
+    size_t RenderManager::BeginFrame(FrameToken& tokenOut,
+                                     const RenderParams& params) {
+        // Like LatchRenderInfo(), this does not wait for presentation.
+        std::lock_guard<std::mutex> lock(m_renderInfoMutex);
+
+        tokenOut = 0;
+        FrameInFlight* frame = nullptr;
+        for (auto& f : m_framesInFlight) {
+            if (f.m_token == 0) {
+                frame = &f;
+                break;
+            }
+        }
+        if (frame == nullptr) {
+            std::cerr << "RenderManager::BeginFrame(): Already have "
+                      << MAX_FRAMES_IN_FLIGHT << " frames in flight"
+                      << std::endl;
+            return 0;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<RenderInfo> renderInfo = GetRenderInfoInternal(params);
+        if (renderInfo.empty()) {
+            return 0;
+        }
+        frame->m_token = ++m_lastFrameToken;
+        frame->m_params = params;
+        frame->m_renderInfo = renderInfo;
+        frame->m_getRenderInfoMS = millisecondsSince(start);
+        frame->m_trackerSampleTime = m_roomFromHeadTimestamp;
+
+        tokenOut = frame->m_token;
+        return frame->m_renderInfo.size();
+    }
+
+    RenderInfo RenderManager::GetFrameRenderInfo(FrameToken token,
+                                                 size_t index) {
+        std::lock_guard<std::mutex> lock(m_renderInfoMutex);
+
+        RenderInfo ret;
+        for (const auto& f : m_framesInFlight) {
+            if ((token != 0) && (f.m_token == token) &&
+                (index < f.m_renderInfo.size())) {
+                ret = f.m_renderInfo[index];
+            }
+        }
+        return ret;
+    }
+
+    bool RenderManager::PresentFrame(
+        FrameToken token, const std::vector<RenderBuffer>& buffers,
+        const std::vector<OSVR_ViewportDescription>&
+            normalizedCroppingViewports,
+        bool flipInY) {
+        // All public methods that use internal state should be guarded
+        // by a mutex.
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Take a copy of the frame, so that the tracker state need not
+        // stay locked while we present.  Frames must be presented in
+        // order, or time warp and the frame timing would go backwards.
+        FrameInFlight frame;
+        {
+            std::lock_guard<std::mutex> stateLock(m_renderInfoMutex);
+            for (const auto& f : m_framesInFlight) {
+                if ((token != 0) && (f.m_token == token)) {
+                    frame = f;
+                }
+            }
+            if (frame.m_token == 0) {
+                std::cerr << "RenderManager::PresentFrame(): Frame " << token
+                          << " is not in flight" << std::endl;
+                return false;
+            }
+            for (const auto& f : m_framesInFlight) {
+                if ((f.m_token != 0) && (f.m_token < token)) {
+                    std::cerr << "RenderManager::PresentFrame(): Frame "
+                              << f.m_token << " must be presented or "
+                              << "cancelled before frame " << token
+                              << std::endl;
+                    return false;
+                }
+            }
+            // Keep the frame from being cancelled while we present it.
+            m_presentingToken = token;
+        }
+
+        m_presentingFrame = &frame;
+        bool ret = PresentRenderBuffersInternal(
+            buffers, frame.m_renderInfo, frame.m_params,
+            normalizedCroppingViewports, flipInY);
+        m_presentingFrame = nullptr;
+
+        // The frame is finished whether or not it was presented.
+        std::lock_guard<std::mutex> stateLock(m_renderInfoMutex);
+        m_presentingToken = 0;
+        FinishFrameInternal(token, "PresentFrame");
+        return ret;
+    }
+
+    bool RenderManager::CancelFrame(FrameToken token) {
+        // The frames in flight are guarded along with the tracker state,
+        // so this does not wait for presentation either.
+        std::lock_guard<std::mutex> lock(m_renderInfoMutex);
+        if ((token != 0) && (token == m_presentingToken)) {
+            std::cerr << "RenderManager::CancelFrame(): Frame " << token
+                      << " is being presented" << std::endl;
+            return false;
+        }
+        return FinishFrameInternal(token, "CancelFrame");
+    }
+
+    bool RenderManager::FinishFrameInternal(FrameToken token,
+                                            const char* caller) {
+        for (auto& f : m_framesInFlight) {
+            if ((token != 0) && (f.m_token == token)) {
+                f = FrameInFlight();
+                return true;
+            }
+        }
+        std::cerr << "RenderManager::" << caller << "(): Frame " << token
+                  << " is not in flight" << std::endl;
+        return false;
+    }
+
     std::vector<RenderInfo>
     RenderManager::GetRenderInfoInternal(const RenderParams& params) {
         // Start with an empty vector, which will be returned as such on
         // failure.
         std::vector<RenderInfo> ret;
 
+        // Filled in if the head pose is read from the tracker below.
+        m_roomFromHeadTimestamp.seconds = 0;
+        m_roomFromHeadTimestamp.microseconds = 0;
+
         // Make sure we're doing okay.
         if (!doingOkay()) {
             std::cerr << "RenderManager::GetRenderInfo(): Display not opened."
@@ -603,7 +796,7 @@ namespace renderkit {
 
         // Update the transformations so that we have the most-recent
         // state in them.
-        if (osvrClientUpdate(m_context) == OSVR_RETURN_FAILURE) {
+        if (!UpdateTrackingState()) {
             std::cerr << "RenderManager::GetRenderInfo(): client context "
                          "update failed."
                       << std::endl;
@@ -659,9 +852,9 @@ namespace renderkit {
     bool RenderManager::RegisterRenderBuffers(
         const std::vector<RenderBuffer>& buffers,
         bool appWillNotOverwriteBeforeNewPresent) {
-      // All public methods that use internal state should be guarded
-      // by a mutex.
-      std::lock_guard<std::mutex> lock(m_mutex);
+      // All public methods that use internal state should be guarded
+      // by a mutex.
+      std::lock_guard<std::mutex> lock(m_mutex);
       return RegisterRenderBuffersInternal(
             buffers, appWillNotOverwriteBeforeNewPresent);
     }
@@ -674,6 +867,13 @@ namespace renderkit {
         return true;
     }
 
+    void RenderManager::SetTimeWarpUsesDepth(bool useDepth) {
+        // All public methods that use internal state should be guarded
+        // by a mutex.
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_timeWarpUsesDepth = useDepth;
+    }
+
     bool RenderManager::PresentRenderBuffers(
         const std::vector<RenderBuffer>& buffers,
         const std::vector<RenderInfo>& renderInfoUsed,
@@ -697,6 +897,8 @@ namespace renderkit {
         const std::vector<OSVR_ViewportDescription>&
                                        normalizedCroppingViewports,
         bool flipInY) {
+        RM_TRACE_SCOPE("PresentRenderBuffers");
+
         // Make sure we're doing okay.
         if (!doingOkay()) {
             std::cerr
@@ -713,6 +915,19 @@ namespace renderkit {
             return false;
         }
 
+        // Start timing this frame.
+        FrameTiming timing;
+        auto presentStart = std::chrono::steady_clock::now();
+        GetTrackingTimeNow(timing.presentStart);
+        if (m_presentingFrame) {
+            timing.getRenderInfoMS = m_presentingFrame->m_getRenderInfoMS;
+            timing.trackerSampleTime = m_presentingFrame->m_trackerSampleTime;
+        } else {
+            std::lock_guard<std::mutex> stateLock(m_renderInfoMutex);
+            timing.getRenderInfoMS = m_getRenderInfoMS;
+            timing.trackerSampleTime = m_getRenderInfoTrackerTime;
+        }
+
         // Initialize the presentation for the whole frame.
         if (!PresentFrameInitialize()) {
             std::cerr << "RenderManager::PresentRenderBuffers(): "
@@ -729,8 +944,14 @@ namespace renderkit {
 
         if (m_params.m_enableTimeWarp &&
             (m_params.m_maxMSBeforeVsyncTimeWarp > 0)) {
+            RM_TRACE_SCOPE("WaitForVsyncThreshold");
+            auto waitStart = std::chrono::steady_clock::now();
             int count = 0;
 
+            // Let old late wakeups be forgotten over a few dozen frames,
+            // so that one bad one does not stop us sleeping for good.
+            m_vsyncWakeLatenessMS *= 0.95;
+
             // Compute the threshold interval we need to be below.
             // Convert from milliseconds to seconds
             float thresholdF = m_params.m_maxMSBeforeVsyncTimeWarp / 1e3f;
@@ -747,7 +968,12 @@ namespace renderkit {
 
                 // Update the client context so we keep getting all required
                 // callbacks called during our busy-wait.
-                if (osvrClientUpdate(m_context) == OSVR_RETURN_FAILURE) {
+                bool updated;
+                {
+                    std::lock_guard<std::mutex> stateLock(m_renderInfoMutex);
+                    updated = UpdateTrackingState();
+                }
+                if (!updated) {
                     std::cerr << "RenderManager::PresentRenderBuffers(): "
                                  "client context update failed."
                               << std::endl;
@@ -767,11 +993,17 @@ namespace renderkit {
                                             &info.timeSincelastVerticalRetrace);
                     if (osvrTimeValueGreater(&nextRetrace, &threshold)) {
                         proceed = false;
+                        if (m_params.m_sleepBeforeVsync) {
+                            OSVR_TimeValue untilDone = nextRetrace;
+                            osvrTimeValueDifference(&untilDone, &threshold);
+                            SleepBeforeVsync(milliseconds(untilDone));
+                        }
                     }
                 }
 
                 ++count;
             } while (!proceed);
+            timing.busyWaitMS = millisecondsSince(waitStart);
         }
 
         // Store the previous matrices we returned to the client and a new set
@@ -780,18 +1012,76 @@ namespace renderkit {
         // GetRenderInfo function.  Use these parameters to construct info
         // needed
         // to perform Asynchronous Time Warp.
-        std::vector<RenderInfo> currentRenderInfo =
-            GetRenderInfoInternal(renderParams);
-        // @todo make the depth for ATW a parameter?
+        auto timeWarpStart = std::chrono::steady_clock::now();
+        // Note when the vsync this frame is aiming for will happen, so we
+        // can tell afterwards whether it made it.
+        RenderTimingInfo targetInfo;
+        double targetIntervalMS = 0;
+        std::chrono::steady_clock::time_point targetVsync;
+        if (GetTimingInfo(0, targetInfo)) {
+            targetIntervalMS = milliseconds(targetInfo.hardwareDisplayInterval);
+            double untilVsyncMS =
+                std::max(targetIntervalMS -
+                             milliseconds(
+                                 targetInfo.timeSincelastVerticalRetrace),
+                         0.0);
+            targetVsync = timeWarpStart +
+                          std::chrono::duration_cast<
+                              std::chrono::steady_clock::duration>(
+                              std::chrono::duration<double, std::milli>(
+                                  untilVsyncMS));
+        }
+        // Predict these poses to when each eye will be scanned out, which
+        // is what the time warp is correcting the image for.  For a rolling
+        // shutter, we also need the poses for when the last line of each
+        // eye is scanned out; these only differ when we are predicting.
+        bool rollingShutter = m_params.m_enableTimeWarp &&
+                              m_params.m_rollingShutterTimeWarp &&
+                              m_params.m_clientPredictionEnabled;
+        std::vector<RenderInfo> currentRenderInfo;
+        std::vector<RenderInfo> scanoutEndRenderInfo;
+        {
+            std::lock_guard<std::mutex> stateLock(m_renderInfoMutex);
+            m_predictionTarget = PredictToScanout;
+            currentRenderInfo = GetRenderInfoInternal(renderParams);
+            if (rollingShutter) {
+                m_predictionTarget = PredictToScanoutEnd;
+                scanoutEndRenderInfo = GetRenderInfoInternal(renderParams);
+            }
+            m_predictionTarget = PredictToPresent;
+        }
+        m_asynchronousTimeWarpsEnd.clear();
+        m_timeWarpDepths.clear();
         if (m_params.m_enableTimeWarp) {
+            RM_TRACE_SCOPE("ComputeAsynchronousTimeWarps");
+            if (rollingShutter) {
+                if (!ComputeAsynchronousTimeWarps(renderInfoUsed,
+                                                  scanoutEndRenderInfo,
+                                                  m_params.m_timeWarpDepth)) {
+                    std::cerr << "RenderManager::PresentRenderBuffers: Could "
+                                 "not compute end-of-scan ATWs"
+                              << std::endl;
+                    return false;
+                }
+                m_asynchronousTimeWarpsEnd.swap(m_asynchronousTimeWarps);
+            }
             if (!ComputeAsynchronousTimeWarps(renderInfoUsed, currentRenderInfo,
-                                              2.0f)) {
+                                              m_params.m_timeWarpDepth)) {
                 std::cerr << "RenderManager::PresentRenderBuffers: Could not "
                              "compute ATWs"
                           << std::endl;
                 return false;
             }
+            if (m_timeWarpUsesDepth &&
+                !ComputeTimeWarpDepths(renderInfoUsed, currentRenderInfo,
+                                       m_params.m_timeWarpDepth)) {
+                std::cerr << "RenderManager::PresentRenderBuffers: Could not "
+                             "compute ATW depth corrections"
+                          << std::endl;
+                return false;
+            }
         }
+        timing.timeWarpMS = millisecondsSince(timeWarpStart);
 
         // Render into each display, setting up the display beforehand and
         // finalizing
@@ -875,6 +1165,12 @@ namespace renderkit {
                         return false;
                     }
                     p.m_ATW = &m_asynchronousTimeWarps[eye];
+                    if (eye < m_asynchronousTimeWarpsEnd.size()) {
+                        p.m_ATWEnd = &m_asynchronousTimeWarpsEnd[eye];
+                    }
+                    if (eye < m_timeWarpDepths.size()) {
+                        p.m_ATWDepth = &m_timeWarpDepths[eye];
+                    }
                 }
 
                 // Fill in the region to image within the buffer.  If the client
@@ -894,12 +1190,18 @@ namespace renderkit {
                 }
                 p.m_normalizedCroppingViewport = bufferCrop;
 
+                RM_TRACE_SCOPE("PresentEye");
+                auto eyeStart = std::chrono::steady_clock::now();
                 if (!PresentEye(p)) {
                     std::cerr << "RenderManager::PresentRenderBuffers(): "
                                  "PresentEye failed."
                               << std::endl;
                     return false;
                 }
+                if (eye < FrameTiming::MAX_EYES) {
+                    timing.presentEyeMS[eye] = millisecondsSince(eyeStart);
+                    timing.numEyes = eye + 1;
+                }
             }
 
             // We're done with this display.
@@ -920,11 +1222,123 @@ namespace renderkit {
         }
 
         // Keep track of the timing information.
-        /// @todo
+        auto swap = std::chrono::steady_clock::now();
+        GetTrackingTimeNow(timing.swapComplete);
+        timing.presentMS =
+            std::chrono::duration<double, std::milli>(swap - presentStart)
+                .count();
+
+        // A swap that waits for vsync returns just after the one it was
+        // shown at, so if that was more than half an interval after the
+        // vsync we were aiming for, the frame was shown at a later one.
+        if (targetIntervalMS > 0) {
+            double lateMS =
+                std::chrono::duration<double, std::milli>(swap - targetVsync)
+                    .count();
+            timing.missedVsync = lateMS > 0.5 * targetIntervalMS;
+        }
+        RecordFrameTiming(timing);
+
+        return true;
+    }
+
+    void RenderManager::SleepBeforeVsync(double msUntilDone) {
+        // Always leave at least a couple hundred microseconds to spin, plus
+        // enough to cover sleeps that wake up late.
+        double marginMS = 0.2 + 1.5 * m_vsyncWakeLatenessMS;
+        double sleepMS = msUntilDone - marginMS;
+        if (sleepMS <= 0) {
+            return;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::microseconds(
+            static_cast<std::chrono::microseconds::rep>(sleepMS * 1e3)));
+        double lateMS = millisecondsSince(start) - sleepMS;
+        m_vsyncWakeLatenessMS = std::max(m_vsyncWakeLatenessMS, lateMS);
+    }
+
+    void RenderManager::RecordFrameTiming(FrameTiming& timing) {
+        uint64_t frame = m_framesTimed.load(std::memory_order_relaxed);
+        timing.frame = frame;
+        FrameTimingSlot& slot = m_frameTimings[frame % FRAME_TIMING_HISTORY];
+
+        // Mark the slot as being written before touching it, and as
+        // holding this frame once we're done.
+        slot.m_sequence.store(2 * frame + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.m_timing = timing;
+        slot.m_sequence.store(2 * frame + 2, std::memory_order_release);
+        m_framesTimed.store(frame + 1, std::memory_order_release);
+    }
+
+    size_t
+    RenderManager::GetFrameTimings(std::vector<FrameTiming>& timingsOut) {
+        timingsOut.clear();
+        uint64_t count = m_framesTimed.load(std::memory_order_acquire);
+        uint64_t first =
+            (count > FRAME_TIMING_HISTORY) ? count - FRAME_TIMING_HISTORY : 0;
+        for (uint64_t frame = first; frame < count; frame++) {
+            const FrameTimingSlot& slot =
+                m_frameTimings[frame % FRAME_TIMING_HISTORY];
+            uint64_t expected = 2 * frame + 2;
+            if (slot.m_sequence.load(std::memory_order_acquire) != expected) {
+                // Overwritten by a newer frame since we read the count.
+                continue;
+            }
+            FrameTiming timing = slot.m_timing;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.m_sequence.load(std::memory_order_relaxed) != expected) {
+                continue;
+            }
+            timingsOut.push_back(timing);
+        }
+        return timingsOut.size();
+    }
+
+    bool RenderManager::GetFrameTimingStatistics(
+        FrameTimingStatistics& statsOut) {
+        statsOut = FrameTimingStatistics();
+        std::vector<FrameTiming> timings;
+        if (GetFrameTimings(timings) == 0) {
+            return false;
+        }
 
+        std::vector<double> getRenderInfo, busyWait, timeWarp, presentEye,
+            present, trackerToSwap;
+        for (const auto& t : timings) {
+            getRenderInfo.push_back(t.getRenderInfoMS);
+            busyWait.push_back(t.busyWaitMS);
+            timeWarp.push_back(t.timeWarpMS);
+            for (size_t eye = 0; eye < t.numEyes; eye++) {
+                presentEye.push_back(t.presentEyeMS[eye]);
+            }
+            present.push_back(t.presentMS);
+            if ((t.trackerSampleTime.seconds != 0) ||
+                (t.trackerSampleTime.microseconds != 0)) {
+                trackerToSwap.push_back(osvrTimeValueDurationSeconds(
+                                            &t.swapComplete,
+                                            &t.trackerSampleTime) *
+                                        1e3);
+            }
+            if (t.missedVsync) {
+                statsOut.missedVsyncs++;
+            }
+        }
+        statsOut.frames = timings.size();
+        statsOut.getRenderInfoMS = percentiles(getRenderInfo);
+        statsOut.busyWaitMS = percentiles(busyWait);
+        statsOut.timeWarpMS = percentiles(timeWarp);
+        statsOut.presentEyeMS = percentiles(presentEye);
+        statsOut.presentMS = percentiles(present);
+        statsOut.trackerToSwapMS = percentiles(trackerToSwap);
         return true;
     }
 
+    bool RenderManager::WriteTrace(std::ostream& out) {
+        return trace::WriteChromeTrace(out);
+    }
+
     bool RenderManager::UpdateDistortionMeshes(
         DistortionMeshType type //< Type of mesh to produce
         ,
@@ -938,11 +1352,41 @@ namespace renderkit {
         return UpdateDistortionMeshesInternal(type, distort);
     }
 
+    bool RenderManager::UpdateDistortionMeshTextureCoordinates(
+        DistortionMeshType type //< Type of mesh to produce
+        ,
+        std::vector<DistortionParameters> const&
+            distort //< Distortion parameters
+        ) {
+        // All public methods that use internal state should be guarded
+        // by a mutex.
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        return UpdateDistortionMeshTextureCoordinatesInternal(type, distort);
+    }
+
+    bool RenderManager::UpdateDistortionMeshTextureCoordinatesInternal(
+        DistortionMeshType type //< Type of mesh to produce
+        ,
+        std::vector<DistortionParameters> const&
+            distort //< Distortion parameters
+        ) {
+        return UpdateDistortionMeshesInternal(type, distort);
+    }
+
     void RenderManager::SetRoomRotationUsingHead() {
         // All public methods that use internal state should be guarded
         // by a mutex.
         std::lock_guard<std::mutex> lock(m_mutex);
+        // Also lock the tracker state, because this changes the poses we read.
+        std::lock_guard<std::mutex> stateLock(m_renderInfoMutex);
 
+        if (m_params.m_poseSource) {
+            std::cerr << "RenderManager::SetRoomRotationUsingHead(): Not "
+                         "supported when reading from a PoseSource"
+                      << std::endl;
+            return;
+        }
         osvrClientSetRoomRotationUsingHead(m_context);
     }
 
@@ -950,10 +1394,103 @@ namespace renderkit {
         // All public methods that use internal state should be guarded
         // by a mutex.
         std::lock_guard<std::mutex> lock(m_mutex);
+        // Also lock the tracker state, because this changes the poses we read.
+        std::lock_guard<std::mutex> stateLock(m_renderInfoMutex);
 
+        if (m_params.m_poseSource) {
+            // There is no room-to-world transform to clear.
+            return;
+        }
         osvrClientClearRoomToWorldTransform(m_context);
     }
 
+    bool RenderManager::UpdateTrackingState() {
+        if (m_params.m_poseSource) {
+            return m_params.m_poseSource->Update();
+        }
+        return osvrClientUpdate(m_context) != OSVR_RETURN_FAILURE;
+    }
+
+    void RenderManager::GetTrackingTimeNow(OSVR_TimeValue& now) {
+        if (m_params.m_poseSource) {
+            m_params.m_poseSource->GetTimeNow(now);
+            return;
+        }
+        osvrTimeValueGetNow(&now);
+    }
+
+    bool RenderManager::GetRoomFromHeadState(OSVR_TimeValue& timestamp,
+                                             OSVR_PoseState& pose) {
+        if (m_params.m_poseSource) {
+            return m_params.m_poseSource->GetPoseState(m_roomFromHeadPath,
+                                                       timestamp, pose);
+        }
+        return osvrGetPoseState(m_roomFromHeadInterface, &timestamp, &pose) !=
+               OSVR_RETURN_FAILURE;
+    }
+
+    void RenderManager::GetMotionState(const std::string& path,
+                                       OSVR_ClientInterface iface,
+                                       OSVR_VelocityState& velocity,
+                                       OSVR_AccelerationState& acceleration) {
+        // Set the valid flags to false so that if a call to get the state
+        // fails, we will not try and use it.
+        velocity.linearVelocityValid = false;
+        velocity.angularVelocityValid = false;
+        acceleration.linearAccelerationValid = false;
+        acceleration.angularAccelerationValid = false;
+
+        OSVR_TimeValue timestamp;
+        if (m_params.m_poseSource) {
+            if (!m_params.m_poseSource->GetVelocityState(path, timestamp,
+                                                         velocity)) {
+                velocity.linearVelocityValid = false;
+                velocity.angularVelocityValid = false;
+            }
+            if (!m_params.m_poseSource->GetAccelerationState(path, timestamp,
+                                                             acceleration)) {
+                acceleration.linearAccelerationValid = false;
+                acceleration.angularAccelerationValid = false;
+            }
+            return;
+        }
+        if (osvrGetVelocityState(iface, &timestamp, &velocity) !=
+            OSVR_RETURN_SUCCESS) {
+            velocity.linearVelocityValid = false;
+            velocity.angularVelocityValid = false;
+        }
+        if (osvrGetAccelerationState(iface, &timestamp, &acceleration) !=
+            OSVR_RETURN_SUCCESS) {
+            acceleration.linearAccelerationValid = false;
+            acceleration.angularAccelerationValid = false;
+        }
+    }
+
+    bool RenderManager::IsWorldSpace(size_t whichSpace) {
+        // If don't have a callback defined for this space, we're in
+        // world space.  When reading from the OSVR context, having a NULL
+        // interface pointer also means world space.
+        if (whichSpace >= m_callbacks.size()) {
+            return true;
+        }
+        if (m_params.m_poseSource) {
+            const std::string& name = m_callbacks[whichSpace].m_interfaceName;
+            return (name.size() == 0) || (name == "/");
+        }
+        return m_callbacks[whichSpace].m_interface == nullptr;
+    }
+
+    bool RenderManager::GetSpaceState(size_t whichSpace,
+                                      OSVR_TimeValue& timestamp,
+                                      OSVR_PoseState& pose) {
+        if (m_params.m_poseSource) {
+            return m_params.m_poseSource->GetPoseState(
+                m_callbacks[whichSpace].m_interfaceName, timestamp, pose);
+        }
+        return osvrGetPoseState(m_callbacks[whichSpace].m_interface,
+                                &timestamp, &pose) != OSVR_RETURN_FAILURE;
+    }
+
     size_t RenderManager::GetNumEyes() {
         return m_params.m_displayConfiguration.getEyes().size();
     }
@@ -1393,66 +1930,19 @@ namespace renderkit {
             /// DO NOT update the client here, so that we're using the
             /// same state for all eyes.
             OSVR_TimeValue timestamp;
-            if (osvrGetPoseState(m_roomFromHeadInterface, &timestamp,
-                                 &m_roomFromHead) == OSVR_RETURN_FAILURE) {
+            if (!GetRoomFromHeadState(timestamp, m_roomFromHead)) {
                 // This it not an error -- they may have put in an invalid
                 // state name for the head; we just ignore that case.
-            }
-
-            // Do prediction of where this eye will be when it is presented
-            // if client-side prediction is enabled.
-            if (m_params.m_clientPredictionEnabled) {
-              // Get information about how long we have until the next present.
-              // If we can't get timing info, we just set its offset to 0.
-              float msUntilPresent = 0;
-              RenderTimingInfo timing;
-              if (GetTimingInfo(whichEye, timing)) {
-                msUntilPresent +=
-                  (timing.timeUntilNextPresentRequired.seconds * 1e3f) +
-                  (timing.timeUntilNextPresentRequired.microseconds / 1e3f);
-              }
-
-              // Adjust the time at which the most-recent tracking info was
-              // set based on whether we're supposed to override it with "now".
-              // If not, find out how long ago it was.
-              float msSinceTrackerReport = 0;
-              if (!m_params.m_clientPredictionLocalTimeOverride) {
-                OSVR_TimeValue now;
-                osvrTimeValueGetNow(&now);
-                msSinceTrackerReport = static_cast<float>(
-                  osvrTimeValueDurationSeconds(&now, &timestamp) * 1e3
-                  );
-              }
-
-              // The delay before rendering for each
-              // eye will be different because they are at different delays past
-              // the next vsync.  The static delay common to both eyes has
-              // already been added into their offset.
-              float predictionIntervalms = msSinceTrackerReport +
-                msUntilPresent;
-              if (whichEye < m_params.m_eyeDelaysMS.size()) {
-                predictionIntervalms += m_params.m_eyeDelaysMS[whichEye];
-              }
-              float predictionIntervalSec = predictionIntervalms / 1e3f;
-
-              // Find out the pose velocity information, if available.
-              // Set the valid flags to false so that if to call to get
-              // velocity fails, we will not try and use the info.
-              OSVR_VelocityState vel;
-              vel.linearVelocityValid = false;
-              vel.angularVelocityValid = false;
-              if (osvrGetVelocityState(m_roomFromHeadInterface, &timestamp,
-                  &vel) != OSVR_RETURN_SUCCESS) {
-                // We're okay with failure here, we just use a zero
-                // velocity to predict.
-              }
-
-              // Predict the future pose of the head based on the velocity
-              // information and how long we should predict.  Check the
-              // linear and angular velocity terms to see if we should be
-              // using each.  Replace the pose with the predicted pose.
-              PredictFuturePose(m_roomFromHead, vel,
-                predictionIntervalSec, m_roomFromHead);
+            } else {
+                m_roomFromHeadTimestamp = timestamp;
+
+                // Do prediction of where this eye will be when it is
+                // presented if client-side prediction is enabled.  Replace
+                // the pose with the predicted pose.
+                if (m_params.m_clientPredictionEnabled) {
+                    PredictPose(m_roomFromHeadPath, m_roomFromHeadInterface,
+                                timestamp, whichEye, m_roomFromHead);
+                }
             }
 
             // Bring the pose into quatlib world.
@@ -1462,13 +1952,9 @@ namespace renderkit {
         q_xyz_quat_compose(&q_roomFromEye, &q_roomFromHead, &q_headFromEye);
 
         // See if we are making a transform for world space.
-        // If don't have a callback defined for this space, we're in
-        // world space.  This is used by GetRenderInfo() and
+        // This is used by GetRenderInfo() and
         // PresentRenderBuffers() to get its world-space matrix.
-        // If we have a NULL interface pointer, we are
-        // in world space.
-        bool inWorldSpace = (whichSpace >= m_callbacks.size()) ||
-                            (m_callbacks[whichSpace].m_interface == nullptr);
+        bool inWorldSpace = IsWorldSpace(whichSpace);
 
         /// Include the impact of roomFromWorld, if it is specified.
         /// If we are not going into world space, but rather into one
@@ -1497,13 +1983,17 @@ namespace renderkit {
             makeIdentity(q_worldFromSpace);
         } else {
             OSVR_TimeValue timestamp;
-            if (osvrGetPoseState(
-                    m_callbacks[whichSpace].m_interface, &timestamp,
-                    &m_callbacks[whichSpace].m_state) == OSVR_RETURN_FAILURE) {
+            if (!GetSpaceState(whichSpace, timestamp,
+                               m_callbacks[whichSpace].m_state)) {
                 // They asked for a space that does not exist.  Return false to
                 // let them know we didn't get the one they wanted.
                 return false;
             }
+            if (m_params.m_clientPredictionEnabled) {
+                PredictPose(m_callbacks[whichSpace].m_interfaceName,
+                            m_callbacks[whichSpace].m_interface, timestamp,
+                            whichEye, m_callbacks[whichSpace].m_state);
+            }
             q_from_OSVR(q_worldFromSpace, m_callbacks[whichSpace].m_state);
         }
         q_xyz_quat_type q_eyeFromSpace;
@@ -1514,6 +2004,134 @@ namespace renderkit {
         return true;
     }
 
+    double RenderManager::PredictionIntervalSec(
+        size_t whichEye, const OSVR_TimeValue& reportTime) {
+        // Get information about how long we have until the next present,
+        // or until the next vsync when we are already presenting.  If we
+        // can't get timing info, we just set its offset to 0.
+        double msUntilPresent = 0;
+        RenderTimingInfo timing;
+        if (GetTimingInfo(whichEye, timing)) {
+            if (m_predictionTarget != PredictToPresent) {
+                OSVR_TimeValue nextRetrace = timing.hardwareDisplayInterval;
+                osvrTimeValueDifference(&nextRetrace,
+                                        &timing.timeSincelastVerticalRetrace);
+                // Past due means the retrace is happening now.
+                msUntilPresent = std::max(0.0, milliseconds(nextRetrace));
+            } else {
+                msUntilPresent +=
+                    (timing.timeUntilNextPresentRequired.seconds * 1e3) +
+                    (timing.timeUntilNextPresentRequired.microseconds / 1e3);
+            }
+        }
+        if (m_predictionTarget == PredictToScanoutEnd) {
+            msUntilPresent += EyeScanOutMS(whichEye);
+        }
+
+        // Adjust the time at which the most-recent tracking info was
+        // set based on whether we're supposed to override it with "now".
+        // If not, find out how long ago it was.
+        double msSinceTrackerReport = 0;
+        if (!m_params.m_clientPredictionLocalTimeOverride) {
+            OSVR_TimeValue now;
+            GetTrackingTimeNow(now);
+            msSinceTrackerReport =
+                osvrTimeValueDurationSeconds(&now, &reportTime) * 1e3;
+        }
+
+        // The delay before rendering for each
+        // eye will be different because they are at different delays past
+        // the next vsync.  The static delay common to both eyes has
+        // already been added into their offset.
+        double predictionIntervalms = msSinceTrackerReport + msUntilPresent;
+        if (whichEye < m_params.m_eyeDelaysMS.size()) {
+            predictionIntervalms += m_params.m_eyeDelaysMS[whichEye];
+        }
+        return predictionIntervalms / 1e3;
+    }
+
+    double RenderManager::EyeScanOutMS(size_t whichEye) {
+        double scanOutMS = m_params.m_scanOutMS;
+        if (scanOutMS <= 0) {
+            RenderTimingInfo timing;
+            if (!GetTimingInfo(whichEye, timing)) {
+                return 0;
+            }
+            scanOutMS = milliseconds(timing.hardwareDisplayInterval);
+        }
+
+        // Find the lines of the display as it is scanned out that this
+        // eye's viewport covers.  If we've rotated the screen by 90 or 270,
+        // then the display has swapped aspect ratios.
+        OSVR_ViewportDescription viewport;
+        if (!ConstructViewportForPresent(
+                whichEye, viewport,
+                m_params.m_displayConfiguration.getSwapEyes())) {
+            return 0;
+        }
+        viewport = RotateViewport(viewport);
+        double displayLines = m_displayHeight;
+        if ((m_params.m_displayRotation ==
+             ConstructorParameters::Display_Rotation::Ninety) ||
+            (m_params.m_displayRotation ==
+             ConstructorParameters::Display_Rotation::TwoSeventy)) {
+            displayLines = m_displayWidth;
+        }
+        if (displayLines <= 0) {
+            return 0;
+        }
+        return scanOutMS * std::min(1.0, viewport.height / displayLines);
+    }
+
+    bool RenderManager::PredictPose(const std::string& path,
+                                    OSVR_ClientInterface iface,
+                                    const OSVR_TimeValue& timestamp,
+                                    size_t whichEye, OSVR_PoseState& pose) {
+        // Find the predictor for this path, making it the first time the
+        // path is predicted.  Paths that are not to be predicted get a
+        // nullptr so that we don't look them up again.
+        auto found = m_posePredictors.find(path);
+        if (found == m_posePredictors.end()) {
+            std::shared_ptr<PosePredictor> predictor;
+            auto model = m_params.m_predictionModels.find(path);
+            if (model == m_params.m_predictionModels.end()) {
+                if (path == m_roomFromHeadPath) {
+                    predictor = std::make_shared<ConstantVelocityPredictor>();
+                }
+            } else {
+                switch (model->second.m_model) {
+                case ConstructorParameters::ConstantAccelerationPrediction:
+                    predictor =
+                        std::make_shared<ConstantAccelerationPredictor>();
+                    break;
+                case ConstructorParameters::AlphaBetaPrediction:
+                    predictor = std::make_shared<AlphaBetaPredictor>(
+                        model->second.m_alpha, model->second.m_beta);
+                    break;
+                default:
+                    predictor = std::make_shared<ConstantVelocityPredictor>();
+                    break;
+                }
+            }
+            found = m_posePredictors.insert(std::make_pair(path, predictor))
+                        .first;
+        }
+        PosePredictor* predictor = found->second.get();
+        if (!predictor) {
+            return false;
+        }
+
+        // Find out the velocity and acceleration, if available, and
+        // predict the future pose from them and how long we should
+        // predict.
+        OSVR_VelocityState vel;
+        OSVR_AccelerationState accel;
+        GetMotionState(path, iface, vel, accel);
+        predictor->AddReport(timestamp, pose, vel, accel);
+        return predictor->Predict(PredictionIntervalSec(whichEye, timestamp),
+                                  pose);
+    }
+
     bool RenderManager::ComputeAsynchronousTimeWarps(
         std::vector<RenderInfo> usedRenderInfo,
         std::vector<RenderInfo> currentRenderInfo, float assumedDepth) {
@@ -1669,6 +2287,64 @@ namespace renderkit {
         return true;
     }
 
+    bool RenderManager::ComputeTimeWarpDepths(
+        const std::vector<RenderInfo>& usedRenderInfo,
+        const std::vector<RenderInfo>& currentRenderInfo, float assumedDepth) {
+        m_timeWarpDepths.clear();
+
+        size_t numEyes = GetNumEyes();
+        if (assumedDepth <= 0) {
+            return false;
+        }
+        if ((currentRenderInfo.size() < numEyes) ||
+            (usedRenderInfo.size() < numEyes)) {
+            return false;
+        }
+
+        for (size_t eye = 0; eye < numEyes; eye++) {
+            // The time warp maps a point at depth d through the last
+            // ModelView times the inverse of the current one.  Its rotation
+            // moves the point in proportion to d, which the scales in the
+            // time warp divide back out, but its translation t does not, so
+            // it shifts the texture coordinate by t / d divided by the size
+            // of the view frustum at unit depth.
+            OSVR_PoseState const& last = usedRenderInfo[eye].pose;
+            OSVR_PoseState const& current = currentRenderInfo[eye].pose;
+            Eigen::Quaterniond lastRotation(
+                osvrQuatGetW(&last.rotation), osvrQuatGetX(&last.rotation),
+                osvrQuatGetY(&last.rotation), osvrQuatGetZ(&last.rotation));
+            Eigen::Quaterniond currentRotation(
+                osvrQuatGetW(&current.rotation),
+                osvrQuatGetX(&current.rotation),
+                osvrQuatGetY(&current.rotation),
+                osvrQuatGetZ(&current.rotation));
+            Eigen::Vector3d lastTranslation(osvrVec3GetX(&last.translation),
+                                            osvrVec3GetY(&last.translation),
+                                            osvrVec3GetZ(&last.translation));
+            Eigen::Vector3d currentTranslation(
+                osvrVec3GetX(&current.translation),
+                osvrVec3GetY(&current.translation),
+                osvrVec3GetZ(&current.translation));
+            Eigen::Vector3d t =
+                lastTranslation - lastRotation.toRotationMatrix() *
+                                      currentRotation.toRotationMatrix()
+                                          .transpose() *
+                                      currentTranslation;
+
+            OSVR_ProjectionMatrix const& proj = usedRenderInfo[eye].projection;
+            TimeWarpDepth depth;
+            depth.m_parallax[0] = static_cast<float>(
+                t.x() * proj.nearClip / (proj.right - proj.left));
+            depth.m_parallax[1] = static_cast<float>(
+                t.y() * proj.nearClip / (proj.top - proj.bottom));
+            depth.m_inverseAssumedDepth = 1.0f / assumedDepth;
+            depth.m_nearClip = static_cast<float>(proj.nearClip);
+            depth.m_farClip = static_cast<float>(proj.farClip);
+            m_timeWarpDepths.push_back(depth);
+        }
+        return true;
+    }
+
     bool RenderManager::ComputeDisplayOrientationMatrix(
         float rotateDegrees //< Rotation in degrees around Z
         ,
@@ -1729,157 +2405,221 @@ namespace renderkit {
         return true;
     }
 
-    static double pointDistance(double x1, double y1, double x2, double y2) {
-        return std::sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1));
+    RenderManager::UnstructuredMeshInterpolator::UnstructuredMeshInterpolator(
+        const MonoPointDistortionMeshDescription& points) {
+
+        // Build the k-d tree over the indices of all of the points, then
+        // copy the points into structure-of-arrays storage in tree order
+        // so that each leaf is contiguous.  This is the only place we
+        // allocate; queries walk the tree in place.
+        std::vector<size_t> order(points.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
+        buildTree(points, order, 0, order.size(), 0);
+        m_points.reserve(order.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            const MonoPointDistortionMeshDescription::value_type& point =
+                points[order[i]];
+            m_points.push_back(point[0][0], point[0][1], point[1][0],
+                               point[1][1]);
+        }
     }
 
-    RenderManager::UnstructuredMeshInterpolator::UnstructuredMeshInterpolator(
-        const MonoPointDistortionMeshDescription& points,
-        int numSamplesX, int numSamplesY
-        ) : m_points(points), m_numSamplesX(numSamplesX),
-        m_numSamplesY(numSamplesY) {
+    void RenderManager::UnstructuredMeshInterpolator::buildTree(
+        const MonoPointDistortionMeshDescription& points,
+        std::vector<size_t>& order, size_t begin, size_t end,
+        unsigned depth) {
+        if (end - begin <= LEAF_SIZE) {
+            return;
+        }
 
-      // Construct and fill in the grid of nearby points that is used by the
-      // interpolation function to accelerate the search for the three
-      // nearest non-collinear points.
-      std::vector< MonoPointDistortionMeshDescription> ySet;
-      MonoPointDistortionMeshDescription empty;
-      for (size_t y = 0; y < m_numSamplesY; y++) {
-        ySet.emplace_back(empty);
-      }
-      for (size_t x = 0; x < m_numSamplesX; x++) {
-        m_grid.emplace_back(ySet);
-      }
-      
-      // Go through each point in the unstructured grid and insert its index
-      // into all grid elements that are within 1/4th (rounded up) of the
-      // total span of the grid from its normalized location.
-      int xHalfSpan = static_cast<int>(0.9 + (1.0/4.0)*0.5 * m_numSamplesX);
-      int yHalfSpan = static_cast<int>(0.9 + (1.0/4.0)*0.5 * m_numSamplesY);
-      for (size_t i = 0; i < points.size(); i++) {
-        int xIndex, yIndex;
-        if (getIndex(points[i][0][0], points[i][0][1], xIndex, yIndex)) {
-
-          // Get the range of locations to insert
-          int xMin = xIndex - xHalfSpan;
-          if (xMin < 0) { xMin = 0; }
-          int xMax = xIndex + xHalfSpan;
-          if (xMax >= m_numSamplesX) { xMax = m_numSamplesX - 1; }
-          int yMin = yIndex - yHalfSpan;
-          if (yMin < 0) { yMin = 0; }
-          int yMax = yIndex + yHalfSpan;
-          if (yMax >= m_numSamplesY) { yMax = m_numSamplesY - 1; }
-
-          // Insert this point into each of these locations.
-          for (int x = xMin; x <= xMax; x++) {
-            for (int y = yMin; y <= yMax; y++) {
-              m_grid[x][y].push_back(points[i]);
-            }
-          }
+        // Partition the range around its middle element along the
+        // axis for this depth, then do the same for each half.
+        size_t axis = depth % 2;
+        size_t mid = begin + (end - begin) / 2;
+        std::nth_element(order.begin() + begin, order.begin() + mid,
+                         order.begin() + end,
+                         [&points, axis](size_t a, size_t b) {
+                             return points[a][0][axis] < points[b][0][axis];
+                         });
+        buildTree(points, order, begin, mid, depth + 1);
+        buildTree(points, order, mid + 1, end, depth + 1);
+    }
+
+    void RenderManager::UnstructuredMeshInterpolator::squaredDistances(
+        double x, double y, size_t begin, size_t count,
+        double* dist2Out) const {
+        // Straight-line loop over contiguous arrays so that the compiler
+        // can vectorize it.
+        const double* fromX = m_points.m_fromX.data() + begin;
+        const double* fromY = m_points.m_fromY.data() + begin;
+        for (size_t i = 0; i < count; i++) {
+            double dx = x - fromX[i];
+            double dy = y - fromY[i];
+            dist2Out[i] = dx * dx + dy * dy;
         }
-      }
     }
 
-    Float2
-    RenderManager::UnstructuredMeshInterpolator::interpolateNearestPoints(
-            float xN, float yN) {
-        Float2 ret = {};
+    void RenderManager::UnstructuredMeshInterpolator::NeighborList::insert(
+        double dist2, size_t index) {
+        // Find where this point belongs in the sorted list, ignoring it if
+        // it is farther than everything we already have in a full list.
+        size_t pos = m_count;
+        while (pos > 0 &&
+               (dist2 < m_dist2[pos - 1] ||
+                (dist2 == m_dist2[pos - 1] && index < m_index[pos - 1]))) {
+            pos--;
+        }
+        if (pos == MAX_NEIGHBORS) {
+            return;
+        }
 
-        // Look in the spatial-acceleration grid to see if we can
-        // find three points without having to search the entire set of
-        // points.
-        int xIndex, yIndex;
-        if (!getIndex(xN, yN, xIndex, yIndex)) {
-          return ret;
+        // Shift the farther points down, dropping the last one if full.
+        size_t last = full() ? MAX_NEIGHBORS - 1 : m_count++;
+        for (size_t i = last; i > pos; i--) {
+            m_dist2[i] = m_dist2[i - 1];
+            m_index[i] = m_index[i - 1];
         }
-        MonoPointDistortionMeshDescription points;
-        points = getNearestPoints(xN, yN, m_grid[xIndex][yIndex]);
+        m_dist2[pos] = dist2;
+        m_index[pos] = index;
+    }
 
-        // If we didn't get enough points from the acceleration
-        // structure, look in the whole points array
-        if (points.size() < 3) {
-          points = getNearestPoints(xN, yN, m_points);
+    void RenderManager::UnstructuredMeshInterpolator::findNearest(
+        double x, double y, size_t begin, size_t end, unsigned depth,
+        NeighborList& nearest) const {
+        if (begin >= end) {
+            return;
         }
 
-        // If we didn't get three points, just return the output of
-        // the first point we found.
+        // Leaves are checked all at once.
+        if (end - begin <= LEAF_SIZE) {
+            std::array<double, LEAF_SIZE> dist2;
+            squaredDistances(x, y, begin, end - begin, dist2.data());
+            for (size_t i = begin; i < end; i++) {
+                nearest.insert(dist2[i - begin], i);
+            }
+            return;
+        }
 
-        if (points.size() < 3) {
-          float xNew = static_cast<float>(points[0][1][0]);
-          float yNew = static_cast<float>(points[0][1][1]);
-          ret[0] = xNew;
-          ret[1] = yNew;
-          return ret;
+        // Consider the point at the root of this subtree.
+        size_t mid = begin + (end - begin) / 2;
+        double dx = x - m_points.m_fromX[mid];
+        double dy = y - m_points.m_fromY[mid];
+        nearest.insert(dx * dx + dy * dy, mid);
+
+        // Search the side of the splitting line that we're on first, then
+        // the other side only if it could hold a closer point than the
+        // farthest one we've kept.
+        double diff = (depth % 2 == 0) ? dx : dy;
+        if (diff < 0) {
+            findNearest(x, y, begin, mid, depth + 1, nearest);
+            if (!nearest.full() || diff * diff <= nearest.worst()) {
+                findNearest(x, y, mid + 1, end, depth + 1, nearest);
+            }
+        } else {
+            findNearest(x, y, mid + 1, end, depth + 1, nearest);
+            if (!nearest.full() || diff * diff <= nearest.worst()) {
+                findNearest(x, y, begin, mid, depth + 1, nearest);
+            }
         }
+    }
 
-        // Found three points -- interpolate them.
-        float xNew = static_cast<float>(interpolate(
-          points[0][0][0], points[0][0][1], points[0][1][0],
-          points[1][0][0], points[1][0][1], points[1][1][0],
-          points[2][0][0], points[2][0][1], points[2][1][0], xN,
-          yN));
-        float yNew = static_cast<float>(interpolate(
-          points[0][0][0], points[0][0][1], points[0][1][1],
-          points[1][0][0], points[1][0][1], points[1][1][1],
-          points[2][0][0], points[2][0][1], points[2][1][1], xN,
-          yN));
-        ret[0] = xNew;
-        ret[1] = yNew;
-        return ret;
+    size_t RenderManager::UnstructuredMeshInterpolator::getNearestPoints(
+        float xN, float yN, std::array<size_t, 3>& indicesOut) const {
+
+        // Find the three non-collinear points in the mesh that are nearest
+        // to the normalized point we are trying to look up.  We start by
+        // finding the nearest few points in the tree, selecting the first
+        // two, and then looking through the rest until we find one that is
+        // not collinear with the first two (normalized dot product
+        // magnitude far enough from 1).  If we don't find such points, we
+        // just go with the values from the closest point.
+        NeighborList nearest;
+        findNearest(xN, yN, 0, m_points.size(), 0, nearest);
+        if (nearest.size() == 0) {
+            return 0;
+        }
+        indicesOut[0] = nearest[0];
+        if (nearest.size() == 1) {
+            return 1;
+        }
+        indicesOut[1] = nearest[1];
+        const std::array<double, 2> first = m_points.from(indicesOut[0]);
+        const std::array<double, 2> second = m_points.from(indicesOut[1]);
+        for (size_t i = 2; i < nearest.size(); i++) {
+            if (!nearly_collinear(first, second, m_points.from(nearest[i]))) {
+                indicesOut[2] = nearest[i];
+                return 3;
+            }
+        }
+
+        // All of the nearest points were collinear with the first two, so
+        // look through the whole mesh for the closest one that is not.
+        // This is rare, and does not allocate; distances are computed a
+        // leaf-sized block at a time.
+        double bestDist2 = 0;
+        size_t count = 2;
+        std::array<double, LEAF_SIZE> dist2;
+        for (size_t begin = 0; begin < m_points.size(); begin += LEAF_SIZE) {
+            size_t num = std::min(LEAF_SIZE, m_points.size() - begin);
+            squaredDistances(xN, yN, begin, num, dist2.data());
+            for (size_t j = 0; j < num; j++) {
+                size_t i = begin + j;
+                if (i == indicesOut[0] || i == indicesOut[1]) {
+                    continue;
+                }
+                if ((count < 3 || dist2[j] < bestDist2) &&
+                    !nearly_collinear(first, second, m_points.from(i))) {
+                    indicesOut[2] = i;
+                    bestDist2 = dist2[j];
+                    count = 3;
+                }
+            }
+        }
+        return count;
     }
 
-    MonoPointDistortionMeshDescription
-      RenderManager::UnstructuredMeshInterpolator::getNearestPoints(
-          float xN, float yN,
-          const MonoPointDistortionMeshDescription &points) {
-
-      MonoPointDistortionMeshDescription ret;
-
-      // Find the three non-collinear points in the mesh that are nearest
-      // to the normalized point we are trying to look up.  We start by
-      // sorting the points based on distance from our location, selecting
-      // the first two, and then looking through the rest until we find
-      // one that is not collinear with the first two (normalized dot
-      // product magnitude far enough from 1).  If we don't find such
-      // points, we just go with the values from the closest point.
-      typedef std::multimap<double, size_t> PointDistanceIndexMap;
-      PointDistanceIndexMap map;
-      //if (points.size() < 460 && points.size() > 0) std::cout << "XXX Sorting mesh of size " << points.size() << std::endl;
-      for (size_t i = 0; i < points.size(); i++) {
-        // Insertion into the multimap sorts them by distance.
-        map.insert(std::make_pair(
-          pointDistance(xN, yN, points[i][0][0], points[i][0][1]), i));
-      }
+    Float2
+    RenderManager::UnstructuredMeshInterpolator::interpolateNearestPoints(
+        float xN, float yN) const {
+        Float2 ret = {};
 
-      PointDistanceIndexMap::const_iterator it = map.begin();
-      size_t first = it->second;
-      it++;
-      size_t second = it->second;
-      it++;
-      size_t third = first;
-      while (it != map.end()) {
-        if (!nearly_collinear(points[first][0], points[second][0],
-          points[it->second][0])) {
-          third = it->second;
-          break;
-        }
-        it++;
-      }
+        std::array<size_t, 3> indices;
+        size_t count = getNearestPoints(xN, yN, indices);
+        if (count == 0) {
+            return ret;
+        }
+        const PointMeshCoordinateArray& inX = m_points.m_fromX;
+        const PointMeshCoordinateArray& inY = m_points.m_fromY;
+        const PointMeshCoordinateArray& outX = m_points.m_toX;
+        const PointMeshCoordinateArray& outY = m_points.m_toY;
+        size_t i0 = indices[0];
 
-      // Push back all of the points we found, which may not include
-      // a third point if the first is the same as the third.
-      if (map.size() >= 1) { ret.push_back(points[first]); }
-      if (map.size() >= 2) { ret.push_back(points[second]); }
-      if (third != first) {
-        ret.push_back(points[third]);
-      }
-      return ret;
+        // If we didn't get three points, just return the output of
+        // the first point we found.
+        if (count < 3) {
+            ret[0] = static_cast<float>(outX[i0]);
+            ret[1] = static_cast<float>(outY[i0]);
+            return ret;
+        }
+
+        // Found three points -- interpolate them.
+        size_t i1 = indices[1];
+        size_t i2 = indices[2];
+        ret[0] = static_cast<float>(interpolate(
+            inX[i0], inY[i0], outX[i0], inX[i1], inY[i1], outX[i1], inX[i2],
+            inY[i2], outX[i2], xN, yN));
+        ret[1] = static_cast<float>(interpolate(
+            inX[i0], inY[i0], outY[i0], inX[i1], inY[i1], outY[i1], inX[i2],
+            inY[i2], outY[i2], xN, yN));
+        return ret;
     }
 
     Float2 RenderManager::DistortionCorrectTextureCoordinate(
         size_t eye //< Which eye?
         , Float2 const& inCoords //< Coordinates to modify
-        , DistortionParameters distort //< Distortion parameters
+        , DistortionParameters const& distort //< Distortion parameters
         , size_t color //< 0 = red, 1 = green, 2 = blue
         ) {
         Float2 ret = inCoords;
@@ -1982,7 +2722,7 @@ namespace renderkit {
                 return ret;
             }
 
-            MonoPointDistortionMeshDescription& points =
+            const MonoPointDistortionMeshDescription& points =
                 distort.m_monoPointSamples[eye];
             if (points.size() < 3) {
                 return ret;
@@ -2006,7 +2746,7 @@ namespace renderkit {
                 return ret;
             }
 
-            MonoPointDistortionMeshDescription& points =
+            const MonoPointDistortionMeshDescription& points =
                 distort.m_rgbPointSamples[color][eye];
             if (points.size() < 3) {
                 return ret;
@@ -2032,13 +2772,51 @@ namespace renderkit {
         return ret;
     }
 
-    std::vector<RenderManager::DistortionMeshVertex>
-    RenderManager::ComputeDistortionMesh(
+    /// Fill in the batched form of rgb_symmetric_polynomials parameters.
+    /// Returns false for parameters that DistortionCorrectTextureCoordinate()
+    /// would refuse to apply, in which case the batched path must not be
+    /// used.
+    static bool getRGBPolynomialDistortion(
+        RenderManager::DistortionParameters const& distort,
+        float overfillFactor, RGBPolynomialDistortion& out) {
+        if (distort.m_distortionPolynomialRed.size() < 2 ||
+            distort.m_distortionPolynomialGreen.size() < 2 ||
+            distort.m_distortionPolynomialBlue.size() < 2 ||
+            distort.m_distortionCOP.size() != 2 ||
+            distort.m_distortionD.size() != 2 ||
+            distort.m_distortionD[0] <= 0 || distort.m_distortionD[1] <= 0) {
+            return false;
+        }
+        out.m_overfillFactor = overfillFactor;
+        for (size_t i = 0; i < 2; i++) {
+            out.m_COP[i] = distort.m_distortionCOP[i];
+            out.m_D[i] = distort.m_distortionD[i];
+        }
+        out.m_polynomials[0] = distort.m_distortionPolynomialRed;
+        out.m_polynomials[1] = distort.m_distortionPolynomialGreen;
+        out.m_polynomials[2] = distort.m_distortionPolynomialBlue;
+        return true;
+    }
+
+    RenderManager::DistortionMesh RenderManager::ComputeDistortionMeshIndexed(
         size_t eye //< Which eye?
         , DistortionMeshType type //< Type of mesh to produce
-        , DistortionParameters distort //< Distortion parameters
+        , DistortionParameters const& distort //< Distortion parameters
+        , bool useCache //< Use the persistent mesh cache?
         ) {
-        std::vector<RenderManager::DistortionMeshVertex> ret;
+        DistortionMesh ret;
+
+        // If we have a cached copy of this mesh from an earlier run, use it
+        // rather than recomputing it.
+        useCache =
+            useCache && !m_params.m_distortionMeshCacheDirectory.empty();
+        uint64_t cacheKey = 0;
+        if (useCache) {
+            cacheKey = DistortionMeshCacheKey(eye, type, distort);
+            if (ReadCachedDistortionMesh(cacheKey, ret)) {
+                return ret;
+            }
+        }
 
         // Clear any created interpolators, freeing up their memory
         // first.  These may have been left behind by a failed
@@ -2053,28 +2831,28 @@ namespace renderkit {
         if (distort.m_type ==
             RenderManager::DistortionParameters::rgb_symmetric_polynomials) {
             if (distort.m_distortionPolynomialRed.size() < 2) {
-                std::cerr << "RenderManager::ComputeDistortionMesh: Need 2+ "
+                std::cerr << "RenderManager::ComputeDistortionMeshIndexed: Need 2+ "
                              "red polynomial coefficients, found "
                           << distort.m_distortionPolynomialRed.size()
                           << std::endl;
                 return ret;
             }
             if (distort.m_distortionPolynomialGreen.size() < 2) {
-                std::cerr << "RenderManager::ComputeDistortionMesh: Need 2+ "
+                std::cerr << "RenderManager::ComputeDistortionMeshIndexed: Need 2+ "
                              "green polynomial coefficients, found "
                           << distort.m_distortionPolynomialGreen.size()
                           << std::endl;
                 return ret;
             }
             if (distort.m_distortionPolynomialBlue.size() < 2) {
-                std::cerr << "RenderManager::ComputeDistortionMesh: Need 2+ "
+                std::cerr << "RenderManager::ComputeDistortionMeshIndexed: Need 2+ "
                              "blue polynomial coefficients, found "
                           << distort.m_distortionPolynomialBlue.size()
                           << std::endl;
                 return ret;
             }
             if (distort.m_distortionD.size() != 2) {
-                std::cerr << "RenderManager::ComputeDistortionMesh: Need 2 "
+                std::cerr << "RenderManager::ComputeDistortionMeshIndexed: Need 2 "
                              "distortion coefficients, found "
                           << distort.m_distortionD.size() << std::endl;
                 return ret;
@@ -2082,7 +2860,7 @@ namespace renderkit {
         } else if (distort.m_type ==
                    RenderManager::DistortionParameters::mono_point_samples) {
             if (distort.m_monoPointSamples.size() != 2) {
-                std::cerr << "RenderManager::ComputeDistortionMesh: Need 2 "
+                std::cerr << "RenderManager::ComputeDistortionMeshIndexed: Need 2 "
                              "meshes, found "
                           << distort.m_monoPointSamples.size() << std::endl;
                 return ret;
@@ -2090,7 +2868,7 @@ namespace renderkit {
             // Add a new interpolator to be used when we're finding
             // mesh coordinates.
             if (distort.m_monoPointSamples[eye].size() < 3) {
-                std::cerr << "RenderManager::ComputeDistortionMesh: Need "
+                std::cerr << "RenderManager::ComputeDistortionMeshIndexed: Need "
                               "3+ points, found "
                           << distort.m_monoPointSamples[eye].size()
                           << std::endl;
@@ -2100,7 +2878,7 @@ namespace renderkit {
                   i++) {
                 if (distort.m_monoPointSamples[eye][i].size() != 2) {
                     std::cerr
-                        << "RenderManager::ComputeDistortionMesh: Need 2 "
+                        << "RenderManager::ComputeDistortionMeshIndexed: Need 2 "
                         << "points in the mesh, found "
                         << distort.m_monoPointSamples[eye][i].size()
                         << std::endl;
@@ -2108,7 +2886,7 @@ namespace renderkit {
                 }
                 if (distort.m_monoPointSamples[eye][i][0].size() != 2) {
                     std::cerr
-                        << "RenderManager::ComputeDistortionMesh: Need 2 "
+                        << "RenderManager::ComputeDistortionMeshIndexed: Need 2 "
                         << "values in input point, found "
                         << distort.m_monoPointSamples[eye][i][0].size()
                         << std::endl;
@@ -2116,7 +2894,7 @@ namespace renderkit {
                 }
                 if (distort.m_monoPointSamples[eye][i][1].size() != 2) {
                     std::cerr
-                        << "RenderManager::ComputeDistortionMesh: Need 2 "
+                        << "RenderManager::ComputeDistortionMeshIndexed: Need 2 "
                         << "values in output point, found "
                         << distort.m_monoPointSamples[eye][i][1].size()
                         << std::endl;
@@ -2131,14 +2909,14 @@ namespace renderkit {
         else if (distort.m_type ==
                    RenderManager::DistortionParameters::rgb_point_samples) {
             if (distort.m_rgbPointSamples.size() != 3) {
-                std::cerr << "RenderManager::ComputeDistortionMesh: Need 3 "
+                std::cerr << "RenderManager::ComputeDistortionMeshIndexed: Need 3 "
                              "color meshes, found "
                           << distort.m_rgbPointSamples.size() << std::endl;
                 return ret;
             }
             for (size_t clr = 0; clr < 3; clr++) {
                 if (distort.m_rgbPointSamples[clr].size() != 2) {
-                    std::cerr << "RenderManager::ComputeDistortionMesh: Need 2 "
+                    std::cerr << "RenderManager::ComputeDistortionMeshIndexed: Need 2 "
                                  "eye meshes, found "
                               << distort.m_rgbPointSamples[clr].size()
                               << std::endl;
@@ -2148,7 +2926,7 @@ namespace renderkit {
                 // mesh coordinates.
                 if (distort.m_rgbPointSamples[clr][eye].size() < 3) {
                     std::cerr
-                        << "RenderManager::ComputeDistortionMesh: Need "
+                        << "RenderManager::ComputeDistortionMeshIndexed: Need "
                             "3+ points, found "
                         << distort.m_rgbPointSamples[clr][eye].size()
                         << std::endl;
@@ -2159,7 +2937,7 @@ namespace renderkit {
                     if (distort.m_rgbPointSamples[clr][eye][i].size() !=
                         2) {
                         std::cerr
-                            << "RenderManager::ComputeDistortionMesh: Need "
+                            << "RenderManager::ComputeDistortionMeshIndexed: Need "
                                 "2 "
                             << "points in the mesh, found "
                             << distort.m_rgbPointSamples[clr][eye][i].size()
@@ -2169,7 +2947,7 @@ namespace renderkit {
                     if (distort.m_rgbPointSamples[clr][eye][i][0].size() !=
                         2) {
                         std::cerr
-                            << "RenderManager::ComputeDistortionMesh: Need "
+                            << "RenderManager::ComputeDistortionMeshIndexed: Need "
                                 "2 "
                             << "values in input point, found "
                             << distort.m_rgbPointSamples[clr][eye][i][0]
@@ -2180,7 +2958,7 @@ namespace renderkit {
                     if (distort.m_rgbPointSamples[clr][eye][i][1].size() !=
                         2) {
                         std::cerr
-                            << "RenderManager::ComputeDistortionMesh: Need "
+                            << "RenderManager::ComputeDistortionMeshIndexed: Need "
                                 "2 "
                             << "values in output point, found "
                             << distort.m_rgbPointSamples[clr][eye][i][1]
@@ -2196,7 +2974,7 @@ namespace renderkit {
                   UnstructuredMeshInterpolator(distort.m_rgbPointSamples[clr][eye]));
             }
         } else {
-            std::cerr << "RenderManager::ComputeDistortionMesh: Unrecognized "
+            std::cerr << "RenderManager::ComputeDistortionMeshIndexed: Unrecognized "
                       << "distortion parameter type" << std::endl;
             return ret;
         }
@@ -2214,97 +2992,190 @@ namespace renderkit {
                 quadsPerSide = 1;
             }
 
+            // If we've been given an error tolerance, only refine the mesh
+            // as far as is needed to meet it.
+            if (distort.m_meshTolerancePixels > 0) {
+                if (!ComputeAdaptiveDistortionMesh(eye, distort, quadsPerSide,
+                                                   ret)) {
+                    ret = DistortionMesh();
+                }
+                break;
+            }
+            int verticesPerSide = quadsPerSide + 1;
+
             // Figure out how large each quad will be.  Recall that we're
             // covering a range of 2 (from -1 to 1) in each dimension, so the
             // quads will all be square in texture space.
             float quadSide = 2.0f / quadsPerSide;
             float quadTexSide = 1.0f / quadsPerSide;
 
-            // Generate a pair of triangles for each quad, wound
-            // counter-clockwise, with appropriate spatial location and texture
-            // coordinates.
+            // All lookups share the same (referenced) distortion parameters.
+            auto correct = [&](Float2 const& tex, size_t color) {
+                return DistortionCorrectTextureCoordinate(eye, tex, distort,
+                                                          color);
+            };
+
+            // Polynomial distortion can be evaluated for a whole column of
+            // vertices at a time, for all three colors at once.
+            RGBPolynomialDistortion polynomial;
+            bool batch =
+                distort.m_type == RenderManager::DistortionParameters::
+                                      rgb_symmetric_polynomials &&
+                getRGBPolynomialDistortion(
+                    distort, m_params.m_renderOverfillFactor, polynomial);
+
+            // Generate the grid vertices in the columns [xBegin, xEnd), with
+            // appropriate spatial location and texture coordinates.
             // Compute distorted texture coordinates and use those for each
-            // vertex.
+            // vertex.  Each vertex is computed only once, no matter how many
+            // triangles share it.
+            auto buildColumns = [&](int xBegin, int xEnd,
+                                    std::vector<DistortionMeshVertex>& out) {
+                out.reserve((xEnd - xBegin) * verticesPerSide);
+
+                // Scratch space for the batched path, reused for each
+                // column.
+                std::vector<float> texX, texY;
+                std::array<std::vector<float>, 3> outX, outY;
+                if (batch) {
+                    texX.resize(verticesPerSide);
+                    texY.resize(verticesPerSide);
+                    for (size_t clr = 0; clr < 3; clr++) {
+                        outX[clr].resize(verticesPerSide);
+                        outY[clr].resize(verticesPerSide);
+                    }
+                }
 
-            // total of quadsPerSide * quadsPerSide * 6 vertices added: reserve
-            // that space to avoid excess copying during mesh generation.
-            ret.reserve(quadsPerSide * quadsPerSide * 6);
+                for (int x = xBegin; x < xEnd; x++) {
+                    float xPos = -1 + x * quadSide;
+                    float xTex = x * quadTexSide;
+
+                    if (batch) {
+                        for (int y = 0; y < verticesPerSide; y++) {
+                            texX[y] = xTex;
+                            texY[y] = y * quadTexSide;
+                        }
+                        distortRGBPolynomialBatch(
+                            polynomial, verticesPerSide, texX.data(),
+                            texY.data(), {{outX[0].data(), outX[1].data(),
+                                           outX[2].data()}},
+                            {{outY[0].data(), outY[1].data(),
+                              outY[2].data()}});
+                        for (int y = 0; y < verticesPerSide; y++) {
+                            Float2 pos = {xPos, -1 + y * quadSide};
+                            Float2 texR = {outX[0][y], outY[0][y]};
+                            Float2 texG = {outX[1][y], outY[1][y]};
+                            Float2 texB = {outX[2][y], outY[2][y]};
+                            out.emplace_back(pos, texR, texG, texB);
+                        }
+                        continue;
+                    }
 
-            for (int x = 0; x < quadsPerSide; x++) {
-                float xLow = -1 + x * quadSide;
-                float xHigh = -1 + (x + 1) * quadSide;
-                float xTexLow = x * quadTexSide;
-                float xTexHigh = (x + 1) * quadTexSide;
+                    for (int y = 0; y < verticesPerSide; y++) {
+                        float yPos = -1 + y * quadSide;
+                        float yTex = y * quadTexSide;
 
+                        Float2 pos = {xPos, yPos};
+                        Float2 tex = {xTex, yTex};
+                        out.emplace_back(pos, correct(tex, 0),
+                                         correct(tex, 1), correct(tex, 2));
+                    }
+                }
+            };
+
+            // Split the columns into contiguous bands, one per hardware
+            // thread, and build each band on its own thread.  The texture
+            // lookups only read the distortion parameters and the
+            // interpolators, so they can safely run concurrently.  The
+            // bands are appended in order afterwards, so the result is
+            // identical to building the whole mesh on one thread.
+            // Exceptions are caught within each band and rethrown once
+            // every thread has been joined, because destroying a joinable
+            // thread would terminate the program.  Bands whose threads
+            // could not be started are built on this thread instead.
+            int numBands =
+                static_cast<int>(std::thread::hardware_concurrency());
+            if (numBands < 1) {
+                numBands = 1;
+            }
+            if (numBands > verticesPerSide) {
+                numBands = verticesPerSide;
+            }
+            std::vector<std::vector<DistortionMeshVertex> > bands(numBands);
+            auto bandBegin = [&](int band) {
+                return band * verticesPerSide / numBands;
+            };
+            std::vector<std::exception_ptr> bandErrors(numBands);
+            auto buildBand = [&](int band) {
+                try {
+                    buildColumns(bandBegin(band), bandBegin(band + 1),
+                                 bands[band]);
+                } catch (...) {
+                    bandErrors[band] = std::current_exception();
+                }
+            };
+            std::vector<std::thread> workers;
+            workers.reserve(numBands - 1);
+            int firstInlineBand = 1;
+            for (; firstInlineBand < numBands; firstInlineBand++) {
+                try {
+                    workers.emplace_back(buildBand, firstInlineBand);
+                } catch (std::system_error const&) {
+                    break;
+                }
+            }
+            buildBand(0);
+            for (int band = firstInlineBand; band < numBands; band++) {
+                buildBand(band);
+            }
+            for (size_t i = 0; i < workers.size(); i++) {
+                workers[i].join();
+            }
+            for (size_t band = 0; band < bandErrors.size(); band++) {
+                if (bandErrors[band]) {
+                    std::rethrow_exception(bandErrors[band]);
+                }
+            }
+
+            ret.m_vertices.reserve(verticesPerSide * verticesPerSide);
+            for (size_t band = 0; band < bands.size(); band++) {
+                ret.m_vertices.insert(ret.m_vertices.end(),
+                                      bands[band].begin(), bands[band].end());
+            }
+
+            // Generate a pair of triangles for each quad, wound
+            // counter-clockwise, referring to the shared grid vertices
+            // (stored in column-major order).
+            ret.m_indices.reserve(quadsPerSide * quadsPerSide * 6);
+            for (int x = 0; x < quadsPerSide; x++) {
                 for (int y = 0; y < quadsPerSide; y++) {
-                    /// 6 vertices per inner loop
-                    float yLow = -1 + y * quadSide;
-                    float yHigh = -1 + (y + 1) * quadSide;
-                    float yTexLow = y * quadTexSide;
-                    float yTexHigh = (y + 1) * quadTexSide;
-
-                    Float2 posLL = { xLow, yLow };
-                    Float2 posLH = { xLow, yHigh };
-                    Float2 posHL = { xHigh, yLow };
-                    Float2 posHH = { xHigh, yHigh };
-
-                    Float2 texLL = {xTexLow, yTexLow};
-                    Float2 texLH = {xTexLow, yTexHigh};
-                    Float2 texHL = {xTexHigh, yTexLow};
-                    Float2 texHH = {xTexHigh, yTexHigh};
-
-                    // First triangle - emplace DistortionMeshVertex
-                    ret.emplace_back(posLL, DistortionCorrectTextureCoordinate(
-                                                eye, texLL, distort, 0),
-                                     DistortionCorrectTextureCoordinate(
-                                         eye, texLL, distort, 1),
-                                     DistortionCorrectTextureCoordinate(
-                                         eye, texLL, distort, 2));
-                    ret.emplace_back(posHL, DistortionCorrectTextureCoordinate(
-                                                eye, texHL, distort, 0),
-                                     DistortionCorrectTextureCoordinate(
-                                         eye, texHL, distort, 1),
-                                     DistortionCorrectTextureCoordinate(
-                                         eye, texHL, distort, 2));
-                    ret.emplace_back(posHH, DistortionCorrectTextureCoordinate(
-                                                eye, texHH, distort, 0),
-                                     DistortionCorrectTextureCoordinate(
-                                         eye, texHH, distort, 1),
-                                     DistortionCorrectTextureCoordinate(
-                                         eye, texHH, distort, 2));
+                    uint32_t LL = x * verticesPerSide + y;
+                    uint32_t LH = LL + 1;
+                    uint32_t HL = LL + verticesPerSide;
+                    uint32_t HH = HL + 1;
+
+                    // First triangle
+                    ret.m_indices.push_back(LL);
+                    ret.m_indices.push_back(HL);
+                    ret.m_indices.push_back(HH);
 
                     // Second triangle
-                    ret.emplace_back(posLL, DistortionCorrectTextureCoordinate(
-                                                eye, texLL, distort, 0),
-                                     DistortionCorrectTextureCoordinate(
-                                         eye, texLL, distort, 1),
-                                     DistortionCorrectTextureCoordinate(
-                                         eye, texLL, distort, 2));
-                    ret.emplace_back(posHH, DistortionCorrectTextureCoordinate(
-                                                eye, texHH, distort, 0),
-                                     DistortionCorrectTextureCoordinate(
-                                         eye, texHH, distort, 1),
-                                     DistortionCorrectTextureCoordinate(
-                                         eye, texHH, distort, 2));
-                    ret.emplace_back(posLH, DistortionCorrectTextureCoordinate(
-                                                eye, texLH, distort, 0),
-                                     DistortionCorrectTextureCoordinate(
-                                         eye, texLH, distort, 1),
-                                     DistortionCorrectTextureCoordinate(
-                                         eye, texLH, distort, 2));
+                    ret.m_indices.push_back(LL);
+                    ret.m_indices.push_back(HH);
+                    ret.m_indices.push_back(LH);
                 }
             }
         } break;
         case RADIAL: {
             std::cerr
-                << "RenderManager::ComputeDistortionMesh: Radial mesh type "
+                << "RenderManager::ComputeDistortionMeshIndexed: Radial mesh type "
                 << "not yet implemented" << std::endl;
 
             // @todo Scale the aspect ratio of the rings around the center of
             // projection so that they will be round in the visible display.
         } break;
         default:
-            std::cerr << "RenderManager::ComputeDistortionMesh: Unsupported "
+            std::cerr << "RenderManager::ComputeDistortionMeshIndexed: Unsupported "
                          "mesh type: "
                       << type << std::endl;
         }
@@ -2316,9 +3187,586 @@ namespace renderkit {
         }
         m_interpolators.clear();
 
+        // Store the mesh so that later runs can skip computing it.
+        if (useCache && !ret.m_indices.empty()) {
+            WriteCachedDistortionMesh(cacheKey, ret);
+        }
+
         return ret;
     }
 
+    bool RenderManager::ComputeAdaptiveDistortionMesh(
+        size_t eye //< Which eye?
+        , DistortionParameters const& distort //< Distortion parameters
+        , int maxQuadsPerSide //< Finest resolution to refine to
+        , DistortionMesh& meshOut //< Filled in with the mesh
+        ) {
+        // Find the size in pixels of the texture that the coordinates
+        // index into, so that we can measure errors in pixels.
+        OSVR_ViewportDescription viewport;
+        if (!ConstructViewportForRender(eye, viewport)) {
+            std::cerr << "RenderManager::ComputeAdaptiveDistortionMesh: "
+                         "Could not get render viewport for eye "
+                      << eye << std::endl;
+            return false;
+        }
+        float texWidth = static_cast<float>(viewport.width);
+        float texHeight = static_cast<float>(viewport.height);
+
+        // Quads are addressed by integer coordinates on the finest grid,
+        // which has a power-of-two number of quads on a side so that each
+        // split lands on grid points.  Refinement starts from a 4x4 grid
+        // so that small features near the center are not skipped.
+        int finest = 1;
+        while (finest < maxQuadsPerSide && finest < (1 << 12)) {
+            finest *= 2;
+        }
+        int coarsest = std::max(1, finest / 4);
+        uint64_t stride = static_cast<uint64_t>(finest) + 1;
+
+        auto evaluate = [&](int i, int j) {
+            float tx = static_cast<float>(i) / finest;
+            float ty = static_cast<float>(j) / finest;
+            Float2 pos = {-1 + 2 * tx, -1 + 2 * ty};
+            Float2 tex = {tx, ty};
+            return DistortionMeshVertex(
+                pos, DistortionCorrectTextureCoordinate(eye, tex, distort, 0),
+                DistortionCorrectTextureCoordinate(eye, tex, distort, 1),
+                DistortionCorrectTextureCoordinate(eye, tex, distort, 2));
+        };
+
+        // Vertices that are part of the mesh, by grid location.
+        std::vector<DistortionMeshVertex> vertices;
+        std::unordered_map<uint64_t, uint32_t> vertexIndex;
+        auto findVertex = [&](int i, int j) {
+            auto found = vertexIndex.find(i * stride + j);
+            if (found == vertexIndex.end()) {
+                return static_cast<int64_t>(-1);
+            }
+            return static_cast<int64_t>(found->second);
+        };
+        auto addVertex = [&](int i, int j) {
+            int64_t index = findVertex(i, j);
+            if (index >= 0) {
+                return static_cast<uint32_t>(index);
+            }
+            uint32_t added = static_cast<uint32_t>(vertices.size());
+            vertices.push_back(evaluate(i, j));
+            vertexIndex[i * stride + j] = added;
+            return added;
+        };
+
+        // How far, in pixels, is the vertex at (i,j) from the average of
+        // the vertices a and b (which is what linear interpolation would
+        // give there)?  Uses the worst of the three colors.
+        auto error = [&](int i, int j, uint32_t a, uint32_t b) {
+            int64_t existing = findVertex(i, j);
+            DistortionMeshVertex v =
+                existing >= 0 ? vertices[static_cast<size_t>(existing)]
+                              : evaluate(i, j);
+            const DistortionMeshVertex& va = vertices[a];
+            const DistortionMeshVertex& vb = vertices[b];
+            float worst = 0;
+            const Float2 DistortionMeshVertex::*colors[3] = {
+                &DistortionMeshVertex::m_texRed,
+                &DistortionMeshVertex::m_texGreen,
+                &DistortionMeshVertex::m_texBlue};
+            for (size_t clr = 0; clr < 3; clr++) {
+                Float2 const& t = v.*colors[clr];
+                Float2 const& ta = va.*colors[clr];
+                Float2 const& tb = vb.*colors[clr];
+                float dx = std::fabs(t[0] - 0.5f * (ta[0] + tb[0]));
+                float dy = std::fabs(t[1] - 0.5f * (ta[1] + tb[1]));
+                worst = std::max(worst, std::max(dx * texWidth,
+                                                 dy * texHeight));
+            }
+            return worst;
+        };
+
+        // Refine quads, described by their lower-left corner and size,
+        // until they are accurate enough or as small as allowed.
+        struct Quad {
+            int i, j, size;
+        };
+        std::vector<Quad> pending;
+        std::vector<Quad> leaves;
+        for (int i = 0; i < finest; i += coarsest) {
+            for (int j = 0; j < finest; j += coarsest) {
+                Quad q = {i, j, coarsest};
+                pending.push_back(q);
+            }
+        }
+        while (!pending.empty()) {
+            Quad q = pending.back();
+            pending.pop_back();
+            int i = q.i, j = q.j, s = q.size, h = q.size / 2;
+            uint32_t LL = addVertex(i, j);
+            uint32_t HL = addVertex(i + s, j);
+            uint32_t HH = addVertex(i + s, j + s);
+            uint32_t LH = addVertex(i, j + s);
+
+            // Check the edge midpoints and the center, which lies on the
+            // LL-HH diagonal that splits the quad into two triangles.
+            bool split = false;
+            if (s > 1) {
+                float worst = error(i + h, j + h, LL, HH);
+                worst = std::max(worst, error(i + h, j, LL, HL));
+                worst = std::max(worst, error(i + s, j + h, HL, HH));
+                worst = std::max(worst, error(i + h, j + s, LH, HH));
+                worst = std::max(worst, error(i, j + h, LL, LH));
+                split = worst > distort.m_meshTolerancePixels;
+            }
+            if (split) {
+                Quad children[4] = {{i, j, h},
+                                    {i + h, j, h},
+                                    {i, j + h, h},
+                                    {i + h, j + h, h}};
+                pending.insert(pending.end(), children, children + 4);
+            } else {
+                leaves.push_back(q);
+            }
+        }
+
+        // Triangulate each leaf, wound counter-clockwise.  A leaf whose
+        // edges hold corners of smaller neighbors is drawn as a fan around
+        // its center through all of its edge vertices, which avoids
+        // cracks along the T-junctions.
+        std::vector<uint32_t> indices;
+        std::vector<uint32_t> boundary;
+        for (size_t l = 0; l < leaves.size(); l++) {
+            int i = leaves[l].i, j = leaves[l].j, s = leaves[l].size;
+            boundary.clear();
+            const int di[4] = {1, 0, -1, 0};
+            const int dj[4] = {0, 1, 0, -1};
+            int ci = i, cj = j;
+            for (int side = 0; side < 4; side++) {
+                for (int step = 0; step < s; step++) {
+                    int64_t index = findVertex(ci, cj);
+                    if (index >= 0) {
+                        boundary.push_back(static_cast<uint32_t>(index));
+                    }
+                    ci += di[side];
+                    cj += dj[side];
+                }
+            }
+            if (boundary.size() == 4) {
+                indices.push_back(boundary[0]);
+                indices.push_back(boundary[1]);
+                indices.push_back(boundary[2]);
+                indices.push_back(boundary[0]);
+                indices.push_back(boundary[2]);
+                indices.push_back(boundary[3]);
+            } else {
+                uint32_t center = addVertex(i + s / 2, j + s / 2);
+                for (size_t b = 0; b < boundary.size(); b++) {
+                    indices.push_back(center);
+                    indices.push_back(boundary[b]);
+                    indices.push_back(boundary[(b + 1) % boundary.size()]);
+                }
+            }
+        }
+
+        meshOut.m_vertices.swap(vertices);
+        meshOut.m_indices.swap(indices);
+        return true;
+    }
+
+    std::vector<RenderManager::DistortionMeshVertex>
+    RenderManager::ComputeDistortionMesh(
+        size_t eye //< Which eye?
+        , DistortionMeshType type //< Type of mesh to produce
+        , DistortionParameters const& distort //< Distortion parameters
+        ) {
+        // Expand the indexed mesh into separate vertices for each triangle.
+        DistortionMesh mesh = ComputeDistortionMeshIndexed(eye, type, distort);
+        std::vector<DistortionMeshVertex> ret;
+        ret.reserve(mesh.m_indices.size());
+        for (size_t i = 0; i < mesh.m_indices.size(); i++) {
+            ret.push_back(mesh.m_vertices[mesh.m_indices[i]]);
+        }
+        return ret;
+    }
+
+    bool RenderManager::ComputeDistortionLookupTable(
+        size_t eye //< Which eye?
+        , size_t color //< 0 = red, 1 = green, 2 = blue
+        , DistortionParameters const& distort //< Distortion parameters
+        , float overfillFactor //< m_params.m_renderOverfillFactor
+        , size_t resolution //< Width and height of the table
+        , std::vector<float>& tableOut //< Filled in with u,v pairs
+        ) {
+        tableOut.clear();
+        if (color > 2 || resolution == 0) {
+            return false;
+        }
+
+        // Find the point samples for this eye and color.
+        const MonoPointDistortionMeshDescription* points = nullptr;
+        if (distort.m_type == DistortionParameters::mono_point_samples) {
+            if (eye < distort.m_monoPointSamples.size()) {
+                points = &distort.m_monoPointSamples[eye];
+            }
+        } else if (distort.m_type == DistortionParameters::rgb_point_samples) {
+            if (eye < distort.m_rgbPointSamples[color].size()) {
+                points = &distort.m_rgbPointSamples[color][eye];
+            }
+        }
+        if (points == nullptr || points->size() < 3) {
+            std::cerr << "RenderManager::ComputeDistortionLookupTable: Need "
+                         "3+ point samples for eye "
+                      << eye << std::endl;
+            return false;
+        }
+        UnstructuredMeshInterpolator interpolator(*points);
+
+        // Sample at the center of each texel, converting from overfill
+        // space to normalized space and back just as
+        // DistortionCorrectTextureCoordinate() does.
+        tableOut.resize(resolution * resolution * 2);
+        float* out = tableOut.data();
+        for (size_t row = 0; row < resolution; row++) {
+            float v = (row + 0.5f) / resolution;
+            float yN = (v - 0.5f) * overfillFactor + 0.5f;
+            for (size_t col = 0; col < resolution; col++) {
+                float u = (col + 0.5f) / resolution;
+                float xN = (u - 0.5f) * overfillFactor + 0.5f;
+                Float2 tex = interpolator.interpolateNearestPoints(xN, yN);
+                *out++ = (tex[0] - 0.5f) / overfillFactor + 0.5f;
+                *out++ = (tex[1] - 0.5f) / overfillFactor + 0.5f;
+            }
+        }
+        return true;
+    }
+
+    /// Version of the distortion mesh cache file format and of the
+    /// information that goes into its key.  Increment this whenever
+    /// either one changes, or whenever the mesh-construction code
+    /// changes the meshes it produces, so that stale entries are
+    /// ignored.
+    static const uint32_t DISTORTION_MESH_CACHE_VERSION = 1;
+
+    /// Header at the start of each distortion mesh cache file; it is
+    /// followed by the vertices and then the indices.
+    struct DistortionMeshCacheHeader {
+        char m_magic[8];       //< "OSVRDMC" plus terminating zero
+        uint32_t m_version;    //< DISTORTION_MESH_CACHE_VERSION
+        uint32_t m_vertexSize; //< Bytes per vertex
+        uint64_t m_key;        //< Key the mesh was stored under
+        uint64_t m_numVertices;
+        uint64_t m_numIndices;
+    };
+    static const char DISTORTION_MESH_CACHE_MAGIC[8] = "OSVRDMC";
+
+    /// Accumulates a 64-bit FNV-1a hash over the bytes of the values
+    /// passed to it.
+    class DistortionMeshCacheHash {
+      public:
+        template <typename T> void add(T const& value) {
+            addBytes(&value, sizeof(value));
+        }
+        template <typename T> void add(std::vector<T> const& values) {
+            add(static_cast<uint64_t>(values.size()));
+            if (!values.empty()) {
+                addBytes(values.data(), values.size() * sizeof(T));
+            }
+        }
+        void addBytes(const void* data, size_t len) {
+            const unsigned char* bytes =
+                static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < len; i++) {
+                m_hash ^= bytes[i];
+                m_hash *= 1099511628211ULL;
+            }
+        }
+        uint64_t get() const { return m_hash; }
+
+      private:
+        uint64_t m_hash = 14695981039346656037ULL;
+    };
+
+    uint64_t RenderManager::DistortionMeshCacheKey(
+        size_t eye, DistortionMeshType type,
+        DistortionParameters const& distort) {
+        DistortionMeshCacheHash hash;
+        hash.add(DISTORTION_MESH_CACHE_VERSION);
+        hash.add(static_cast<uint64_t>(eye));
+        hash.add(static_cast<int32_t>(type));
+        hash.add(static_cast<int32_t>(distort.m_type));
+        hash.add(static_cast<uint64_t>(distort.m_desiredTriangles));
+        hash.add(distort.m_meshTolerancePixels);
+
+        // Only the parameters for the type of distortion in use, and only
+        // the meshes for this eye, affect the result.
+        switch (distort.m_type) {
+        case DistortionParameters::rgb_symmetric_polynomials:
+            hash.add(distort.m_distortionPolynomialRed);
+            hash.add(distort.m_distortionPolynomialGreen);
+            hash.add(distort.m_distortionPolynomialBlue);
+            hash.add(distort.m_distortionCOP);
+            hash.add(distort.m_distortionD);
+            break;
+        case DistortionParameters::mono_point_samples:
+            if (eye < distort.m_monoPointSamples.size()) {
+                hash.add(distort.m_monoPointSamples[eye]);
+            }
+            break;
+        case DistortionParameters::rgb_point_samples:
+            for (size_t clr = 0; clr < distort.m_rgbPointSamples.size();
+                 clr++) {
+                if (eye < distort.m_rgbPointSamples[clr].size()) {
+                    hash.add(distort.m_rgbPointSamples[clr][eye]);
+                }
+            }
+            break;
+        default:
+            break;
+        }
+
+        hash.add(m_params.m_renderOverfillFactor);
+        hash.add(m_params.m_renderOversampleFactor);
+        hash.add(static_cast<int32_t>(m_params.m_displayRotation));
+
+        // Adaptive meshes measure their error in render-buffer pixels.
+        hash.add(static_cast<int32_t>(m_displayWidth));
+        hash.add(static_cast<int32_t>(m_displayHeight));
+        return hash.get();
+    }
+
+    std::string RenderManager::DistortionMeshCachePath(uint64_t key) {
+        std::ostringstream path;
+        path << m_params.m_distortionMeshCacheDirectory;
+        char last = m_params.m_distortionMeshCacheDirectory.back();
+        if (last != '/' && last != '\\') {
+            path << "/";
+        }
+        path << "osvr_distortion_mesh_" << std::hex << std::setw(16)
+             << std::setfill('0') << key << ".bin";
+        return path.str();
+    }
+
+    /// Creates a new file for writing, failing rather than opening one
+    /// that already exists (or following a link planted in its place),
+    /// readable and writable only by the current user where the platform
+    /// supports it.  Returns nullptr on failure.
+    static FILE* createFileExclusive(const std::string& path) {
+#ifdef _WIN32
+        int fd = -1;
+        if (_sopen_s(&fd, path.c_str(),
+                     _O_WRONLY | _O_CREAT | _O_EXCL | _O_BINARY, _SH_DENYRW,
+                     _S_IREAD | _S_IWRITE) != 0) {
+            return nullptr;
+        }
+        FILE* file = _fdopen(fd, "wb");
+        if (file == nullptr) {
+            _close(fd);
+        }
+#else
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0600);
+        if (fd < 0) {
+            return nullptr;
+        }
+        FILE* file = fdopen(fd, "wb");
+        if (file == nullptr) {
+            close(fd);
+        }
+#endif
+        return file;
+    }
+
+    /// Returns a name for a temporary file next to path that no other
+    /// process or thread will choose at the same time.
+    static std::string uniqueTempPath(const std::string& path) {
+        static std::atomic<unsigned> s_count(0);
+#ifdef _WIN32
+        int pid = _getpid();
+#else
+        int pid = static_cast<int>(getpid());
+#endif
+        std::ostringstream temp;
+        temp << path << "." << pid << "." << s_count++ << ".tmp";
+        return temp.str();
+    }
+
+    bool RenderManager::ReadCachedDistortionMesh(uint64_t key,
+                                                 DistortionMesh& meshOut) {
+        std::string path = DistortionMeshCachePath(key);
+#ifndef _WIN32
+        // Only trust cache files that we wrote ourselves.
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) {
+            return false;
+        }
+        if (info.st_uid != geteuid()) {
+            std::cerr << "RenderManager::ReadCachedDistortionMesh: Cache file "
+                      << path << " belongs to another user, ignoring it"
+                      << std::endl;
+            return false;
+        }
+#endif
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file) {
+            return false;
+        }
+
+        // Make sure that this is a file we wrote, with the same format and
+        // key, before reading the mesh.
+        DistortionMeshCacheHeader header;
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!file ||
+            memcmp(header.m_magic, DISTORTION_MESH_CACHE_MAGIC,
+                   sizeof(header.m_magic)) != 0 ||
+            header.m_version != DISTORTION_MESH_CACHE_VERSION ||
+            header.m_vertexSize != sizeof(DistortionMeshVertex) ||
+            header.m_key != key || header.m_numIndices % 3 != 0) {
+            return false;
+        }
+
+        Float2 zero = {};
+        DistortionMesh mesh;
+        mesh.m_vertices.assign(static_cast<size_t>(header.m_numVertices),
+                               DistortionMeshVertex(zero, zero, zero, zero));
+        mesh.m_indices.resize(static_cast<size_t>(header.m_numIndices));
+        file.read(reinterpret_cast<char*>(mesh.m_vertices.data()),
+                  mesh.m_vertices.size() * sizeof(DistortionMeshVertex));
+        file.read(reinterpret_cast<char*>(mesh.m_indices.data()),
+                  mesh.m_indices.size() * sizeof(uint32_t));
+        if (!file) {
+            std::cerr << "RenderManager::ReadCachedDistortionMesh: Truncated "
+                         "cache file "
+                      << DistortionMeshCachePath(key) << ", ignoring it"
+                      << std::endl;
+            return false;
+        }
+        for (size_t i = 0; i < mesh.m_indices.size(); i++) {
+            if (mesh.m_indices[i] >= mesh.m_vertices.size()) {
+                std::cerr << "RenderManager::ReadCachedDistortionMesh: Bad "
+                             "index in cache file "
+                          << DistortionMeshCachePath(key) << ", ignoring it"
+                          << std::endl;
+                return false;
+            }
+        }
+
+        meshOut = std::move(mesh);
+        return true;
+    }
+
+    bool RenderManager::WriteCachedDistortionMesh(uint64_t key,
+                                                  DistortionMesh const& mesh) {
+        // Write to a new temporary file with a name of our own and then
+        // move it into place, so that a reader never sees a
+        // partially-written file and two writers of the same mesh do not
+        // write into the same file.
+        std::string path = DistortionMeshCachePath(key);
+        std::string tempPath = uniqueTempPath(path);
+        FILE* file = createFileExclusive(tempPath);
+        if (file == nullptr) {
+            std::cerr << "RenderManager::WriteCachedDistortionMesh: Could "
+                         "not create "
+                      << tempPath << std::endl;
+            return false;
+        }
+
+        DistortionMeshCacheHeader header;
+        memcpy(header.m_magic, DISTORTION_MESH_CACHE_MAGIC,
+               sizeof(header.m_magic));
+        header.m_version = DISTORTION_MESH_CACHE_VERSION;
+        header.m_vertexSize = sizeof(DistortionMeshVertex);
+        header.m_key = key;
+        header.m_numVertices = mesh.m_vertices.size();
+        header.m_numIndices = mesh.m_indices.size();
+        bool written =
+            fwrite(&header, sizeof(header), 1, file) == 1 &&
+            fwrite(mesh.m_vertices.data(), sizeof(DistortionMeshVertex),
+                   mesh.m_vertices.size(),
+                   file) == mesh.m_vertices.size() &&
+            fwrite(mesh.m_indices.data(), sizeof(uint32_t),
+                   mesh.m_indices.size(), file) == mesh.m_indices.size();
+        if (fclose(file) != 0) {
+            written = false;
+        }
+        if (!written) {
+            std::cerr << "RenderManager::WriteCachedDistortionMesh: Could "
+                         "not write "
+                      << tempPath << std::endl;
+            std::remove(tempPath.c_str());
+            return false;
+        }
+
+        // On POSIX systems, rename() atomically replaces any existing
+        // file.  On Windows it fails instead, so we remove the old one and
+        // try again; a reader in between just recomputes the mesh.
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+#ifdef _WIN32
+            std::remove(path.c_str());
+            if (std::rename(tempPath.c_str(), path.c_str()) == 0) {
+                return true;
+            }
+#endif
+            std::remove(tempPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    /// Creates a directory that only the current user can use, unless it
+    /// is already there.  Returns false if it could not be created.
+    static bool makeUserDirectory(const std::string& dir) {
+#ifdef _WIN32
+        return _mkdir(dir.c_str()) == 0 || errno == EEXIST;
+#else
+        return mkdir(dir.c_str(), 0700) == 0 || errno == EEXIST;
+#endif
+    }
+
+    /// Returns the directory to use for caches when none is specified:
+    /// one private to the current user (under LOCALAPPDATA on Windows and
+    /// XDG_CACHE_HOME or ~/.cache elsewhere), created if needed.  Returns
+    /// an empty string if there is none, which disables the cache.
+    static std::string defaultCacheDirectory() {
+#ifdef _WIN32
+        const char* base = getenv("LOCALAPPDATA");
+        if (base == nullptr || base[0] == '\0') {
+            return "";
+        }
+        std::string parent = std::string(base) + "\\OSVR";
+        std::string dir = parent + "\\RenderManager";
+#else
+        std::string parent;
+        const char* xdg = getenv("XDG_CACHE_HOME");
+        const char* home = getenv("HOME");
+        if (xdg != nullptr && xdg[0] == '/') {
+            parent = xdg;
+        } else if (home != nullptr && home[0] == '/') {
+            parent = std::string(home) + "/.cache";
+        } else {
+            return "";
+        }
+        std::string dir = parent + "/osvr-rendermanager";
+#endif
+        if (!makeUserDirectory(parent) || !makeUserDirectory(dir)) {
+            return "";
+        }
+        return dir;
+    }
+
+    /// Parses the RenderManager configuration string into a JSON value,
+    /// so that we can read settings that the Core configuration class
+    /// does not know about.  Returns the inner renderManagerConfig object
+    /// if there is one, or a null value on failure.
+    static Json::Value getRenderManagerConfigJson(
+        const std::string& configString) {
+        Json::Value root;
+        Json::Reader reader;
+        if (!reader.parse(configString, root, false) || !root.isObject()) {
+            return Json::Value();
+        }
+        if (root.isMember("renderManagerConfig")) {
+            return root["renderManagerConfig"];
+        }
+        return root;
+    }
+
     static std::string osvrRenderManagerGetString(OSVR_ClientContext context,
                                                   const std::string& path) {
         size_t len;
@@ -2384,7 +3832,7 @@ namespace renderkit {
         m_pnpIds.emplace_back(std::move(id));
     }
 
-#ifdef RM_USE_D3D11
+#ifdef RM_USE_D3D11
     /// Used to open a Direct3D DirectRender RenderManager based on
     /// what kind of graphics card is installed in the machine.
     static RenderManagerD3D11Base *openRenderManagerDirectMode(
@@ -2423,7 +3871,7 @@ namespace renderkit {
 #endif
       return ret;
     }
-#endif
+#endif
 
     //=======================================================================
     // Factory to create a specific instance of a RenderManager is below.
@@ -2433,57 +3881,87 @@ namespace renderkit {
     RenderManager* createRenderManager(OSVR_ClientContext contextIgnored,
                                        const std::string& renderLibraryName,
                                        GraphicsLibrary graphicsLibrary) {
+        return createRenderManager(std::shared_ptr<PoseSource>(),
+                                   renderLibraryName, graphicsLibrary);
+    }
+
+    RenderManager* createRenderManager(std::shared_ptr<PoseSource> poseSource,
+                                       const std::string& renderLibraryName,
+                                       GraphicsLibrary graphicsLibrary) {
         // Null pointer return in case we can't open one.
         std::unique_ptr<RenderManager> ret;
 
-        /// @todo Clone the passed-in context rather than creating our own, when
-        // this function is added to Core.
-        // Construct the context we're going to pass it.
-        // @todo Destroy the context at the appropriate time.  Need to make sure
-        // this happens only once, so we'd like to use a shared_ptr() on the
-        // basic struct that is the underlying pointer and register the deletion
-        // function.
-        OSVR_ClientContext context = osvrClientInit("com.osvr.renderManager");
-
-        // Wait until we get a connection to a display object, from which we
-        // will
-        // read information that we need about display device resolutions and
-        // distortion correction parameters.  Once we hear from the display
-        // device, we presume that we will also be able to read our
-        // RenderManager parameters.  Complain as we don't hear from the
-        // display device.
-        // @todo Verify that waiting for the display is sufficient to be
-        // sure we'll get the RenderManager string.
-        OSVR_ReturnCode displayReturnCode;
-        OSVR_DisplayConfig display;
-        std::chrono::time_point<std::chrono::system_clock> start, end;
-        start = std::chrono::system_clock::now();
-        do {
-            osvrClientUpdate(context);
-            displayReturnCode = osvrClientGetDisplay(context, &display);
-            end = std::chrono::system_clock::now();
-            std::chrono::duration<double> elapsed = end - start;
-            if (elapsed.count() >= 1) {
-                std::cerr << "RenderManager::createRenderManager(): Waiting to "
-                             "get Display from server..."
-                          << std::endl;
-                start = end;
+        // When we're handed a pose source, it provides everything we'd
+        // otherwise get from the server, so there is no context to make
+        // or server to wait for.
+        OSVR_ClientContext context = nullptr;
+        if (!poseSource) {
+            /// @todo Clone the passed-in context rather than creating our
+            // own, when this function is added to Core.
+            // Construct the context we're going to pass it.
+            // @todo Destroy the context at the appropriate time.  Need to
+            // make sure this happens only once, so we'd like to use a
+            // shared_ptr() on the basic struct that is the underlying
+            // pointer and register the deletion function.
+            context = osvrClientInit("com.osvr.renderManager");
+
+            // Wait until we get a connection to a display object, from which
+            // we will read information that we need about display device
+            // resolutions and distortion correction parameters.  Once we
+            // hear from the display device, we presume that we will also be
+            // able to read our RenderManager parameters.  Complain as we
+            // don't hear from the display device.
+            // @todo Verify that waiting for the display is sufficient to be
+            // sure we'll get the RenderManager string.
+            OSVR_ReturnCode displayReturnCode;
+            OSVR_DisplayConfig display;
+            std::chrono::time_point<std::chrono::system_clock> start, end;
+            start = std::chrono::system_clock::now();
+            do {
+                osvrClientUpdate(context);
+                displayReturnCode = osvrClientGetDisplay(context, &display);
+                end = std::chrono::system_clock::now();
+                std::chrono::duration<double> elapsed = end - start;
+                if (elapsed.count() >= 1) {
+                    std::cerr << "RenderManager::createRenderManager(): "
+                                 "Waiting to get Display from server..."
+                              << std::endl;
+                    start = end;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            } while (displayReturnCode == OSVR_RETURN_FAILURE);
+            std::cerr << "RenderManager::createRenderManager(): Got Display "
+                         "info from server "
+                         "(ignore earlier errors that occured while we were "
+                         "waiting to connect)"
+                      << std::endl;
+        }
+
+        // Read configuration strings from whichever one we're using.
+        auto getString = [&](const std::string& path) -> std::string {
+            if (!poseSource) {
+                return osvrRenderManagerGetString(context, path);
+            }
+            std::string value;
+            if (!poseSource->GetStringParameter(path, value)) {
+                std::string msg =
+                    std::string("Couldn't get PoseSource string for path ") +
+                    path;
+                std::cerr << msg << std::endl;
+                throw std::runtime_error(msg);
             }
-            std::this_thread::sleep_for(std::chrono::milliseconds(200));
-        } while (displayReturnCode == OSVR_RETURN_FAILURE);
-        std::cerr << "RenderManager::createRenderManager(): Got Display info "
-                     "from server "
-                     "(ignore earlier errors that occured while we were "
-                     "waiting to connect)"
-                  << std::endl;
+            return value;
+        };
 
         // Check the information in the pipeline configuration to determine
         // what kind of renderer to instantiate.  Also fill in the parameters
         // to pass to the renderer.
         RenderManager::ConstructorParameters p;
         p.m_graphicsLibrary = graphicsLibrary;
+        p.m_poseSource = poseSource;
 
         osvr::client::RenderManagerConfigPtr pipelineConfig;
+        std::string configString;
         try {
             // @todo
             // this should be a temporary workaround to an issue with
@@ -2491,8 +3969,7 @@ namespace renderkit {
             // C++ cross-dll boundary issue, and making it
             // a header-only lib might fix it, but we're moving the code here
             // for now.
-            std::string configString = osvrRenderManagerGetString(context,
-              "/renderManagerConfig");
+            configString = getString("/renderManagerConfig");
             osvr::client::RenderManagerConfigPtr cfg(
                 new osvr::client::RenderManagerConfig(configString));
             pipelineConfig = cfg;
@@ -2567,10 +4044,85 @@ namespace renderkit {
         p.m_clientPredictionLocalTimeOverride =
           pipelineConfig->getclientPredictionLocalTimeOverride();
 
+        // Read the settings that are specific to this library.
+        Json::Value rmConfig = getRenderManagerConfigJson(configString);
+        const Json::Value& meshCache = rmConfig["distortionMeshCache"];
+        if (meshCache.isObject() && meshCache.get("enabled", false).asBool()) {
+            p.m_distortionMeshCacheDirectory =
+                meshCache.get("directory", "").asString();
+            if (p.m_distortionMeshCacheDirectory.empty()) {
+                p.m_distortionMeshCacheDirectory = defaultCacheDirectory();
+                if (p.m_distortionMeshCacheDirectory.empty()) {
+                    std::cerr << "createRenderManager: No per-user cache "
+                                 "directory for the distortion mesh cache, "
+                                 "disabling it"
+                              << std::endl;
+                }
+            }
+        }
+        std::string distortionMethod =
+            rmConfig.get("distortionMethod", "mesh").asString();
+        if (distortionMethod == "analytic") {
+            p.m_distortionMethod =
+                RenderManager::ConstructorParameters::AnalyticDistortion;
+        } else if (distortionMethod == "lookupTexture") {
+            p.m_distortionMethod =
+                RenderManager::ConstructorParameters::LookupTextureDistortion;
+        } else if (distortionMethod != "mesh") {
+            std::cerr << "createRenderManager: Unrecognized distortionMethod "
+                      << distortionMethod << ", using mesh" << std::endl;
+        }
+        p.m_sleepBeforeVsync = rmConfig.get("sleepBeforeVsync", true).asBool();
+        const Json::Value& rollingShutter = rmConfig["rollingShutterTimeWarp"];
+        if (rollingShutter.isObject()) {
+            p.m_rollingShutterTimeWarp =
+                rollingShutter.get("enabled", false).asBool();
+            p.m_scanOutMS = rollingShutter.get("scanOutMS", 0.0).asFloat();
+        }
+        p.m_timeWarpDepth = rmConfig.get("timeWarpDepth", 2.0).asFloat();
+        if (p.m_timeWarpDepth <= 0) {
+            std::cerr << "createRenderManager: timeWarpDepth must be "
+                         "positive, using 2 meters"
+                      << std::endl;
+            p.m_timeWarpDepth = 2.0f;
+        }
+        const Json::Value& prediction = rmConfig["prediction"];
+        if (prediction.isObject()) {
+            for (const std::string& path : prediction.getMemberNames()) {
+                const Json::Value& entry = prediction[path];
+                RenderManager::ConstructorParameters::PredictionModel model;
+                std::string name =
+                    entry.get("model", "constantVelocity").asString();
+                if (name == "constantAcceleration") {
+                    model.m_model = RenderManager::ConstructorParameters::
+                        ConstantAccelerationPrediction;
+                } else if (name == "alphaBeta") {
+                    model.m_model = RenderManager::ConstructorParameters::
+                        AlphaBetaPrediction;
+                    model.m_alpha =
+                        entry.get("alpha", model.m_alpha).asDouble();
+                    model.m_beta = entry.get("beta", model.m_beta).asDouble();
+                } else if (name != "constantVelocity") {
+                    std::cerr << "createRenderManager: Unrecognized prediction "
+                                 "model "
+                              << name << " for " << path
+                              << ", using constantVelocity" << std::endl;
+                }
+                p.m_predictionModels[path] = model;
+            }
+        }
+        const Json::Value& lookup = rmConfig["distortionLookupTexture"];
+        if (lookup.isObject()) {
+            int resolution = lookup.get("resolution", 512).asInt();
+            if (resolution > 0) {
+                p.m_distortionLookupResolution =
+                    static_cast<size_t>(resolution);
+            }
+        }
+
         std::string jsonString;
         try {
-            std::string jsonString =
-                osvrRenderManagerGetString(context, "/display");
+            std::string jsonString = getString("/display");
             OSVRDisplayConfiguration displayConfig(jsonString);
             p.m_displayConfiguration = displayConfig;
         } catch (std::exception& /*e*/) {
@@ -2753,6 +4305,15 @@ namespace renderkit {
 
 #endif
 
+        // Apply any adaptive-mesh error tolerance to all of the eyes.
+        const Json::Value& meshConfig = rmConfig["distortionMesh"];
+        if (meshConfig.isObject()) {
+            float tolerance = meshConfig.get("tolerancePixels", 0).asFloat();
+            for (size_t i = 0; i < p.m_distortionParameters.size(); i++) {
+                p.m_distortionParameters[i].m_meshTolerancePixels = tolerance;
+            }
+        }
+
         // @todo Read the info we need from Core.
 
         // If DirectMode is turned off and we've got a valid vendor ID, then we
@@ -2896,6 +4457,15 @@ namespace renderkit {
                 return nullptr;
 #endif
             }
+        } else if (p.m_renderLibrary == "Software") {
+#ifdef RM_USE_SOFTWARE
+            ret.reset(new RenderManagerSoftware(context, p));
+#else
+            std::cerr << "createRenderManager: Software render library not "
+                         "compiled in"
+                      << std::endl;
+            return nullptr;
+#endif
         } else {
             std::cerr << "createRenderManager: Unrecognized render library: "
                       << p.m_renderLibrary << std::endl;
@@ -70,7 +70,7 @@ namespace renderkit {
         bool PresentFrameFinalize() override;
 
         friend RenderManager OSVR_RENDERMANAGER_EXPORT*
-        createRenderManager(OSVR_ClientContext context,
+        createRenderManager(std::shared_ptr<PoseSource> poseSource,
                             const std::string& renderLibraryName,
                             GraphicsLibrary graphicsLibrary);
     };
@@ -27,6 +27,7 @@ Sensics, Inc.
 #include <osvr/ClientKit/Interface.h>
 #include "RenderManagerD3DBase.h"
 #include "RenderManagerOpenGL.h"
+#include "RenderManagerTrace.h"
 #include "GraphicsLibraryD3D11.h"
 
 #include <vector>
@@ -294,10 +295,18 @@ namespace osvr {
                     if (timeToPresent) {
                         std::lock_guard<std::mutex> lock(mLock);
                         if (mFirstFramePresented) {
+                            // Only trace iterations that present; the rest
+                            // are the spin waiting for vsync.
+                            RM_TRACE_SCOPE("ATWThreadPresent");
+
                             // Update the context so we get our callbacks called and
                             // update tracker state, which will be read during the
                             // time-warp calculation in our harnessed RenderManager.
-                            osvrClientUpdate(mRenderManager->m_context);
+                            {
+                                std::lock_guard<std::mutex> stateLock(
+                                    mRenderManager->m_renderInfoMutex);
+                                mRenderManager->UpdateTrackingState();
+                            }
 
                             {
                                 // make a new RenderBuffers array with the atw thread's buffers
@@ -364,15 +373,19 @@ namespace osvr {
                 bool appWillNotOverwriteBeforeNewPresent = false) override {
 
                 // If they are promising to not present the same buffers
-                // each frame, make sure they have registered twice as
-                // many as there are viewports for them to render.
+                // each frame, make sure they have registered at least twice
+                // as many as there are viewports for them to render (more
+                // when they keep several frames in flight with BeginFrame()).
                 if (appWillNotOverwriteBeforeNewPresent) {
-                  if (buffers.size() != LatchRenderInfo() * 2) {
+                  size_t viewports = LatchRenderInfo();
+                  if ((viewports == 0) || (buffers.size() < viewports * 2) ||
+                      (buffers.size() % viewports != 0)) {
                     std::cerr << "RenderManagerD3D11ATW::"
                       << "RegisterRenderBuffersInternal: Promised"
                       << " not to re-use buffers, but number registered ("
-                      << buffers.size() << " != twice number of viewports ("
-                      << LatchRenderInfo() << std::endl;
+                      << buffers.size() << ") is not a multiple of at least"
+                      << " twice the number of viewports (" << viewports
+                      << ")" << std::endl;
                     return false;
                   }
                 }
@@ -443,7 +456,10 @@ namespace osvr {
 
                   // OK, now we need to open the shared resource on the ATW thread's ID3D11Device.
                     {
-                      auto atwDevice = renderInfo[i].library.D3D11->device;
+                      // There may be several buffers per viewport, all on
+                      // the same device.
+                      auto atwDevice = renderInfo[i % renderInfo.size()]
+                                           .library.D3D11->device;
                       ID3D11Texture2D *texture2D = nullptr;
                       hr = atwDevice->OpenSharedResource(newInfo.sharedResourceHandle, __uuidof(ID3D11Texture2D),
                         (LPVOID*)&texture2D);
@@ -513,7 +529,7 @@ namespace osvr {
             }
 
             friend RenderManager OSVR_RENDERMANAGER_EXPORT*
-                createRenderManager(OSVR_ClientContext context,
+                createRenderManager(std::shared_ptr<PoseSource> poseSource,
                 const std::string& renderLibraryName,
                 GraphicsLibrary graphicsLibrary);
         };
@@ -40,6 +40,7 @@ static const char* distortionVertexShader =
     "  matrix projectionMatrix;"
     "  matrix modelViewMatrix;"
     "  matrix textureMatrix;"
+    "  matrix textureMatrixEnd;"
     "}"
     ""
     "struct VS_Input"
@@ -64,10 +65,20 @@ static const char* distortionVertexShader =
     "  VS_Output ret;"
     "  matrix wvp = mul(projectionMatrix, modelViewMatrix);"
     "  ret.position = mul(wvp, input.position);"
-    "  /* Adjust the texture coordinates using the texture matrix */"
-    "  ret.texR = mul(float4(input.texR, 0.0f, 1.0f), textureMatrix);"
-    "  ret.texG = mul(float4(input.texG, 0.0f, 1.0f), textureMatrix);"
-    "  ret.texB = mul(float4(input.texB, 0.0f, 1.0f), textureMatrix);"
+    "  /* Adjust the texture coordinates using the texture matrix, blended"
+    "     with the one for the bottom line of the eye by how far down the"
+    "     eye this vertex is scanned out (they are the same matrix unless"
+    "     we are correcting for a rolling shutter). */"
+    "  float scan = saturate(0.5f - 0.5f * ret.position.y / ret.position.w);"
+    "  float4 texR = float4(input.texR, 0.0f, 1.0f);"
+    "  float4 texG = float4(input.texG, 0.0f, 1.0f);"
+    "  float4 texB = float4(input.texB, 0.0f, 1.0f);"
+    "  ret.texR = lerp(mul(texR, textureMatrix),"
+    "                  mul(texR, textureMatrixEnd), scan).xy;"
+    "  ret.texG = lerp(mul(texG, textureMatrix),"
+    "                  mul(texG, textureMatrixEnd), scan).xy;"
+    "  ret.texB = lerp(mul(texB, textureMatrix),"
+    "                  mul(texB, textureMatrixEnd), scan).xy;"
     "  return ret;"
     "}";
 
@@ -1109,8 +1120,19 @@ namespace renderkit {
         Eigen::Map<Eigen::Matrix4f> textureEi(textureMat);
         textureEi = textureEi * Eigen::Matrix4f::Map(crop.data).transpose();
 
+        // The matrix for the bottom line of the eye is the same unless we
+        // are correcting for a rolling shutter.
+        float textureEndMat[16];
+        memcpy(textureEndMat, textureMat, 16 * sizeof(float));
+        if (params.m_ATWEnd != nullptr) {
+            Eigen::Map<Eigen::Matrix4f> textureEndEi(textureEndMat);
+            textureEndEi = Eigen::Matrix4f::Map(params.m_ATWEnd->data) *
+                           Eigen::Matrix4f::Map(crop.data).transpose();
+        }
+
         DirectX::XMMATRIX texture(textureMat);
-        cbPerObject wvp = {projection, modelView, texture};
+        DirectX::XMMATRIX textureEnd(textureEndMat);
+        cbPerObject wvp = {projection, modelView, texture, textureEnd};
         m_D3D11Context->UpdateSubresource(m_cbPerObjectBuffer.Get(), 0, nullptr,
                                           &wvp, 0, 0);
         m_D3D11Context->VSSetConstantBuffers(
@@ -158,6 +158,7 @@ namespace renderkit {
             DirectX::XMMATRIX projection;
             DirectX::XMMATRIX modelView;
             DirectX::XMMATRIX texture;
+            DirectX::XMMATRIX textureEnd; //< Texture matrix for bottom line
         };
 
         /// We can't use an OpenGL-compliant texture warp matrix, so need to
@@ -509,6 +509,16 @@ namespace renderkit {
             }
             sendParams.m_ATW = &textureMat;
         }
+        matrix16 textureEndMat;
+        if (params.m_ATWEnd != nullptr) {
+            for (size_t r = 0; r < 4; r++) {
+                for (size_t c = 0; c < 4; c++) {
+                    textureEndMat.data[r * 4 + c] =
+                        params.m_ATWEnd->data[c * 4 + r];
+                }
+            }
+            sendParams.m_ATWEnd = &textureEndMat;
+        }
 
         // Unlock the render target to enable Direct3D access
         if (!wglDXUnlockObjectsNV(m_glD3DHandle, 1, &oglMap->glColorHandle)) {
@@ -125,7 +125,7 @@ namespace renderkit {
         bool PresentEye(PresentEyeParameters params) override;
 
         friend RenderManager OSVR_RENDERMANAGER_EXPORT*
-        createRenderManager(OSVR_ClientContext context,
+        createRenderManager(std::shared_ptr<PoseSource> poseSource,
                             const std::string& renderLibraryName,
                             GraphicsLibrary graphicsLibrary);
     };
@@ -34,14 +34,22 @@ Sensics, Inc.
   #endif
 #endif
 #include "RenderManagerOpenGL.h"
+#include "RenderManagerTrace.h"
 #include "GraphicsLibraryOpenGL.h"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <Eigen/Core>
 #include <Eigen/Geometry>
 
 //==========================================================================
 // Vertex and fragment shaders to perform our combination of asynchronous
-// time warp and distortion correction.
+// time warp and distortion correction.  The time warp blends between the
+// texture matrices for the top and bottom lines of the eye by how far down
+// the eye each vertex is scanned out; they are the same matrix unless we
+// are correcting for a rolling shutter.  When the time warp has depth to go
+// by, each vertex is then moved by the parallax for the depth where its
+// green coordinate lands, converted from window depth into 1/meters.
 static const GLchar* distortionVertexShader =
     "#version 330 core\n"
     "layout(location = 0) in vec4 position;\n"
@@ -54,15 +62,35 @@ static const GLchar* distortionVertexShader =
     "uniform mat4 projectionMatrix;\n"
     "uniform mat4 modelViewMatrix;\n"
     "uniform mat4 textureMatrix;\n"
+    "uniform mat4 textureMatrixEnd;\n"
+    "uniform bool useDepth;\n"
+    "uniform sampler2D depthTex;\n"
+    "uniform vec2 depthParallax;\n"
+    "uniform vec3 depthPlanes;\n" // near, far, 1/assumed depth
+    "vec2 warp(vec2 coord, float scan)\n"
+    "{\n"
+    "   vec4 c = vec4(coord, 0, 1);\n"
+    "   return vec2(mix(textureMatrix * c, textureMatrixEnd * c, scan));\n"
+    "}\n"
     "void main()\n"
     "{\n"
     "   gl_Position = projectionMatrix * modelViewMatrix * position;\n"
-    "   warpedCoordinateR = vec2(textureMatrix * "
-    "      vec4(textureCoordinateR,0,1));\n"
-    "   warpedCoordinateG = vec2(textureMatrix * "
-    "      vec4(textureCoordinateG,0,1));\n"
-    "   warpedCoordinateB = vec2(textureMatrix * "
-    "      vec4(textureCoordinateB,0,1));\n"
+    "   float scan = clamp(0.5 - 0.5 * gl_Position.y / gl_Position.w, "
+    "      0.0, 1.0);\n"
+    "   warpedCoordinateR = warp(textureCoordinateR, scan);\n"
+    "   warpedCoordinateG = warp(textureCoordinateG, scan);\n"
+    "   warpedCoordinateB = warp(textureCoordinateB, scan);\n"
+    "   if (useDepth) {\n"
+    "      float n = depthPlanes.x;\n"
+    "      float f = depthPlanes.y;\n"
+    "      float z = 2.0 * textureLod(depthTex, warpedCoordinateG, 0.0).r"
+    "         - 1.0;\n"
+    "      float inverseDepth = (f + n - z * (f - n)) / (2.0 * n * f);\n"
+    "      vec2 shift = (inverseDepth - depthPlanes.z) * depthParallax;\n"
+    "      warpedCoordinateR += shift;\n"
+    "      warpedCoordinateG += shift;\n"
+    "      warpedCoordinateB += shift;\n"
+    "   }\n"
     "}\n";
 
 static const GLchar* distortionFragmentShader =
@@ -79,6 +107,103 @@ static const GLchar* distortionFragmentShader =
     "    color.b = texture(tex, warpedCoordinateB).b;\n"
     "}\n";
 
+//==========================================================================
+// Vertex shader for the distortion methods that draw a single quad covering
+// the eye and compute the distorted texture coordinates for each pixel.
+// scanFraction tells how far down the eye each pixel is scanned out.
+static const GLchar* quadDistortionVertexShader =
+    "#version 330 core\n"
+    "layout(location = 0) in vec4 position;\n"
+    "layout(location = 1) in vec2 textureCoordinate;\n"
+    "out vec2 inputCoordinate;\n"
+    "out float scanFraction;\n"
+    "uniform mat4 projectionMatrix;\n"
+    "uniform mat4 modelViewMatrix;\n"
+    "void main()\n"
+    "{\n"
+    "   gl_Position = projectionMatrix * modelViewMatrix * position;\n"
+    "   inputCoordinate = textureCoordinate;\n"
+    "   scanFraction = 0.5 - 0.5 * gl_Position.y / gl_Position.w;\n"
+    "}\n";
+
+// Fragment shader for the analytic distortion method, following
+// RenderManager::DistortionCorrectTextureCoordinate() for
+// rgb_symmetric_polynomials distortion.  The coefficient array holds up to
+// 8 coefficients for each of red, green, and blue, in that order.
+static const GLchar* analyticDistortionFragmentShader =
+    "#version 330 core\n"
+    "uniform sampler2D tex;\n"
+    "uniform mat4 textureMatrix;\n"
+    "uniform mat4 textureMatrixEnd;\n"
+    "uniform float overfillFactor;\n"
+    "uniform vec2 distortionCOP;\n"
+    "uniform vec2 distortionD;\n"
+    "uniform float coefficients[24];\n"
+    "uniform ivec3 numCoefficients;\n"
+    "in vec2 inputCoordinate;\n"
+    "in float scanFraction;\n"
+    "out vec3 color;\n"
+    "vec2 distort(int clr)\n"
+    "{\n"
+    "    vec2 xyN = (inputCoordinate - 0.5) * overfillFactor + 0.5;\n"
+    "    vec2 xyDDiff = xyN * distortionD - distortionCOP;\n"
+    "    float rMag2 = dot(xyDDiff, xyDDiff);\n"
+    "    if (rMag2 == 0.0) {\n"
+    "        return inputCoordinate;\n"
+    "    }\n"
+    "    float rMag = sqrt(rMag2);\n"
+    "    vec2 xyDNorm = xyDDiff / rMag;\n"
+    "    float rFactor = 1.0;\n"
+    "    float rNew = coefficients[clr * 8];\n"
+    "    for (int i = 1; i < numCoefficients[clr]; i++) {\n"
+    "        rFactor *= rMag;\n"
+    "        rNew += coefficients[clr * 8 + i] * rFactor;\n"
+    "    }\n"
+    "    vec2 xyNNew = (distortionCOP + rNew * xyDNorm) / distortionD;\n"
+    "    return (xyNNew - 0.5) / overfillFactor + 0.5;\n"
+    "}\n"
+    "vec2 warp(vec2 coord)\n"
+    "{\n"
+    "    vec4 c = vec4(coord, 0, 1);\n"
+    "    return vec2(mix(textureMatrix * c, textureMatrixEnd * c,\n"
+    "                    clamp(scanFraction, 0.0, 1.0)));\n"
+    "}\n"
+    "void main()\n"
+    "{\n"
+    "    color.r = texture(tex, warp(distort(0))).r;\n"
+    "    color.g = texture(tex, warp(distort(1))).g;\n"
+    "    color.b = texture(tex, warp(distort(2))).b;\n"
+    "}\n";
+
+// Fragment shader for the lookup-texture distortion method, which reads
+// the distorted texture coordinates for each color from a lookup texture.
+static const GLchar* lookupDistortionFragmentShader =
+    "#version 330 core\n"
+    "uniform sampler2D tex;\n"
+    "uniform sampler2D lookupR;\n"
+    "uniform sampler2D lookupG;\n"
+    "uniform sampler2D lookupB;\n"
+    "uniform mat4 textureMatrix;\n"
+    "uniform mat4 textureMatrixEnd;\n"
+    "in vec2 inputCoordinate;\n"
+    "in float scanFraction;\n"
+    "out vec3 color;\n"
+    "vec2 warp(vec2 coord)\n"
+    "{\n"
+    "    vec4 c = vec4(coord, 0, 1);\n"
+    "    return vec2(mix(textureMatrix * c, textureMatrixEnd * c,\n"
+    "                    clamp(scanFraction, 0.0, 1.0)));\n"
+    "}\n"
+    "void main()\n"
+    "{\n"
+    "    vec2 r = texture(lookupR, inputCoordinate).rg;\n"
+    "    vec2 g = texture(lookupG, inputCoordinate).rg;\n"
+    "    vec2 b = texture(lookupB, inputCoordinate).rg;\n"
+    "    color.r = texture(tex, warp(r)).r;\n"
+    "    color.g = texture(tex, warp(g)).g;\n"
+    "    color.b = texture(tex, warp(b)).b;\n"
+    "}\n";
+
 static bool checkShaderError(GLuint shaderId) {
     GLint result = GL_FALSE;
     glGetShaderiv(shaderId, GL_COMPILE_STATUS, &result);
@@ -123,6 +248,36 @@ static bool checkProgramError(GLuint programId) {
     return true;
 }
 
+/// Compile and link a program from a vertex and a fragment shader.
+/// Returns 0 on failure.
+static GLuint buildProgram(const GLchar* vertexShader,
+                           const GLchar* fragmentShader) {
+    GLuint vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertexShaderId, 1, &vertexShader, nullptr);
+    glCompileShader(vertexShaderId);
+    GLuint fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragmentShaderId, 1, &fragmentShader, nullptr);
+    glCompileShader(fragmentShaderId);
+    if (!checkShaderError(vertexShaderId) ||
+        !checkShaderError(fragmentShaderId)) {
+        glDeleteShader(vertexShaderId);
+        glDeleteShader(fragmentShaderId);
+        return 0;
+    }
+
+    GLuint programId = glCreateProgram();
+    glAttachShader(programId, vertexShaderId);
+    glAttachShader(programId, fragmentShaderId);
+    glLinkProgram(programId);
+    glDeleteShader(vertexShaderId);
+    glDeleteShader(fragmentShaderId);
+    if (!checkProgramError(programId)) {
+        glDeleteProgram(programId);
+        return 0;
+    }
+    return programId;
+}
+
 namespace osvr {
 namespace renderkit {
 
@@ -164,10 +319,8 @@ namespace renderkit {
                 glDeleteTextures(1, &m_colorBuffers[i].OpenGL->colorBufferName);
                 delete m_colorBuffers[i].OpenGL;
                 glDeleteRenderbuffers(1, &m_depthBuffers[i]);
-                glDeleteVertexArrays(1, &m_distortVAO[i]);
-                glDeleteBuffers(1, &m_distortBuffer[i]);
-                delete[] m_triangleBuffer[i];
             }
+            deleteDistortionMeshes();
 
             /// @todo Clean up anything else we need to
 
@@ -229,6 +382,52 @@ namespace renderkit {
         return RegisterRenderBuffersInternal(m_colorBuffers);
     }
 
+    /// Is the named object a 2D texture with a depth format?  Checked
+    /// before it is sampled for time warp, because applications usually
+    /// make their depth buffers with glGenRenderbuffers().
+    static bool isDepthTexture(GLuint name) {
+#ifdef RM_USE_OPENGLES20
+        // Depth textures are not part of OpenGL ES 2.0.
+        return false;
+#else
+        if (!glIsTexture(name)) {
+            return false;
+        }
+        GLint previous = 0;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+        glBindTexture(GL_TEXTURE_2D, name);
+        GLint depthBits = 0;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_DEPTH_SIZE,
+                                 &depthBits);
+        // Binding a texture that was made for another target fails.
+        bool ok = (glGetError() == GL_NO_ERROR) && (depthBits > 0);
+        glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(previous));
+        return ok;
+#endif
+    }
+
+    bool RenderManagerOpenGL::RegisterRenderBuffersInternal(
+        const std::vector<RenderBuffer>& buffers,
+        bool appWillNotOverwriteBeforeNewPresent) {
+        for (size_t i = 0; i < buffers.size(); i++) {
+            if (buffers[i].OpenGL == nullptr) {
+                continue;
+            }
+            GLuint depth = buffers[i].OpenGL->depthStencilBufferName;
+            if (depth == 0) {
+                continue;
+            }
+            if (isDepthTexture(depth)) {
+                m_timeWarpDepthTextures.insert(depth);
+                m_timeWarpDepthRejected.erase(depth);
+            } else {
+                m_timeWarpDepthTextures.erase(depth);
+            }
+        }
+        return RenderManager::RegisterRenderBuffersInternal(
+            buffers, appWillNotOverwriteBeforeNewPresent);
+    }
+
     bool RenderManagerOpenGL::addOpenGLContext(GLContextParams p) {
         // Initialize the SDL video subsystem.
         if (!m_sdl_initialized) {
@@ -322,6 +521,9 @@ namespace renderkit {
             glDeleteProgram(m_programId);
             m_programId = 0;
         }
+        deleteAnalyticDistortion();
+        deleteLookupDistortion();
+        deleteDistortionQuad();
         if (m_GLContext) {
             SDL_GL_DeleteContext(m_GLContext);
             m_GLContext = 0;
@@ -493,11 +695,58 @@ namespace renderkit {
         m_modelViewUniformId =
             glGetUniformLocation(m_programId, "modelViewMatrix");
         m_textureUniformId = glGetUniformLocation(m_programId, "textureMatrix");
+        m_textureEndUniformId =
+            glGetUniformLocation(m_programId, "textureMatrixEnd");
+        m_useDepthUniformId = glGetUniformLocation(m_programId, "useDepth");
+        m_depthParallaxUniformId =
+            glGetUniformLocation(m_programId, "depthParallax");
+        m_depthPlanesUniformId =
+            glGetUniformLocation(m_programId, "depthPlanes");
+
+        // The depth sampler never changes texture units, so set it once.
+        {
+            GLint userProgram;
+            glGetIntegerv(GL_CURRENT_PROGRAM, &userProgram);
+            glUseProgram(m_programId);
+            glUniform1i(glGetUniformLocation(m_programId, "depthTex"),
+                        DEPTH_TEXTURE_UNIT);
+            glUseProgram(userProgram);
+        }
 
         // Now that they are linked, we don't need to keep them around.
         glDeleteShader(vertexShaderId);
         glDeleteShader(fragmentShaderId);
 
+        // Set up the analytic or lookup-texture distortion shader if it was
+        // asked for.  If it can't be built, the mesh is used instead.
+        if (m_params.m_distortionMethod ==
+                ConstructorParameters::AnalyticDistortion &&
+            !constructAnalyticDistortion()) {
+            std::cerr << "RenderManagerOpenGL::OpenDisplay: Could not "
+                         "construct analytic distortion shader, using a mesh "
+                         "instead"
+                      << std::endl;
+        }
+#ifdef RM_USE_OPENGLES20
+        // OpenGL ES 2.0 has no RG32F textures to hold the lookup tables.
+        if (m_params.m_distortionMethod ==
+            ConstructorParameters::LookupTextureDistortion) {
+            std::cerr << "RenderManagerOpenGL::OpenDisplay: Lookup-texture "
+                         "distortion is not available with OpenGL ES 2.0, "
+                         "using a mesh instead"
+                      << std::endl;
+        }
+#else
+        if (m_params.m_distortionMethod ==
+                ConstructorParameters::LookupTextureDistortion &&
+            !constructLookupDistortion()) {
+            std::cerr << "RenderManagerOpenGL::OpenDisplay: Could not "
+                         "construct lookup-texture distortion shader, using "
+                         "a mesh instead"
+                      << std::endl;
+        }
+#endif
+
         if (!UpdateDistortionMeshesInternal(SQUARE,
                                             m_params.m_distortionParameters)) {
             removeOpenGLContexts();
@@ -597,14 +846,12 @@ namespace renderkit {
         return true;
     }
 
-    bool RenderManagerOpenGL::UpdateDistortionMeshesInternal(
-        DistortionMeshType type //< Type of mesh to produce
-        ,
-        std::vector<DistortionParameters> const&
-            distort //< Distortion parameters
-        ) {
-        // Clear the triangle and quad buffers if we have created them before.
+    void RenderManagerOpenGL::deleteDistortionMeshes() {
         m_numTriangles.clear();
+        m_numVertices.clear();
+        for (size_t i = 0; i < m_triangleBuffer.size(); i++) {
+            delete[] m_triangleBuffer[i];
+        }
         m_triangleBuffer.clear();
         for (size_t i = 0; i < m_distortVAO.size(); i++) {
             glDeleteVertexArrays(1, &m_distortVAO[i]);
@@ -614,14 +861,239 @@ namespace renderkit {
             glDeleteBuffers(1, &m_distortBuffer[i]);
         }
         m_distortBuffer.clear();
+        for (size_t i = 0; i < m_distortIndexBuffer.size(); i++) {
+            glDeleteBuffers(1, &m_distortIndexBuffer[i]);
+        }
+        m_distortIndexBuffer.clear();
+        m_distortIndexType.clear();
+    }
+
+    bool RenderManagerOpenGL::canUseAnalyticDistortion(
+        DistortionParameters const& d) {
+        if (d.m_type != DistortionParameters::rgb_symmetric_polynomials) {
+            return false;
+        }
+        const std::vector<float>* polynomials[3] = {
+            &d.m_distortionPolynomialRed, &d.m_distortionPolynomialGreen,
+            &d.m_distortionPolynomialBlue};
+        for (size_t clr = 0; clr < 3; clr++) {
+            if (polynomials[clr]->size() < 2 ||
+                polynomials[clr]->size() > ANALYTIC_MAX_COEFFICIENTS) {
+                return false;
+            }
+        }
+        return d.m_distortionCOP.size() == 2 && d.m_distortionD.size() == 2 &&
+               d.m_distortionD[0] > 0 && d.m_distortionD[1] > 0;
+    }
+
+    bool RenderManagerOpenGL::constructDistortionQuad() {
+        if (m_distortionQuadVAO != 0) {
+            return true;
+        }
+
+        // A quad covering the eye, drawn as a triangle strip: positions
+        // first, then the undistorted texture coordinates.  The attribute
+        // pointers are stored in the VAO.
+        static const GLfloat quad[] = {
+            -1, -1, 0, 1, 1, -1, 0, 1, -1, 1, 0, 1, 1, 1, 0, 1, // Positions
+            0,  0,  1, 0, 0, 1,  1, 1 // Texture coordinates
+        };
+        char* base = nullptr;
+        glGenVertexArrays(1, &m_distortionQuadVAO);
+        glBindVertexArray(m_distortionQuadVAO);
+        glGenBuffers(1, &m_distortionQuadBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, m_distortionQuadBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, base);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0,
+                              base + 16 * sizeof(GLfloat));
+        glEnableVertexAttribArray(1);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        if (checkForGLError("RenderManagerOpenGL::constructDistortionQuad")) {
+            deleteDistortionQuad();
+            return false;
+        }
+        return true;
+    }
+
+    void RenderManagerOpenGL::deleteDistortionQuad() {
+        if (m_distortionQuadVAO != 0) {
+            glDeleteVertexArrays(1, &m_distortionQuadVAO);
+            m_distortionQuadVAO = 0;
+        }
+        if (m_distortionQuadBuffer != 0) {
+            glDeleteBuffers(1, &m_distortionQuadBuffer);
+            m_distortionQuadBuffer = 0;
+        }
+    }
+
+    bool RenderManagerOpenGL::constructAnalyticDistortion() {
+        deleteAnalyticDistortion();
+
+        m_analyticProgramId = buildProgram(quadDistortionVertexShader,
+                                           analyticDistortionFragmentShader);
+        if (m_analyticProgramId == 0) {
+            return false;
+        }
+
+        m_analyticProjectionUniformId =
+            glGetUniformLocation(m_analyticProgramId, "projectionMatrix");
+        m_analyticModelViewUniformId =
+            glGetUniformLocation(m_analyticProgramId, "modelViewMatrix");
+        m_analyticTextureUniformId =
+            glGetUniformLocation(m_analyticProgramId, "textureMatrix");
+        m_analyticTextureEndUniformId =
+            glGetUniformLocation(m_analyticProgramId, "textureMatrixEnd");
+        m_analyticOverfillUniformId =
+            glGetUniformLocation(m_analyticProgramId, "overfillFactor");
+        m_analyticCOPUniformId =
+            glGetUniformLocation(m_analyticProgramId, "distortionCOP");
+        m_analyticDUniformId =
+            glGetUniformLocation(m_analyticProgramId, "distortionD");
+        m_analyticCoefficientsUniformId =
+            glGetUniformLocation(m_analyticProgramId, "coefficients");
+        m_analyticNumCoefficientsUniformId =
+            glGetUniformLocation(m_analyticProgramId, "numCoefficients");
+
+        if (!constructDistortionQuad() ||
+            checkForGLError(
+                "RenderManagerOpenGL::constructAnalyticDistortion")) {
+            deleteAnalyticDistortion();
+            return false;
+        }
+        return true;
+    }
+
+    void RenderManagerOpenGL::deleteAnalyticDistortion() {
+        if (m_analyticProgramId != 0) {
+            glDeleteProgram(m_analyticProgramId);
+            m_analyticProgramId = 0;
+        }
+        m_analyticDistortion = false;
+    }
+
+    bool RenderManagerOpenGL::canUseLookupDistortion(
+        DistortionParameters const& d) {
+        return d.m_type == DistortionParameters::mono_point_samples ||
+               d.m_type == DistortionParameters::rgb_point_samples;
+    }
+
+    bool RenderManagerOpenGL::constructLookupDistortion() {
+        deleteLookupDistortion();
+
+        m_lookupProgramId = buildProgram(quadDistortionVertexShader,
+                                         lookupDistortionFragmentShader);
+        if (m_lookupProgramId == 0) {
+            return false;
+        }
+
+        m_lookupProjectionUniformId =
+            glGetUniformLocation(m_lookupProgramId, "projectionMatrix");
+        m_lookupModelViewUniformId =
+            glGetUniformLocation(m_lookupProgramId, "modelViewMatrix");
+        m_lookupTextureUniformId =
+            glGetUniformLocation(m_lookupProgramId, "textureMatrix");
+        m_lookupTextureEndUniformId =
+            glGetUniformLocation(m_lookupProgramId, "textureMatrixEnd");
+
+        // The samplers never change texture units, so set them once.
+        GLint userProgram;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &userProgram);
+        glUseProgram(m_lookupProgramId);
+        glUniform1i(glGetUniformLocation(m_lookupProgramId, "tex"), 0);
+        const char* samplers[3] = {"lookupR", "lookupG", "lookupB"};
+        for (GLuint clr = 0; clr < 3; clr++) {
+            glUniform1i(glGetUniformLocation(m_lookupProgramId, samplers[clr]),
+                        LOOKUP_FIRST_TEXTURE_UNIT + clr);
+        }
+        glUseProgram(userProgram);
+
+        if (!constructDistortionQuad() ||
+            checkForGLError("RenderManagerOpenGL::constructLookupDistortion")) {
+            deleteLookupDistortion();
+            return false;
+        }
+        return true;
+    }
+
+    void RenderManagerOpenGL::deleteLookupDistortion() {
+        deleteLookupTextures();
+        if (m_lookupProgramId != 0) {
+            glDeleteProgram(m_lookupProgramId);
+            m_lookupProgramId = 0;
+        }
+    }
+
+    void RenderManagerOpenGL::deleteLookupTextures() {
+        // The bake works on its own copy of the parameters, so all we can
+        // do is wait for it and throw the result away.
+        if (m_lookupBake.valid()) {
+            m_lookupBake.wait();
+            m_lookupBake = std::future<DistortionLookupTables>();
+        }
+        if (!m_lookupTextures.empty()) {
+            glDeleteTextures(static_cast<GLsizei>(m_lookupTextures.size()),
+                             m_lookupTextures.data());
+            m_lookupTextures.clear();
+        }
+        m_lookupDistortion = false;
+    }
+
+    void RenderManagerOpenGL::updateLookupTextures() {
+#ifndef RM_USE_OPENGLES20
+        if (!m_lookupBake.valid() ||
+            m_lookupBake.wait_for(std::chrono::seconds(0)) !=
+                std::future_status::ready) {
+            return;
+        }
+        DistortionLookupTables tables = m_lookupBake.get();
+        if (tables.empty()) {
+            std::cerr << "RenderManagerOpenGL::updateLookupTextures: Could "
+                         "not bake distortion lookup textures, using a mesh"
+                      << std::endl;
+            return;
+        }
+
+        GLint resolution = static_cast<GLint>(
+            m_params.m_distortionLookupResolution);
+        glActiveTexture(GL_TEXTURE0);
+        m_lookupTextures.resize(tables.size());
+        glGenTextures(static_cast<GLsizei>(m_lookupTextures.size()),
+                      m_lookupTextures.data());
+        for (size_t i = 0; i < tables.size(); i++) {
+            glBindTexture(GL_TEXTURE_2D, m_lookupTextures[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, resolution, resolution,
+                         0, GL_RG, GL_FLOAT, tables[i].data());
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,
+                            GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,
+                            GL_CLAMP_TO_EDGE);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        if (checkForGLError("RenderManagerOpenGL::updateLookupTextures")) {
+            glDeleteTextures(static_cast<GLsizei>(m_lookupTextures.size()),
+                             m_lookupTextures.data());
+            m_lookupTextures.clear();
+            return;
+        }
+        m_lookupDistortion = true;
+#endif
+    }
+
+    bool RenderManagerOpenGL::UpdateDistortionMeshesInternal(
+        DistortionMeshType type //< Type of mesh to produce
+        ,
+        std::vector<DistortionParameters> const&
+            distort //< Distortion parameters
+        ) {
+        // Clear the triangle and quad buffers if we have created them before.
+        deleteDistortionMeshes();
 
-        // Construct the data buffer that will hold the vertices and texture
-        // coordinates
-        // for R,G,B distortion mapping.  Fill it in with the vertices in the
-        // first
-        // block, the red texture coordinates in the next, then the green and
-        // then
-        // the blue.
         size_t numEyes = GetNumEyes();
         if (numEyes > distort.size()) {
             std::cerr << "RenderManagerOpenGL::UpdateDistortionMesh: Not "
@@ -630,14 +1102,88 @@ namespace renderkit {
             removeOpenGLContexts();
             return false;
         }
+
+        // If we're set up to apply the distortion analytically and the
+        // shader can handle the parameters for every eye, all we need to
+        // do is remember them.
+        m_analyticDistortion = false;
+        if (m_analyticProgramId != 0) {
+            bool analytic = true;
+            for (size_t eye = 0; eye < numEyes; eye++) {
+                analytic = analytic && canUseAnalyticDistortion(distort[eye]);
+            }
+            if (analytic) {
+                m_analyticParameters.assign(distort.begin(),
+                                            distort.begin() + numEyes);
+                m_analyticDistortion = true;
+                return true;
+            }
+            std::cerr << "RenderManagerOpenGL::UpdateDistortionMesh: "
+                         "Distortion parameters can't be applied "
+                         "analytically, using a mesh instead"
+                      << std::endl;
+        }
+
+        // If we're set up to use lookup textures, bake them in the
+        // background from a copy of the parameters.  The mesh built below
+        // is drawn until they are ready.
+        deleteLookupTextures();
+        if (m_lookupProgramId != 0) {
+            bool lookup = true;
+            for (size_t eye = 0; eye < numEyes; eye++) {
+                lookup = lookup && canUseLookupDistortion(distort[eye]);
+            }
+            if (lookup) {
+                std::vector<DistortionParameters> params(
+                    distort.begin(), distort.begin() + numEyes);
+                float overfill = m_params.m_renderOverfillFactor;
+                size_t resolution = m_params.m_distortionLookupResolution;
+                m_lookupBake = std::async(std::launch::async, [=]() {
+                    DistortionLookupTables tables(params.size() * 3);
+                    for (size_t eye = 0; eye < params.size(); eye++) {
+                        for (size_t clr = 0; clr < 3; clr++) {
+                            std::vector<float>& table = tables[eye * 3 + clr];
+                            // Mono samples give the same table for all
+                            // colors.
+                            if (clr > 0 &&
+                                params[eye].m_type == DistortionParameters::
+                                                          mono_point_samples) {
+                                table = tables[eye * 3];
+                            } else if (!ComputeDistortionLookupTable(
+                                           eye, clr, params[eye], overfill,
+                                           resolution, table)) {
+                                return DistortionLookupTables();
+                            }
+                        }
+                    }
+                    return tables;
+                });
+            } else {
+                std::cerr << "RenderManagerOpenGL::UpdateDistortionMesh: "
+                             "Lookup textures need point-sample distortion, "
+                             "using a mesh instead"
+                          << std::endl;
+            }
+        }
+
+        // Construct the data buffer that will hold the vertices and texture
+        // coordinates
+        // for R,G,B distortion mapping.  Fill it in with the vertices in the
+        // first
+        // block, the red texture coordinates in the next, then the green and
+        // then
+        // the blue.  The triangles are described by a separate index buffer
+        // so that vertices shared between triangles are only stored once.
         for (size_t eye = 0; eye < numEyes; eye++) {
 
             m_numTriangles.push_back(0);
+            m_numVertices.push_back(0);
             m_triangleBuffer.push_back(nullptr);
 
-            std::vector<RenderManager::DistortionMeshVertex> mesh =
-                ComputeDistortionMesh(eye, type, distort[eye]);
-            m_numTriangles[eye] = mesh.size() / 3;
+            RenderManager::DistortionMesh mesh =
+                ComputeDistortionMeshIndexed(eye, type, distort[eye]);
+            m_numTriangles[eye] = mesh.m_indices.size() / 3;
+            m_numVertices[eye] = mesh.m_vertices.size();
             if (m_numTriangles[eye] == 0) {
                 std::cerr << "RenderManagerOpenGL::UpdateDistortionMesh: Could "
                              "not create mesh "
@@ -646,52 +1192,157 @@ namespace renderkit {
                 return false;
             }
             // 4 floats for position, 2 for each texture coordinate (R,G,B)
+            size_t numVertices = m_numVertices[eye];
             m_triangleBuffer[eye] =
-                new GLfloat[m_numTriangles[eye] * 3 * (4 + 2 + 2 + 2)];
+                new GLfloat[numVertices * (4 + 2 + 2 + 2)];
             GLfloat* cur = m_triangleBuffer[eye];
-            for (size_t tri = 0; tri < m_numTriangles[eye]; tri++) {
-                for (size_t vert = 0; vert < 3; vert++) {
-                    *(cur++) = mesh[3 * tri + vert].m_pos[0];
-                    *(cur++) = mesh[3 * tri + vert].m_pos[1];
-                    *(cur++) = 0; // Z = 0
-                    *(cur++) = 1; // Homogeneous coordinate = 1
-                }
-            }
-            for (size_t tri = 0; tri < m_numTriangles[eye]; tri++) {
-                for (size_t vert = 0; vert < 3; vert++) {
-                    *(cur++) = mesh[3 * tri + vert].m_texRed[0];
-                    *(cur++) = mesh[3 * tri + vert].m_texRed[1];
-                }
-            }
-            for (size_t tri = 0; tri < m_numTriangles[eye]; tri++) {
-                for (size_t vert = 0; vert < 3; vert++) {
-                    *(cur++) = mesh[3 * tri + vert].m_texGreen[0];
-                    *(cur++) = mesh[3 * tri + vert].m_texGreen[1];
-                }
-            }
-            for (size_t tri = 0; tri < m_numTriangles[eye]; tri++) {
-                for (size_t vert = 0; vert < 3; vert++) {
-                    *(cur++) = mesh[3 * tri + vert].m_texBlue[0];
-                    *(cur++) = mesh[3 * tri + vert].m_texBlue[1];
-                }
+            for (size_t vert = 0; vert < numVertices; vert++) {
+                *(cur++) = mesh.m_vertices[vert].m_pos[0];
+                *(cur++) = mesh.m_vertices[vert].m_pos[1];
+                *(cur++) = 0; // Z = 0
+                *(cur++) = 1; // Homogeneous coordinate = 1
+            }
+            for (size_t vert = 0; vert < numVertices; vert++) {
+                *(cur++) = mesh.m_vertices[vert].m_texRed[0];
+                *(cur++) = mesh.m_vertices[vert].m_texRed[1];
+            }
+            for (size_t vert = 0; vert < numVertices; vert++) {
+                *(cur++) = mesh.m_vertices[vert].m_texGreen[0];
+                *(cur++) = mesh.m_vertices[vert].m_texGreen[1];
+            }
+            for (size_t vert = 0; vert < numVertices; vert++) {
+                *(cur++) = mesh.m_vertices[vert].m_texBlue[0];
+                *(cur++) = mesh.m_vertices[vert].m_texBlue[1];
             }
 
             // Construct the geometry we're going to render into the eyes
-            GLuint distortBuffer, distortVAO;
+            GLuint distortBuffer, distortIndexBuffer, distortVAO;
             glGenVertexArrays(1, &distortVAO);
             glBindVertexArray(distortVAO);
             glGenBuffers(1, &distortBuffer);
             glBindBuffer(GL_ARRAY_BUFFER, distortBuffer);
-            glBufferData(GL_ARRAY_BUFFER, m_numTriangles[eye] * 3 *
-                                              (4 + 2 + 2 + 2) * sizeof(GLfloat),
+            glBufferData(GL_ARRAY_BUFFER,
+                         numVertices * (4 + 2 + 2 + 2) * sizeof(GLfloat),
                          m_triangleBuffer[eye], GL_STATIC_DRAW);
+
+            // Use 16-bit indices whenever they can address all of the
+            // vertices, since they are half the size and are all that
+            // OpenGL ES 2 supports without an extension.  The element
+            // buffer binding is stored in the VAO.
+            glGenBuffers(1, &distortIndexBuffer);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, distortIndexBuffer);
+            if (numVertices <= 65536) {
+                std::vector<GLushort> indices(mesh.m_indices.begin(),
+                                              mesh.m_indices.end());
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                             indices.size() * sizeof(GLushort),
+                             indices.data(), GL_STATIC_DRAW);
+                m_distortIndexType.push_back(GL_UNSIGNED_SHORT);
+            } else {
+                std::vector<GLuint> indices(mesh.m_indices.begin(),
+                                            mesh.m_indices.end());
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                             indices.size() * sizeof(GLuint), indices.data(),
+                             GL_STATIC_DRAW);
+                m_distortIndexType.push_back(GL_UNSIGNED_INT);
+            }
+            glBindVertexArray(0);
+
             m_distortBuffer.push_back(distortBuffer);
+            m_distortIndexBuffer.push_back(distortIndexBuffer);
             m_distortVAO.push_back(distortVAO);
         }
 
         return true;
     }
 
+    bool RenderManagerOpenGL::UpdateDistortionMeshTextureCoordinatesInternal(
+        DistortionMeshType type //< Type of mesh to produce
+        ,
+        std::vector<DistortionParameters> const&
+            distort //< Distortion parameters
+        ) {
+        // Parameter changes are free with the analytic shader, and the
+        // lookup textures have to be baked again from scratch.
+        if (m_analyticProgramId != 0 || m_lookupProgramId != 0) {
+            return UpdateDistortionMeshesInternal(type, distort);
+        }
+
+        // If we don't have meshes for all of the eyes yet, build them.
+        size_t numEyes = GetNumEyes();
+        if (numEyes > distort.size()) {
+            std::cerr << "RenderManagerOpenGL::"
+                         "UpdateDistortionMeshTextureCoordinates: Not enough "
+                         "distortion parameters for all eyes"
+                      << std::endl;
+            return false;
+        }
+        if (m_distortBuffer.size() != numEyes ||
+            m_triangleBuffer.size() != numEyes) {
+            return UpdateDistortionMeshesInternal(type, distort);
+        }
+
+        // Adaptive meshes place their vertices based on the distortion, so
+        // they have to be rebuilt.
+        for (size_t eye = 0; eye < numEyes; eye++) {
+            if (distort[eye].m_meshTolerancePixels > 0) {
+                return UpdateDistortionMeshesInternal(type, distort);
+            }
+        }
+
+        // Compute all of the new meshes before touching the buffers, so
+        // that we can still fall back to a full rebuild if the layout of
+        // any of them has changed.  The vertex positions and indices only
+        // depend on the mesh type and size, so if the vertex and triangle
+        // counts match then only the texture coordinates differ.  Skip the
+        // persistent cache: these parameters are transient.
+        std::vector<RenderManager::DistortionMesh> meshes(numEyes);
+        for (size_t eye = 0; eye < numEyes; eye++) {
+            meshes[eye] = ComputeDistortionMeshIndexed(eye, type, distort[eye],
+                                                       false);
+            if (meshes[eye].m_vertices.size() != m_numVertices[eye] ||
+                meshes[eye].m_indices.size() != m_numTriangles[eye] * 3) {
+                return UpdateDistortionMeshesInternal(type, distort);
+            }
+        }
+
+        // Rewrite the red, green, and blue texture-coordinate blocks that
+        // follow the positions in each eye's buffer, and stream just those
+        // into the existing buffer object.
+        for (size_t eye = 0; eye < numEyes; eye++) {
+            size_t numVertices = m_numVertices[eye];
+            GLfloat* texStart = m_triangleBuffer[eye] + numVertices * 4;
+            GLfloat* cur = texStart;
+            const std::vector<DistortionMeshVertex>& vertices =
+                meshes[eye].m_vertices;
+            for (size_t vert = 0; vert < numVertices; vert++) {
+                *(cur++) = vertices[vert].m_texRed[0];
+                *(cur++) = vertices[vert].m_texRed[1];
+            }
+            for (size_t vert = 0; vert < numVertices; vert++) {
+                *(cur++) = vertices[vert].m_texGreen[0];
+                *(cur++) = vertices[vert].m_texGreen[1];
+            }
+            for (size_t vert = 0; vert < numVertices; vert++) {
+                *(cur++) = vertices[vert].m_texBlue[0];
+                *(cur++) = vertices[vert].m_texBlue[1];
+            }
+
+            glBindBuffer(GL_ARRAY_BUFFER, m_distortBuffer[eye]);
+            glBufferSubData(GL_ARRAY_BUFFER,
+                            numVertices * 4 * sizeof(GLfloat),
+                            numVertices * (2 + 2 + 2) * sizeof(GLfloat),
+                            texStart);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        if (checkForGLError("RenderManagerOpenGL::"
+                            "UpdateDistortionMeshTextureCoordinates")) {
+            return false;
+        }
+
+        return true;
+    }
+
     bool RenderManagerOpenGL::RenderFrameInitialize() {
         return PresentFrameInitialize();
     }
@@ -728,6 +1379,7 @@ namespace renderkit {
             return false;
         }
 
+        RM_TRACE_SCOPE("SDL_GL_SwapWindow");
         SDL_GL_SwapWindow(m_displays[display].m_window);
         return true;
     }
@@ -791,7 +1443,28 @@ namespace renderkit {
         GLint userProgram;
         glGetIntegerv(GL_CURRENT_PROGRAM, &userProgram);
         checkForGLError("RenderManagerOpenGL::PresentEye after get user program");
-        glUseProgram(m_programId);
+        // Switch to the lookup textures once their bake has finished.  The
+        // analytic and lookup distortion programs have their own uniforms.
+        updateLookupTextures();
+        GLint projectionUniformId = m_projectionUniformId;
+        GLint modelViewUniformId = m_modelViewUniformId;
+        GLint textureUniformId = m_textureUniformId;
+        GLint textureEndUniformId = m_textureEndUniformId;
+        if (m_analyticDistortion) {
+            glUseProgram(m_analyticProgramId);
+            projectionUniformId = m_analyticProjectionUniformId;
+            modelViewUniformId = m_analyticModelViewUniformId;
+            textureUniformId = m_analyticTextureUniformId;
+            textureEndUniformId = m_analyticTextureEndUniformId;
+        } else if (m_lookupDistortion) {
+            glUseProgram(m_lookupProgramId);
+            projectionUniformId = m_lookupProjectionUniformId;
+            modelViewUniformId = m_lookupModelViewUniformId;
+            textureUniformId = m_lookupTextureUniformId;
+            textureEndUniformId = m_lookupTextureEndUniformId;
+        } else {
+            glUseProgram(m_programId);
+        }
         if (checkForGLError(
           "RenderManagerOpenGL::PresentEye after use program")) {
           return false;
@@ -805,7 +1478,7 @@ namespace renderkit {
         GLfloat myScale = m_params.m_renderOverfillFactor;
         GLfloat scaleProj[16] = { myScale, 0, 0, 0, 0, myScale, 0, 0,
           0, 0, 1, 0, 0, 0, 0, 1 };
-        glUniformMatrix4fv(m_projectionUniformId, 1, GL_FALSE, scaleProj);
+        glUniformMatrix4fv(projectionUniformId, 1, GL_FALSE, scaleProj);
         if (checkForGLError("RenderManagerOpenGL::PresentEye after projection "
           "matrix setting")) {
           return false;
@@ -827,7 +1500,7 @@ namespace renderkit {
             << std::endl;
           return false;
         }
-        glUniformMatrix4fv(m_modelViewUniformId, 1, GL_FALSE, modelView.data);
+        glUniformMatrix4fv(modelViewUniformId, 1, GL_FALSE, modelView.data);
         if (checkForGLError("RenderManagerOpenGL::PresentEye after modelView "
           "matrix setting")) {
           return false;
@@ -865,7 +1538,18 @@ namespace renderkit {
         full = textureEigen * cropEigen;
         memcpy(textureMat, full.data(), 16 * sizeof(float));
 
-        glUniformMatrix4fv(m_textureUniformId, 1, GL_FALSE, textureMat);
+        // The matrix for the bottom line of the eye is the same unless we
+        // are correcting for a rolling shutter.
+        float textureEndMat[16];
+        memcpy(textureEndMat, textureMat, 16 * sizeof(float));
+        if (params.m_ATWEnd != nullptr) {
+          Eigen::Map<Eigen::MatrixXf> endEigen(params.m_ATWEnd->data, 4, 4);
+          full = endEigen * cropEigen;
+          memcpy(textureEndMat, full.data(), 16 * sizeof(float));
+        }
+
+        glUniformMatrix4fv(textureUniformId, 1, GL_FALSE, textureMat);
+        glUniformMatrix4fv(textureEndUniformId, 1, GL_FALSE, textureEndMat);
         if (checkForGLError("RenderManagerOpenGL::PresentEye after texture "
           "matrix setting")) {
           return false;
@@ -922,27 +1606,124 @@ namespace renderkit {
           return false;
         }
 
-        char* base = nullptr;
-        size_t vertBase = 0;
-        size_t redBase =
-            vertBase + m_numTriangles[params.m_index] * 3 * 4 * sizeof(GLfloat);
-        size_t greenBase =
-            redBase + m_numTriangles[params.m_index] * 3 * 2 * sizeof(GLfloat);
-        size_t blueBase =
-            greenBase +
-            m_numTriangles[params.m_index] * 3 * 2 * sizeof(GLfloat);
-        glBindVertexArray(m_distortVAO[params.m_index]);
-        glBindBuffer(GL_ARRAY_BUFFER, m_distortBuffer[params.m_index]);
-        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, base + vertBase);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, base + redBase);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, base + greenBase);
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 0, base + blueBase);
-        glEnableVertexAttribArray(3);
-        glDrawArrays(GL_TRIANGLES, 0,
-                     static_cast<GLuint>(m_numTriangles[params.m_index] * 3));
+        if (m_analyticDistortion) {
+            // Hand the distortion for this eye to the shader and draw the
+            // quad that covers the eye.
+            DistortionParameters const& d =
+                m_analyticParameters[params.m_index];
+            const std::vector<float>* polynomials[3] = {
+                &d.m_distortionPolynomialRed, &d.m_distortionPolynomialGreen,
+                &d.m_distortionPolynomialBlue};
+            GLfloat coefficients[3 * ANALYTIC_MAX_COEFFICIENTS] = {};
+            GLint numCoefficients[3];
+            for (size_t clr = 0; clr < 3; clr++) {
+                numCoefficients[clr] =
+                    static_cast<GLint>(polynomials[clr]->size());
+                std::copy(polynomials[clr]->begin(), polynomials[clr]->end(),
+                          coefficients + clr * ANALYTIC_MAX_COEFFICIENTS);
+            }
+            glUniform1f(m_analyticOverfillUniformId,
+                        m_params.m_renderOverfillFactor);
+            glUniform2f(m_analyticCOPUniformId, d.m_distortionCOP[0],
+                        d.m_distortionCOP[1]);
+            glUniform2f(m_analyticDUniformId, d.m_distortionD[0],
+                        d.m_distortionD[1]);
+            glUniform1fv(m_analyticCoefficientsUniformId,
+                         3 * ANALYTIC_MAX_COEFFICIENTS, coefficients);
+            glUniform3iv(m_analyticNumCoefficientsUniformId, 1,
+                         numCoefficients);
+            glBindVertexArray(m_distortionQuadVAO);
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        } else if (m_lookupDistortion) {
+            // Bind this eye's lookup textures and draw the quad that
+            // covers the eye, then put the rendered image's unit back.
+            for (GLuint clr = 0; clr < 3; clr++) {
+                glActiveTexture(GL_TEXTURE0 + LOOKUP_FIRST_TEXTURE_UNIT + clr);
+                glBindTexture(GL_TEXTURE_2D,
+                              m_lookupTextures[params.m_index * 3 + clr]);
+            }
+            glBindVertexArray(m_distortionQuadVAO);
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+            for (GLuint clr = 0; clr < 3; clr++) {
+                glActiveTexture(GL_TEXTURE0 + LOOKUP_FIRST_TEXTURE_UNIT + clr);
+                glBindTexture(GL_TEXTURE_2D, 0);
+            }
+            glActiveTexture(GL_TEXTURE0);
+        } else {
+            char* base = nullptr;
+            size_t vertBase = 0;
+            size_t numVertices = m_numVertices[params.m_index];
+            size_t redBase = vertBase + numVertices * 4 * sizeof(GLfloat);
+            size_t greenBase = redBase + numVertices * 2 * sizeof(GLfloat);
+            size_t blueBase = greenBase + numVertices * 2 * sizeof(GLfloat);
+            glBindVertexArray(m_distortVAO[params.m_index]);
+            glBindBuffer(GL_ARRAY_BUFFER, m_distortBuffer[params.m_index]);
+            glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0,
+                                  base + vertBase);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, base + redBase);
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0,
+                                  base + greenBase);
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 0, base + blueBase);
+            glEnableVertexAttribArray(3);
+
+#ifndef RM_USE_OPENGLES20
+            // Hand the depth buffer to the vertex shader if the time warp
+            // is correcting for depth and it was registered as a depth
+            // texture.  It is read as a plain (not comparison) texture at
+            // the nearest texel.
+            GLuint depthBuffer = params.m_buffer.OpenGL->depthStencilBufferName;
+            bool useDepth = (params.m_ATWDepth != nullptr) &&
+                            (m_timeWarpDepthTextures.count(depthBuffer) > 0);
+            if ((params.m_ATWDepth != nullptr) && (depthBuffer != 0) &&
+                !useDepth &&
+                m_timeWarpDepthRejected.insert(depthBuffer).second) {
+                std::cerr << "RenderManagerOpenGL::PresentEye(): Depth buffer "
+                          << depthBuffer << " was not registered as a 2D "
+                          << "depth texture, so time warp will assume a "
+                          << "single depth for it" << std::endl;
+            }
+            glUniform1i(m_useDepthUniformId, useDepth ? 1 : 0);
+            if (useDepth) {
+                TimeWarpDepth const& d = *params.m_ATWDepth;
+                glUniform2f(m_depthParallaxUniformId, d.m_parallax[0],
+                            d.m_parallax[1]);
+                glUniform3f(m_depthPlanesUniformId, d.m_nearClip, d.m_farClip,
+                            d.m_inverseAssumedDepth);
+                glActiveTexture(GL_TEXTURE0 + DEPTH_TEXTURE_UNIT);
+                glBindTexture(GL_TEXTURE_2D, depthBuffer);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE,
+                                GL_NONE);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
+                                GL_NEAREST);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                                GL_NEAREST);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,
+                                GL_CLAMP_TO_EDGE);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,
+                                GL_CLAMP_TO_EDGE);
+                glActiveTexture(GL_TEXTURE0);
+            }
+#else
+            // Depth textures are not part of OpenGL ES 2.0.
+            glUniform1i(m_useDepthUniformId, 0);
+#endif
+
+            glDrawElements(
+                GL_TRIANGLES,
+                static_cast<GLsizei>(m_numTriangles[params.m_index] * 3),
+                m_distortIndexType[params.m_index], nullptr);
+
+#ifndef RM_USE_OPENGLES20
+            if (useDepth) {
+                glActiveTexture(GL_TEXTURE0 + DEPTH_TEXTURE_UNIT);
+                glBindTexture(GL_TEXTURE_2D, 0);
+                glActiveTexture(GL_TEXTURE0);
+            }
+#endif
+        }
 
         // Put rendering parameters back the way they were before we set them
         // above.
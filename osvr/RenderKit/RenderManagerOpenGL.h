@@ -76,6 +76,8 @@ Sensics, Inc.
 
 #include <vector>
 #include <string>
+#include <future>
+#include <set>
 
 namespace osvr {
 namespace renderkit {
@@ -103,6 +105,20 @@ namespace renderkit {
                 distort //< Distortion parameters
             ) override;
 
+        OSVR_RENDERMANAGER_EXPORT bool
+        UpdateDistortionMeshTextureCoordinatesInternal(
+            DistortionMeshType type //< Type of mesh to produce
+            ,
+            std::vector<DistortionParameters> const&
+                distort //< Distortion parameters
+            ) override;
+
+        /// Checks which of the buffers' depthStencilBufferNames are depth
+        /// textures that time warp can sample, then registers them.
+        bool RegisterRenderBuffersInternal(
+            const std::vector<RenderBuffer>& buffers,
+            bool appWillNotOverwriteBeforeNewPresent = false) override;
+
         bool m_doingOkay;   //< Are we doing okay?
         bool m_displayOpen; //< Has our display been opened?
 
@@ -166,8 +182,113 @@ namespace renderkit {
         GLuint
             m_modelViewUniformId; //< Pointer to modelView matrix, vertex shader
         GLuint m_textureUniformId; //< Pointer to texture matrix, vertex shader
+        GLuint m_textureEndUniformId; //< Pointer to texture matrix for the
+                                      /// bottom line, vertex shader
+        GLint m_useDepthUniformId = -1;      //< Is there depth for time warp?
+        GLint m_depthParallaxUniformId = -1; //< Time-warp parallax per 1/m
+        GLint m_depthPlanesUniformId = -1;   //< Near, far, 1/assumed depth
         GLuint m_frameBuffer;      //< Groups a color buffer and a depth buffer
 
+        // Shader and geometry for the AnalyticDistortion method, which
+        // draws a single quad per eye and evaluates rgb_symmetric_polynomials
+        // distortion per pixel in the fragment shader, so that no mesh is
+        // needed and changing the parameters costs nothing.
+        bool m_analyticDistortion = false; //< Is the analytic path in use?
+        GLuint m_analyticProgramId = 0;    //< Groups the analytic shaders
+        GLint m_analyticProjectionUniformId = -1; //< Projection matrix
+        GLint m_analyticModelViewUniformId = -1;  //< ModelView matrix
+        GLint m_analyticTextureUniformId = -1;    //< Texture (ATW) matrix
+        GLint m_analyticTextureEndUniformId = -1; //< Bottom-line ATW matrix
+        GLint m_analyticOverfillUniformId = -1;   //< Render overfill factor
+        GLint m_analyticCOPUniformId = -1;        //< Center of projection
+        GLint m_analyticDUniformId = -1;          //< Distortion D scale
+        GLint m_analyticCoefficientsUniformId = -1;    //< All coefficients
+        GLint m_analyticNumCoefficientsUniformId = -1; //< Count per color
+        std::vector<DistortionParameters>
+            m_analyticParameters; //< Distortion to apply, one per eye
+
+        // Shader and textures for the LookupTextureDistortion method, which
+        // draws a single quad per eye and looks the distorted texture
+        // coordinates up in RG32F textures that are baked from point-sample
+        // distortion on a background thread.  The mesh is used until the
+        // bake finishes.
+        bool m_lookupDistortion = false; //< Are the lookup textures in use?
+        GLuint m_lookupProgramId = 0;    //< Groups the lookup shaders
+        GLint m_lookupProjectionUniformId = -1; //< Projection matrix
+        GLint m_lookupModelViewUniformId = -1;  //< ModelView matrix
+        GLint m_lookupTextureUniformId = -1;    //< Texture (ATW) matrix
+        GLint m_lookupTextureEndUniformId = -1; //< Bottom-line ATW matrix
+        std::vector<GLuint>
+            m_lookupTextures; //< Red, green, blue texture for each eye
+
+        /// Baked tables, red, green, and blue for each eye in turn; empty
+        /// if the bake failed.
+        typedef std::vector<std::vector<float> > DistortionLookupTables;
+        std::future<DistortionLookupTables>
+            m_lookupBake; //< Bake in progress, if valid()
+
+        /// Number of the first texture unit used for the lookup textures;
+        /// the rendered image is on unit 0.
+        static const GLuint LOOKUP_FIRST_TEXTURE_UNIT = 1;
+
+        /// Texture unit the mesh shader reads the depth buffer from when
+        /// time warp is correcting for depth, after the lookup textures.
+        static const GLuint DEPTH_TEXTURE_UNIT = LOOKUP_FIRST_TEXTURE_UNIT + 3;
+
+        /// depthStencilBufferNames of registered buffers that are 2D depth
+        /// textures, which are the only ones PresentEye() will sample.
+        std::set<GLuint> m_timeWarpDepthTextures;
+        /// Depth buffers we have already said time warp cannot use.
+        std::set<GLuint> m_timeWarpDepthRejected;
+
+        // Quad covering an eye, shared by the methods that don't use a mesh.
+        GLuint m_distortionQuadVAO = 0;    //< Vertex array for the quad
+        GLuint m_distortionQuadBuffer = 0; //< Positions and texture coords
+
+        /// Maximum number of polynomial coefficients per color that the
+        /// analytic shader handles.
+        static const size_t ANALYTIC_MAX_COEFFICIENTS = 8;
+
+        /// Compile and link the analytic distortion program and build the
+        /// quad.  Returns false (leaving no program) on failure.
+        bool constructAnalyticDistortion();
+
+        /// Release the program built by constructAnalyticDistortion().
+        void deleteAnalyticDistortion();
+
+        /// Can the analytic shader apply these parameters exactly?
+        static bool canUseAnalyticDistortion(DistortionParameters const& d);
+
+        /// Compile and link the lookup-texture distortion program and
+        /// build the quad.  Returns false (leaving no program) on failure.
+        bool constructLookupDistortion();
+
+        /// Release the program built by constructLookupDistortion(), along
+        /// with any lookup textures.
+        void deleteLookupDistortion();
+
+        /// Release the lookup textures, abandoning any bake in progress.
+        void deleteLookupTextures();
+
+        /// Can lookup textures be baked from these parameters?
+        static bool canUseLookupDistortion(DistortionParameters const& d);
+
+        /// If the background bake has finished, upload its tables as the
+        /// lookup textures and switch to using them.  Must be called with
+        /// our OpenGL context current.  Does nothing with OpenGL ES 2.0,
+        /// which has no RG32F textures.
+        void updateLookupTextures();
+
+        /// Build the quad shared by the analytic and lookup methods, if it
+        /// has not already been built.
+        bool constructDistortionQuad();
+
+        /// Release the quad built by constructDistortionQuad().
+        void deleteDistortionQuad();
+
+        /// Release all of the per-eye distortion mesh buffers.
+        void deleteDistortionMeshes();
+
         std::vector<RenderBuffer>
             m_colorBuffers; //< Color buffers to hand to render callbacks
         std::vector<GLuint> m_depthBuffers; //< Depth/stencil buffers to hand to
@@ -181,10 +302,16 @@ namespace renderkit {
             m_distortBuffer; //< Buffer objects to point to geometry to render
         std::vector<GLuint>
             m_distortVAO; //< Vertex array objects for the geometry to render
+        std::vector<GLuint>
+            m_distortIndexBuffer; //< Index buffers for the geometry to render
+        std::vector<GLenum>
+            m_distortIndexType; //< Type of the indices in each index buffer
         std::vector<GLfloat*>
-            m_triangleBuffer; //< Pointer to our triangle array buffers
+            m_triangleBuffer; //< Pointer to our vertex array buffers
+        std::vector<size_t>
+            m_numVertices; //< Number of vertices in our array buffers
         std::vector<size_t>
-            m_numTriangles; //< Number of triangles in our array buffers
+            m_numTriangles; //< Number of triangles in our index buffers
 
         //===================================================================
         // Overloaded render functions from the base class.
@@ -217,7 +344,7 @@ namespace renderkit {
         static bool checkForGLError(const std::string& message);
 
         friend RenderManager OSVR_RENDERMANAGER_EXPORT*
-        createRenderManager(OSVR_ClientContext context,
+        createRenderManager(std::shared_ptr<PoseSource> poseSource,
                             const std::string& renderLibraryName,
                             GraphicsLibrary graphicsLibrary);
     };
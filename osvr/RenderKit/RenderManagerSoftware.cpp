@@ -0,0 +1,531 @@
+/** @file
+@brief Source file implementing the OSVR headless software rendering
+interface.
+
+@date 2016
+
+@author
+Sensics, Inc.
+<http://sensics.com/osvr>
+*/
+
+// Copyright 2016 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RenderManagerSoftware.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+/// Sample one channel of an image with bilinear filtering, treating
+/// everything outside of the image as black (as the OpenGL renderer does
+/// with its clamp-to-border texture mode).  Texture coordinates (0,0) and
+/// (1,1) are the lower-left and upper-right corners of the image.
+static float sampleChannel(osvr::renderkit::RenderBufferSoftware const& image,
+                           float u, float v, size_t channel) {
+    float w = static_cast<float>(image.width);
+    float h = static_cast<float>(image.height);
+    float x = u * w - 0.5f;
+    float y = v * h - 0.5f;
+    // This also rejects NaN coordinates.
+    if (!(x > -1.0f && x < w && y > -1.0f && y < h)) {
+        return 0.0f;
+    }
+    float fx = std::floor(x);
+    float fy = std::floor(y);
+    float ax = x - fx;
+    float ay = y - fy;
+    int x0 = static_cast<int>(fx);
+    int y0 = static_cast<int>(fy);
+    int width = static_cast<int>(image.width);
+    int height = static_cast<int>(image.height);
+    auto texel = [&](int xi, int yi) -> float {
+        if (xi < 0 || yi < 0 || xi >= width || yi >= height) {
+            return 0.0f;
+        }
+        return image.colorBuffer[(static_cast<size_t>(yi) * image.width +
+                                  static_cast<size_t>(xi)) *
+                                     4 +
+                                 channel];
+    };
+    return (1 - ay) * ((1 - ax) * texel(x0, y0) + ax * texel(x0 + 1, y0)) +
+           ay * ((1 - ax) * texel(x0, y0 + 1) + ax * texel(x0 + 1, y0 + 1));
+}
+
+/// Look up the depth in an image's depth buffer at the nearest texel to
+/// a texture coordinate and convert it from OpenGL window depth into the
+/// inverse of the distance in meters, for the projection with the given
+/// clipping planes.  Returns inverseFallback outside of the image.
+static float sampleInverseDepth(
+    osvr::renderkit::RenderBufferSoftware const& image, float u, float v,
+    float nearClip, float farClip, float inverseFallback) {
+    float x = std::floor(u * static_cast<float>(image.width));
+    float y = std::floor(v * static_cast<float>(image.height));
+    // This also rejects NaN coordinates.
+    if (!(x >= 0 && x < static_cast<float>(image.width) && y >= 0 &&
+          y < static_cast<float>(image.height))) {
+        return inverseFallback;
+    }
+    float z = image.depthBuffer[static_cast<size_t>(y) * image.width +
+                                static_cast<size_t>(x)];
+    float ndc = 2 * std::min(std::max(z, 0.0f), 1.0f) - 1;
+    return (farClip + nearClip - ndc * (farClip - nearClip)) /
+           (2 * nearClip * farClip);
+}
+
+namespace osvr {
+namespace renderkit {
+
+    RenderManagerSoftware::RenderManagerSoftware(OSVR_ClientContext context,
+                                                 ConstructorParameters p)
+        : RenderManager(context, p) {
+        // Initialize all of the variables that don't have to be done in the
+        // list above, so we don't get warnings about out-of-order
+        // initialization if they are re-ordered in the header file.
+        m_doingOkay = true;
+        m_displayOpen = false;
+
+        // Construct the appropriate GraphicsLibrary pointer.  The buffer
+        // pointer is aimed at each eye's buffer as it is rendered.
+        m_library.Software = new GraphicsLibrarySoftware;
+    }
+
+    RenderManagerSoftware::~RenderManagerSoftware() {
+        for (size_t i = 0; i < m_colorBuffers.size(); i++) {
+            delete m_colorBuffers[i].Software;
+        }
+        delete m_library.Software;
+    }
+
+    bool RenderManagerSoftware::constructRenderBuffers() {
+        // Create the render images we're going to use to render into
+        // before presenting them as buffers to be displayed.  We make one
+        // per eye.
+        size_t numEyes = GetNumEyes();
+        for (size_t i = 0; i < numEyes; i++) {
+            // Determine the appropriate size for the buffer to be used
+            // for this eye.
+            OSVR_ViewportDescription v;
+            ConstructViewportForRender(i, v);
+
+            RenderBuffer rb;
+            rb.Software = new RenderBufferSoftware;
+            rb.Software->width = static_cast<size_t>(v.width);
+            rb.Software->height = static_cast<size_t>(v.height);
+            rb.Software->colorBuffer.assign(
+                rb.Software->width * rb.Software->height * 4, 0);
+            m_colorBuffers.push_back(rb);
+        }
+
+        // Register the render buffers we're going to use to present
+        return RegisterRenderBuffersInternal(m_colorBuffers);
+    }
+
+    RenderManager::OpenResults RenderManagerSoftware::OpenDisplay(void) {
+        // All public methods that use internal state should be guarded
+        // by a mutex.
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        OpenResults ret;
+        ret.library = m_library;
+        ret.status = COMPLETE; // Until we hear otherwise
+        if (!doingOkay()) {
+            ret.status = FAILURE;
+            return ret;
+        }
+
+        //======================================================
+        // Make the images that stand in for the displays.  If we've
+        // rotated the screen by 90 or 270, then the display has swapped
+        // aspect ratios.
+        RenderBufferSoftware image;
+        if ((m_params.m_displayRotation ==
+             ConstructorParameters::Display_Rotation::Ninety) ||
+            (m_params.m_displayRotation ==
+             ConstructorParameters::Display_Rotation::TwoSeventy)) {
+            image.width = static_cast<size_t>(m_displayHeight);
+            image.height = static_cast<size_t>(m_displayWidth);
+        } else {
+            image.width = static_cast<size_t>(m_displayWidth);
+            image.height = static_cast<size_t>(m_displayHeight);
+        }
+        image.colorBuffer.assign(image.width * image.height * 4, 0);
+        m_displays.clear();
+        for (size_t display = 0; display < GetNumDisplays(); display++) {
+            DisplayInfo info;
+            info.m_front = image;
+            info.m_back = image;
+            m_displays.push_back(info);
+        }
+
+        //======================================================
+        // Construct the present buffers we're going to use when in Render()
+        // mode, to wrap the Present interface.
+        if (!constructRenderBuffers()) {
+            std::cerr << "RenderManagerSoftware::OpenDisplay: Could not "
+                         "construct present buffers to wrap Render() path"
+                      << std::endl;
+            ret.status = FAILURE;
+            return ret;
+        }
+
+        if (!UpdateDistortionMeshesInternal(SQUARE,
+                                            m_params.m_distortionParameters)) {
+            std::cerr << "RenderManagerSoftware::OpenDisplay: Could not "
+                         "construct distortion mesh"
+                      << std::endl;
+            ret.status = FAILURE;
+            return ret;
+        }
+
+        //======================================================
+        // Done, we now have images to present into.
+        m_displayOpen = true;
+        return ret;
+    }
+
+    bool RenderManagerSoftware::GetPresentedImage(
+        size_t display, RenderBufferSoftware& imageOut) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_displayOpen || display >= m_displays.size()) {
+            return false;
+        }
+        imageOut = m_displays[display].m_front;
+        return true;
+    }
+
+    bool RenderManagerSoftware::UpdateDistortionMeshesInternal(
+        DistortionMeshType type //< Type of mesh to produce
+        ,
+        std::vector<DistortionParameters> const&
+            distort //< Distortion parameters
+        ) {
+        size_t numEyes = GetNumEyes();
+        if (numEyes > distort.size()) {
+            std::cerr << "RenderManagerSoftware::UpdateDistortionMesh: Not "
+                         "enough distortion parameters for all eyes"
+                      << std::endl;
+            return false;
+        }
+
+        std::vector<DistortionMesh> meshes;
+        for (size_t eye = 0; eye < numEyes; eye++) {
+            meshes.push_back(
+                ComputeDistortionMeshIndexed(eye, type, distort[eye]));
+            if (meshes.back().m_indices.empty()) {
+                std::cerr << "RenderManagerSoftware::UpdateDistortionMesh: "
+                             "Could not create mesh for eye "
+                          << eye << std::endl;
+                return false;
+            }
+        }
+        m_distortionMeshes.swap(meshes);
+        return true;
+    }
+
+    bool RenderManagerSoftware::RenderEyeInitialize(size_t eye) {
+        // Hand the callbacks the buffer for this eye.
+        m_buffers.Software = m_colorBuffers[eye].Software;
+
+        // Call the display set-up callback for each eye, because they each
+        // have their own buffer.
+        if (m_displayCallback.m_callback != nullptr) {
+            m_displayCallback.m_callback(m_displayCallback.m_userData,
+                                         m_library, m_buffers);
+        }
+        return true;
+    }
+
+    bool RenderManagerSoftware::RenderSpace(
+        size_t whichSpace //< Index into m_callbacks vector
+        , size_t whichEye //< Which eye are we rendering for?
+        , OSVR_PoseState pose //< ModelView transform to use
+        , OSVR_ViewportDescription viewport //< Viewport to use
+        , OSVR_ProjectionMatrix projection //< Projection to use
+        ) {
+        /// @todo Fill in the timing information
+        OSVR_TimeValue deadline;
+        deadline.microseconds = 0;
+        deadline.seconds = 0;
+
+        RenderCallbackInfo& cb = m_callbacks[whichSpace];
+        cb.m_callback(cb.m_userData, m_library, m_buffers, viewport, pose,
+                      projection, deadline);
+        return true;
+    }
+
+    bool RenderManagerSoftware::RenderFrameInitialize() {
+        return PresentFrameInitialize();
+    }
+
+    bool RenderManagerSoftware::RenderFrameFinalize() {
+        if (!PresentRenderBuffersInternal(m_colorBuffers, m_renderInfoForRender,
+                                          m_renderParamsForRender)) {
+            std::cerr << "RenderManagerSoftware::RenderFrameFinalize: Could "
+                         "not present render buffers"
+                      << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool RenderManagerSoftware::PresentDisplayInitialize(size_t display) {
+        if (display >= m_displays.size()) {
+            return false;
+        }
+        // Start from black, as a display would show where no eye is drawn.
+        std::vector<uint8_t>& pixels = m_displays[display].m_back.colorBuffer;
+        std::fill(pixels.begin(), pixels.end(), 0);
+        return true;
+    }
+
+    bool RenderManagerSoftware::PresentDisplayFinalize(size_t display) {
+        if (display >= m_displays.size()) {
+            return false;
+        }
+        std::swap(m_displays[display].m_front, m_displays[display].m_back);
+        return true;
+    }
+
+    void RenderManagerSoftware::rasterizeTriangle(
+        ScreenVertex const& v0, ScreenVertex const& v1, ScreenVertex const& v2,
+        OSVR_ViewportDescription const& viewport,
+        RenderBufferSoftware const& source, RenderBufferSoftware& target) {
+        // Twice the signed area; the sign tells the winding, which we
+        // don't care about (no culling).
+        float area =
+            (v1.m_x - v0.m_x) * (v2.m_y - v0.m_y) -
+            (v2.m_x - v0.m_x) * (v1.m_y - v0.m_y);
+        if (area == 0) {
+            return;
+        }
+
+        // Pixels whose centers could be in the triangle, limited to the
+        // viewport and the image.
+        float left = std::max(static_cast<float>(viewport.left), 0.0f);
+        float lower = std::max(static_cast<float>(viewport.lower), 0.0f);
+        float right = std::min(static_cast<float>(viewport.left +
+                                                  viewport.width),
+                               static_cast<float>(target.width));
+        float upper = std::min(static_cast<float>(viewport.lower +
+                                                  viewport.height),
+                               static_cast<float>(target.height));
+        float minX = std::max(std::min({v0.m_x, v1.m_x, v2.m_x}), left);
+        float maxX = std::min(std::max({v0.m_x, v1.m_x, v2.m_x}), right);
+        float minY = std::max(std::min({v0.m_y, v1.m_y, v2.m_y}), lower);
+        float maxY = std::min(std::max({v0.m_y, v1.m_y, v2.m_y}), upper);
+        if (minX >= maxX || minY >= maxY) {
+            return;
+        }
+        int firstX = static_cast<int>(std::floor(minX));
+        int lastX = static_cast<int>(std::ceil(maxX));
+        int firstY = static_cast<int>(std::floor(minY));
+        int lastY = static_cast<int>(std::ceil(maxY));
+
+        // The barycentric weights of v0 and v1 are linear in x and y;
+        // find their values at the center of the first pixel and how they
+        // change from one pixel to the next.
+        float invArea = 1.0f / area;
+        float dw0dx = -(v2.m_y - v1.m_y) * invArea;
+        float dw0dy = (v2.m_x - v1.m_x) * invArea;
+        float dw1dx = -(v0.m_y - v2.m_y) * invArea;
+        float dw1dy = (v0.m_x - v2.m_x) * invArea;
+        float startX = firstX + 0.5f;
+        float startY = firstY + 0.5f;
+        float w0Row = ((v2.m_x - v1.m_x) * (startY - v1.m_y) -
+                       (v2.m_y - v1.m_y) * (startX - v1.m_x)) *
+                      invArea;
+        float w1Row = ((v0.m_x - v2.m_x) * (startY - v2.m_y) -
+                       (v0.m_y - v2.m_y) * (startX - v2.m_x)) *
+                      invArea;
+
+        for (int y = firstY; y < lastY; y++) {
+            float w0 = w0Row;
+            float w1 = w1Row;
+            float cy = y + 0.5f;
+            for (int x = firstX; x < lastX; x++) {
+                float w2 = 1.0f - w0 - w1;
+                float cx = x + 0.5f;
+                if (w0 >= 0 && w1 >= 0 && w2 >= 0 && cx >= left &&
+                    cx < right && cy >= lower && cy < upper) {
+                    uint8_t* pixel =
+                        &target.colorBuffer[(static_cast<size_t>(y) *
+                                                 target.width +
+                                             static_cast<size_t>(x)) *
+                                            4];
+                    for (size_t clr = 0; clr < 3; clr++) {
+                        float u = w0 * v0.m_tex[clr][0] +
+                                  w1 * v1.m_tex[clr][0] +
+                                  w2 * v2.m_tex[clr][0];
+                        float v = w0 * v0.m_tex[clr][1] +
+                                  w1 * v1.m_tex[clr][1] +
+                                  w2 * v2.m_tex[clr][1];
+                        float value = sampleChannel(source, u, v, clr);
+                        pixel[clr] = static_cast<uint8_t>(
+                            std::min(value + 0.5f, 255.0f));
+                    }
+                    pixel[3] = 255;
+                }
+                w0 += dw0dx;
+                w1 += dw1dx;
+            }
+            w0Row += dw0dy;
+            w1Row += dw1dy;
+        }
+    }
+
+    bool RenderManagerSoftware::PresentEye(PresentEyeParameters params) {
+        if (params.m_buffer.Software == nullptr) {
+            std::cerr
+                << "RenderManagerSoftware::PresentEye(): NULL buffer pointer"
+                << std::endl;
+            return false;
+        }
+        RenderBufferSoftware const& source = *params.m_buffer.Software;
+        if (source.colorBuffer.size() < source.width * source.height * 4) {
+            std::cerr << "RenderManagerSoftware::PresentEye(): Buffer is "
+                         "smaller than its size says"
+                      << std::endl;
+            return false;
+        }
+        if (params.m_index >= m_distortionMeshes.size()) {
+            std::cerr << "RenderManagerSoftware::PresentEye(): No distortion "
+                         "mesh for eye "
+                      << params.m_index << std::endl;
+            return false;
+        }
+
+        // Construct the viewport based on which eye this is.
+        OSVR_ViewportDescription viewportDesc;
+        if (!ConstructViewportForPresent(
+                params.m_index, viewportDesc,
+                m_params.m_displayConfiguration.getSwapEyes())) {
+            std::cerr << "RenderManagerSoftware::PresentEye(): Could not "
+                         "construct viewport"
+                      << std::endl;
+            return false;
+        }
+        // Adjust the viewport based on how much the display is rotated
+        // with respect to the rendering window.
+        viewportDesc = RotateViewport(viewportDesc);
+
+        // Figure out which display we're rendering to for this eye.
+        /// @todo This will need to be generalized when we have multiple
+        /// displays per eye.
+        size_t display = GetDisplayUsedByEye(params.m_index);
+        if (display >= m_displays.size()) {
+            return false;
+        }
+
+        // Build the same transformations that the OpenGL renderer hands to
+        // its shaders: a projection that undoes the overfill scale, a
+        // ModelView that rotates and flips to match the display, and a
+        // texture matrix that applies time warp and then crops to this
+        // eye's part of the buffer.  A rolling-shutter time warp has a
+        // second texture matrix for the bottom line of the eye.
+        matrix16 modelView;
+        if (!ComputeDisplayOrientationMatrix(
+                static_cast<float>(params.m_rotateDegrees), params.m_flipInY,
+                modelView)) {
+            std::cerr << "RenderManagerSoftware::PresentEye(): "
+                         "ComputeDisplayOrientationMatrix failed"
+                      << std::endl;
+            return false;
+        }
+        Eigen::Matrix4f projection = Eigen::Matrix4f::Identity();
+        projection(0, 0) = m_params.m_renderOverfillFactor;
+        projection(1, 1) = m_params.m_renderOverfillFactor;
+        Eigen::Matrix4f vertexTransform =
+            projection * Eigen::Map<Eigen::Matrix4f>(modelView.data);
+
+        Eigen::Matrix4f textureTransform = Eigen::Matrix4f::Identity();
+        if (params.m_ATW != nullptr) {
+            textureTransform = Eigen::Map<Eigen::Matrix4f>(params.m_ATW->data);
+        }
+        matrix16 crop;
+        ComputeRenderBufferCropMatrix(params.m_normalizedCroppingViewport,
+                                      crop);
+        textureTransform =
+            textureTransform * Eigen::Map<Eigen::Matrix4f>(crop.data);
+        Eigen::Matrix4f textureEndTransform;
+        if (params.m_ATWEnd != nullptr) {
+            textureEndTransform =
+                Eigen::Map<Eigen::Matrix4f>(params.m_ATWEnd->data) *
+                Eigen::Map<Eigen::Matrix4f>(crop.data);
+        }
+
+        // If we have depth to go by, each vertex is moved by the parallax
+        // for the depth found where its green texture coordinate lands.
+        TimeWarpDepth const* depth = params.m_ATWDepth;
+        if (source.depthBuffer.size() < source.width * source.height) {
+            depth = nullptr;
+        }
+
+        // Transform the vertices into window coordinates, then draw each
+        // triangle.
+        DistortionMesh const& mesh = m_distortionMeshes[params.m_index];
+        std::vector<ScreenVertex> vertices(mesh.m_vertices.size());
+        for (size_t i = 0; i < mesh.m_vertices.size(); i++) {
+            DistortionMeshVertex const& in = mesh.m_vertices[i];
+            Eigen::Vector4f pos = vertexTransform *
+                Eigen::Vector4f(in.m_pos[0], in.m_pos[1], 0, 1);
+            vertices[i].m_x = static_cast<float>(
+                viewportDesc.left +
+                (pos.x() / pos.w() + 1) * 0.5 * viewportDesc.width);
+            vertices[i].m_y = static_cast<float>(
+                viewportDesc.lower +
+                (pos.y() / pos.w() + 1) * 0.5 * viewportDesc.height);
+            // How far down the eye this vertex is scanned out, from 0 at
+            // the top to 1 at the bottom.
+            float scan = std::min(
+                std::max(0.5f - 0.5f * pos.y() / pos.w(), 0.0f), 1.0f);
+            const Float2* tex[3] = {&in.m_texRed, &in.m_texGreen,
+                                    &in.m_texBlue};
+            for (size_t clr = 0; clr < 3; clr++) {
+                Eigen::Vector4f coord((*tex[clr])[0], (*tex[clr])[1], 0, 1);
+                Eigen::Vector4f t = textureTransform * coord;
+                if (params.m_ATWEnd != nullptr) {
+                    t = (1 - scan) * t + scan * (textureEndTransform * coord);
+                }
+                vertices[i].m_tex[clr][0] = t.x();
+                vertices[i].m_tex[clr][1] = t.y();
+            }
+            if (depth != nullptr) {
+                float shift =
+                    sampleInverseDepth(source, vertices[i].m_tex[1][0],
+                                       vertices[i].m_tex[1][1],
+                                       depth->m_nearClip, depth->m_farClip,
+                                       depth->m_inverseAssumedDepth) -
+                    depth->m_inverseAssumedDepth;
+                for (size_t clr = 0; clr < 3; clr++) {
+                    vertices[i].m_tex[clr][0] += shift * depth->m_parallax[0];
+                    vertices[i].m_tex[clr][1] += shift * depth->m_parallax[1];
+                }
+            }
+        }
+
+        RenderBufferSoftware& target = m_displays[display].m_back;
+        for (size_t i = 0; i + 2 < mesh.m_indices.size(); i += 3) {
+            rasterizeTriangle(vertices[mesh.m_indices[i]],
+                              vertices[mesh.m_indices[i + 1]],
+                              vertices[mesh.m_indices[i + 2]], viewportDesc,
+                              source, target);
+        }
+        return true;
+    }
+
+} // namespace renderkit
+} // namespace osvr
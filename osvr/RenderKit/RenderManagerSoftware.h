@@ -0,0 +1,148 @@
+/** @file
+@brief Header file describing the OSVR headless software rendering
+interface.
+
+@date 2016
+
+@author
+Sensics, Inc.
+<http://sensics.com/osvr>
+*/
+
+// Copyright 2016 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include "RenderManager.h"
+#include "GraphicsLibrarySoftware.h"
+
+#include <vector>
+#include <string>
+
+namespace osvr {
+namespace renderkit {
+
+    /// @brief RenderManager that draws into images in memory
+    ///
+    /// Runs the whole presentation pipeline (distortion mesh, time warp,
+    /// display rotation) on the CPU, rasterizing the distortion mesh into
+    /// one image per display instead of a window.  It needs no GPU or
+    /// display, so it can be used to benchmark and regression-test the
+    /// present path on build machines.  Select it by passing "Software"
+    /// as the rendering library name to createRenderManager().
+    class RenderManagerSoftware : public RenderManager {
+      public:
+        virtual ~RenderManagerSoftware();
+
+        // Is the renderer currently working?
+        bool doingOkay() override { return m_doingOkay; }
+
+        // Allocates the images we're going to present into.
+        OpenResults OpenDisplay() override;
+
+        /// @brief Copy the most recently presented image for a display
+        ///  The image has the size of the display as it is scanned out
+        /// (width and height swapped for 90 and 270 degree rotations).
+        /// @return True on success, false (with imageOut unchanged) if the
+        /// display is not open or there is no such display.
+        OSVR_RENDERMANAGER_EXPORT bool
+        GetPresentedImage(size_t display, RenderBufferSoftware& imageOut);
+
+      protected:
+        /// Construct a software render manager.
+        RenderManagerSoftware(OSVR_ClientContext context,
+                              ConstructorParameters p);
+
+        OSVR_RENDERMANAGER_EXPORT bool UpdateDistortionMeshesInternal(
+            DistortionMeshType type //< Type of mesh to produce
+            ,
+            std::vector<DistortionParameters> const&
+                distort //< Distortion parameters
+            ) override;
+
+        bool m_doingOkay;   //< Are we doing okay?
+        bool m_displayOpen; //< Has our display been opened?
+
+        /// Construct the buffers we're going to use in Render() mode, which
+        /// we use to actually use the Presentation mode.
+        bool constructRenderBuffers();
+
+        /// Images for each display.  Eyes are drawn into the back image,
+        /// which is swapped with the front one when the display is
+        /// finalized.
+        class DisplayInfo {
+          public:
+            RenderBufferSoftware m_front; //< Most recently presented image
+            RenderBufferSoftware m_back;  //< Image being presented into
+        };
+        std::vector<DisplayInfo> m_displays;
+
+        std::vector<RenderBuffer>
+            m_colorBuffers; //< Color buffers to hand to render callbacks
+
+        std::vector<DistortionMesh> m_distortionMeshes; //< One per eye
+
+        /// Vertex of the distortion mesh after it has been transformed
+        /// into window coordinates, with its texture coordinates
+        /// transformed by the texture matrix.
+        class ScreenVertex {
+          public:
+            float m_x, m_y;     //< Window coordinates, in pixels
+            float m_tex[3][2];  //< Red, green, and blue texture coordinates
+        };
+
+        /// Fill the pixels covered by a triangle in an image, taking each
+        /// color from the source image at the interpolated texture
+        /// coordinates for that color.  Pixels whose centers are outside of
+        /// the viewport are not touched.
+        static void rasterizeTriangle(ScreenVertex const& v0,
+                                      ScreenVertex const& v1,
+                                      ScreenVertex const& v2,
+                                      OSVR_ViewportDescription const& viewport,
+                                      RenderBufferSoftware const& source,
+                                      RenderBufferSoftware& target);
+
+        //===================================================================
+        // Overloaded render functions from the base class.
+        bool RenderFrameInitialize() override;
+        bool RenderDisplayInitialize(size_t display) override { return true; }
+        bool RenderEyeInitialize(size_t eye) override;
+        bool RenderSpace(size_t whichSpace //< Index into m_callbacks vector
+                         ,
+                         size_t whichEye //< Which eye are we rendering for?
+                         ,
+                         OSVR_PoseState pose //< ModelView transform to use
+                         ,
+                         OSVR_ViewportDescription viewport //< Viewport to use
+                         ,
+                         OSVR_ProjectionMatrix projection //< Projection to use
+                         ) override;
+        bool RenderEyeFinalize(size_t eye) override { return true; }
+        bool RenderDisplayFinalize(size_t display) override { return true; }
+        bool RenderFrameFinalize() override;
+
+        bool PresentFrameInitialize() override { return true; }
+        bool PresentDisplayInitialize(size_t display) override;
+        bool PresentEye(PresentEyeParameters params) override;
+        bool PresentDisplayFinalize(size_t display) override;
+        bool PresentFrameFinalize() override { return true; }
+
+        friend RenderManager OSVR_RENDERMANAGER_EXPORT*
+        createRenderManager(std::shared_ptr<PoseSource> poseSource,
+                            const std::string& renderLibraryName,
+                            GraphicsLibrary graphicsLibrary);
+    };
+
+} // namespace renderkit
+} // namespace osvr
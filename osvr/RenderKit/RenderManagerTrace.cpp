@@ -0,0 +1,128 @@
+/** @file
+    @brief Implementation of the optional frame-phase trace buffer.
+
+    @date 2016
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com/osvr>
+*/
+
+// Copyright 2016 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include "RenderManagerTrace.h"
+
+// Standard includes
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+namespace osvr {
+namespace renderkit {
+namespace trace {
+
+#ifdef RM_USE_TRACING
+
+    /// One entry in the trace ring buffer.  Its sequence number is odd
+    /// while it is being written and is 2*(n+1) once it holds event n, so
+    /// that it can be read without locking.
+    class EventSlot {
+      public:
+        std::atomic<uint64_t> m_sequence;
+        const char* m_name;
+        uint32_t m_thread;
+        int64_t m_beginMicros;
+        int64_t m_durationMicros;
+    };
+
+    // Zero-initialized because they have static storage duration.
+    static std::array<EventSlot, TRACE_BUFFER_EVENTS> s_events;
+    static std::atomic<uint64_t> s_eventsRecorded;
+
+    static int64_t microseconds(std::chrono::steady_clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d)
+            .count();
+    }
+
+    void RecordEvent(const char* name,
+                     std::chrono::steady_clock::time_point begin,
+                     std::chrono::steady_clock::time_point end) {
+        uint64_t event = s_eventsRecorded.fetch_add(1);
+        EventSlot& slot = s_events[event % TRACE_BUFFER_EVENTS];
+
+        slot.m_sequence.store(2 * event + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.m_name = name;
+        slot.m_thread = static_cast<uint32_t>(
+            std::hash<std::thread::id>()(std::this_thread::get_id()));
+        slot.m_beginMicros = microseconds(begin.time_since_epoch());
+        slot.m_durationMicros = microseconds(end - begin);
+        slot.m_sequence.store(2 * event + 2, std::memory_order_release);
+    }
+
+    bool WriteChromeTrace(std::ostream& out) {
+        out << "{\"traceEvents\":[";
+        uint64_t count = s_eventsRecorded.load(std::memory_order_acquire);
+        uint64_t first =
+            (count > TRACE_BUFFER_EVENTS) ? count - TRACE_BUFFER_EVENTS : 0;
+        bool firstWritten = true;
+        for (uint64_t event = first; event < count; event++) {
+            const EventSlot& slot = s_events[event % TRACE_BUFFER_EVENTS];
+            uint64_t expected = 2 * event + 2;
+            if (slot.m_sequence.load(std::memory_order_acquire) != expected) {
+                // Still being written, or already replaced by a newer one.
+                continue;
+            }
+            const char* name = slot.m_name;
+            uint32_t thread = slot.m_thread;
+            int64_t begin = slot.m_beginMicros;
+            int64_t duration = slot.m_durationMicros;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.m_sequence.load(std::memory_order_relaxed) != expected) {
+                continue;
+            }
+
+            if (!firstWritten) {
+                out << ",";
+            }
+            firstWritten = false;
+            out << "\n{\"name\":\"" << name
+                << "\",\"cat\":\"RenderManager\",\"ph\":\"X\",\"pid\":1"
+                << ",\"tid\":" << thread << ",\"ts\":" << begin
+                << ",\"dur\":" << duration << "}";
+        }
+        out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+        return static_cast<bool>(out);
+    }
+
+#else
+
+    void RecordEvent(const char* name,
+                     std::chrono::steady_clock::time_point begin,
+                     std::chrono::steady_clock::time_point end) {}
+
+    bool WriteChromeTrace(std::ostream& out) {
+        out << "{\"traceEvents\":[]}\n";
+        return false;
+    }
+
+#endif
+
+} // namespace trace
+} // namespace renderkit
+} // namespace osvr
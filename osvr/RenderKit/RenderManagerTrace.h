@@ -0,0 +1,94 @@
+/** @file
+    @brief Header describing the optional trace buffer that records when
+    each phase of a RenderManager frame ran, in a form that can be loaded
+    into chrome://tracing or Perfetto.
+
+    @date 2016
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com/osvr>
+*/
+
+// Copyright 2016 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// Internal Includes
+#include <RenderManagerBackends.h>
+
+// Standard includes
+#include <chrono>
+#include <ostream>
+
+namespace osvr {
+namespace renderkit {
+namespace trace {
+
+    /// Number of events the trace buffer holds; once it is full, each new
+    /// event replaces the oldest one.
+    static const size_t TRACE_BUFFER_EVENTS = 65536;
+
+    /// @brief Record a completed event.  Thread-safe and does not block;
+    /// the name must be a string literal (only the pointer is stored).
+    void RecordEvent(const char* name,
+                     std::chrono::steady_clock::time_point begin,
+                     std::chrono::steady_clock::time_point end);
+
+    /// @brief Write the events in the trace buffer as Chrome trace-event
+    /// JSON ("X" complete events, with one tid per thread that recorded
+    /// events and timestamps in microseconds on the steady clock).
+    ///
+    /// This can be called while other threads are recording; events
+    /// that are being written at the time are skipped.
+    /// @return False if tracing is not compiled in (an empty trace is
+    /// still written) or the stream failed.
+    bool WriteChromeTrace(std::ostream& out);
+
+    /// @brief Records an event covering its own lifetime.
+    class ScopedEvent {
+      public:
+        explicit ScopedEvent(const char* name)
+            : m_name(name), m_begin(std::chrono::steady_clock::now()) {}
+        ~ScopedEvent() {
+            RecordEvent(m_name, m_begin, std::chrono::steady_clock::now());
+        }
+
+      private:
+        ScopedEvent(const ScopedEvent&) = delete;
+        ScopedEvent& operator=(const ScopedEvent&) = delete;
+
+        const char* m_name;
+        std::chrono::steady_clock::time_point m_begin;
+    };
+
+} // namespace trace
+} // namespace renderkit
+} // namespace osvr
+
+/// @brief Record a trace event named by the string literal NAME that lasts
+/// from here to the end of the enclosing scope.  Compiles to nothing
+/// unless RenderManager was configured with RM_ENABLE_TRACING.
+#ifdef RM_USE_TRACING
+#define RM_TRACE_CONCAT_IMPL(a, b) a##b
+#define RM_TRACE_CONCAT(a, b) RM_TRACE_CONCAT_IMPL(a, b)
+#define RM_TRACE_SCOPE(NAME)                                                   \
+    ::osvr::renderkit::trace::ScopedEvent RM_TRACE_CONCAT(rmTraceEvent_,       \
+                                                          __LINE__)(NAME)
+#else
+#define RM_TRACE_SCOPE(NAME)                                                   \
+    do {                                                                       \
+    } while (0)
+#endif
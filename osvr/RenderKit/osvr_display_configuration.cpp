@@ -25,6 +25,7 @@
 
 // Internal Includes
 #include "osvr_display_configuration.h"
+#include "PointMeshBinaryFormat.h"
 
 // Library/third-party includes
 #include <boost/units/io.hpp>
@@ -33,8 +34,8 @@
 
 // Standard includes
 #include <cassert>
-#include <fstream>
 #include <iostream>
+#include <vector>
 
 // Included files that define built-in distortion meshes.
 #include "osvr_display_config_built_in_osvr_hdks.h"
@@ -53,58 +54,42 @@ inline void parseDistortionMonoPointMeshes(
     osvr::renderkit::MonoPointDistortionMeshDescriptions& mesh) {
     Json::Value myDistortion = distortion;
 
-    // See if we have the name of a built-in config to parse.  If so, we open it
-    // and grab its values to parse, replacing the ones that they sent
-    // in.
-    const Json::Value builtIn = distortion["mono_point_samples_built_in"];
-    if ((!builtIn.isNull()) && (builtIn.isString())) {
-        // Read a Json value from the built-in config, then replace the
-        // distortion mesh with that from the file.
-        std::string builtInString;
-        Json::Value builtInData;
-        if (builtIn.asString() == "OSVR_HDK_13_V1") {
-            builtInString = osvr_display_config_built_in_osvr_hdk13_v1;
-        } else {
-            std::cerr
-                << "OSVRDisplayConfiguration::parse(): ERROR: Unrecognized "
-                   "mono_point_samples_built_in value: "
-                << builtIn.asString() << "!\n";
-            throw DisplayConfigurationParseException(
-                "Couldn't open external mono point file.");
-        }
-
-        Json::Reader reader;
-        if (!reader.parse(builtInString, builtInData)) {
-            std::cerr << "OSVRDisplayConfiguration::parse(): ERROR: Couldn't "
-                         "parse built-in configuration "
-                      << builtIn.asString() << "!\n";
-            std::cerr << "Errors: " << reader.getFormattedErrorMessages();
-            throw DisplayConfigurationParseException(
-                "Couldn't parse external mono point file.");
-        }
-        myDistortion = builtInData["display"]["hmd"]["distortion"];
-    }
-
     // See if we have the name of an external file to parse.  If so, we open it
     // and grab its values to parse, replacing the ones that they sent
-    // in.
+    // in.  The file can either be in the binary point-mesh format (which
+    // we decode directly) or be a Json display descriptor.  An external
+    // file overrides a built-in mesh.
     const Json::Value externalFile =
         distortion["mono_point_samples_external_file"];
+    const Json::Value builtIn = distortion["mono_point_samples_built_in"];
     if ((!externalFile.isNull()) && (externalFile.isString())) {
-        // Read a Json value from the external file, then replace the distortion
-        // mesh with that from the file.
-        Json::Value externalData;
-        Json::Reader reader;
-        std::ifstream fs;
-        fs.open(externalFile.asString().c_str(), std::fstream::in);
-        if (!fs.is_open()) {
+        std::vector<char> data;
+        if (!osvr::renderkit::loadPointMeshBinaryFile(externalFile.asString(),
+                                                      data)) {
             std::cerr << "OSVRDisplayConfiguration::parse(): ERROR: Couldn't "
                          "open file "
                       << externalFile.asString() << "!\n";
             throw DisplayConfigurationParseException(
                 "Couldn't open external mono point file.");
         }
-        if (!reader.parse(fs, externalData)) {
+        if (osvr::renderkit::isPointMeshBinary(data.data(), data.size())) {
+            if (!osvr::renderkit::parseMonoPointMeshBinary(
+                    data.data(), data.size(), mesh)) {
+                std::cerr << "OSVRDisplayConfiguration::parse(): ERROR: "
+                             "Couldn't parse binary file "
+                          << externalFile.asString() << "!\n";
+                throw DisplayConfigurationParseException(
+                    "Couldn't parse external mono point file.");
+            }
+            return;
+        }
+
+        // Read a Json value from the external file, then replace the distortion
+        // mesh with that from the file.
+        Json::Value externalData;
+        Json::Reader reader;
+        if (!reader.parse(data.data(), data.data() + data.size(),
+                          externalData)) {
             std::cerr << "OSVRDisplayConfiguration::parse(): ERROR: Couldn't "
                          "parse file "
                       << externalFile.asString() << "!\n";
@@ -113,7 +98,28 @@ inline void parseDistortionMonoPointMeshes(
                 "Couldn't parse external mono point file.");
         }
         myDistortion = externalData["display"]["hmd"]["distortion"];
-        fs.close();
+    } else if ((!builtIn.isNull()) && (builtIn.isString())) {
+        // Built-in meshes are stored in the binary point-mesh format, so we
+        // decode them directly rather than going through the Json parser.
+        if (builtIn.asString() == "OSVR_HDK_13_V1") {
+            if (!osvr::renderkit::parseMonoPointMeshBinary(
+                    reinterpret_cast<const char*>(
+                        osvr_display_config_built_in_osvr_hdk13_v1),
+                    sizeof(osvr_display_config_built_in_osvr_hdk13_v1),
+                    mesh)) {
+                std::cerr << "OSVRDisplayConfiguration::parse(): ERROR: "
+                             "Couldn't parse built-in configuration "
+                          << builtIn.asString() << "!\n";
+                throw DisplayConfigurationParseException(
+                    "Couldn't parse built-in mono point mesh.");
+            }
+            return;
+        }
+        std::cerr << "OSVRDisplayConfiguration::parse(): ERROR: Unrecognized "
+                     "mono_point_samples_built_in value: "
+                  << builtIn.asString() << "!\n";
+        throw DisplayConfigurationParseException(
+            "Couldn't open external mono point file.");
     }
 
     const Json::Value eyeArray = myDistortion["mono_point_samples"];
@@ -172,20 +178,33 @@ inline void parseDistortionRGBPointMeshes(
     const Json::Value externalFile =
         distortion["rgb_point_samples_external_file"];
     if ((!externalFile.isNull()) && (externalFile.isString())) {
-        // Read a Json value from the external file, then replace the distortion
-        // mesh with that from the file.
-        Json::Value externalData;
-        Json::Reader reader;
-        std::ifstream fs;
-        fs.open(externalFile.asString().c_str(), std::fstream::in);
-        if (!fs.is_open()) {
+        std::vector<char> data;
+        if (!osvr::renderkit::loadPointMeshBinaryFile(externalFile.asString(),
+                                                      data)) {
             std::cerr << "OSVRDisplayConfiguration::parse(): ERROR: Couldn't "
                          "open file "
                       << externalFile.asString() << "!\n";
             throw DisplayConfigurationParseException(
                 "Couldn't open external rgb point file.");
         }
-        if (!reader.parse(fs, externalData)) {
+        if (osvr::renderkit::isPointMeshBinary(data.data(), data.size())) {
+            if (!osvr::renderkit::parseRGBPointMeshBinary(
+                    data.data(), data.size(), mesh)) {
+                std::cerr << "OSVRDisplayConfiguration::parse(): ERROR: "
+                             "Couldn't parse binary file "
+                          << externalFile.asString() << "!\n";
+                throw DisplayConfigurationParseException(
+                    "Couldn't parse external rgb point file.");
+            }
+            return;
+        }
+
+        // Read a Json value from the external file, then replace the distortion
+        // mesh with that from the file.
+        Json::Value externalData;
+        Json::Reader reader;
+        if (!reader.parse(data.data(), data.data() + data.size(),
+                          externalData)) {
             std::cerr << "OSVRDisplayConfiguration::parse(): ERROR: Couldn't "
                          "parse file "
                       << externalFile.asString() << "!\n";
@@ -194,7 +213,6 @@ inline void parseDistortionRGBPointMeshes(
                 "Couldn't parse external rgb point file.");
         }
         myDistortion = externalData["display"]["hmd"]["distortion"];
-        fs.close();
     }
 
     std::array<std::string, 3> names = {
@@ -0,0 +1,263 @@
+/** @file
+    @brief Test that the OpenGL renderer's analytic distortion method draws
+           the same image as its distortion mesh: the same pattern is
+           presented through each and the two images read back from the
+           window are compared pixel by pixel.  Exits with SKIP_RETURN_CODE
+           when no OpenGL window can be opened, as on headless build
+           machines.
+
+    @date 2016
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com/osvr>
+*/
+
+// Copyright 2016 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include <osvr/RenderKit/RenderManager.h>
+#include <osvr/RenderKit/RenderManagerOpenGL.h>
+#include <osvr/RenderKit/GraphicsLibraryOpenGL.h>
+#include <osvr/RenderKit/PoseSource.h>
+
+// Library/third-party includes
+// - none
+
+// Standard includes
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace osvr::renderkit;
+
+/// What ctest takes as a skipped test (see SKIP_RETURN_CODE).
+static const int skipReturnCode = 77;
+
+static const double pi = 3.14159265358979323846;
+
+// A 1920x1080 side-by-side HMD with polynomial distortion, which is what
+// the analytic method handles.
+static const char* polynomialDisplay = R"({
+  "hmd": {
+    "device": { "vendor": "OSVR", "model": "HDK", "Version": "1.3" },
+    "field_of_view": {
+      "monocular_horizontal": 90, "monocular_vertical": 101.25,
+      "overlap_percent": 100, "pitch_tilt": 0
+    },
+    "resolutions": [ {
+      "width": 1920, "height": 1080, "video_inputs": 1,
+      "display_mode": "horz_side_by_side", "swap_eyes": 0
+    } ],
+    "distortion": {
+      "distance_scale_x": 1, "distance_scale_y": 1,
+      "polynomial_coeffs_red": [ 0, 1, -1.74, 5.15, -1.27, -2.23 ],
+      "polynomial_coeffs_green": [ 0, 1, -1.40, 4.10, -0.90, -1.90 ],
+      "polynomial_coeffs_blue": [ 0, 1, -1.00, 3.00, -0.50, -1.50 ]
+    },
+    "rendering": { "right_roll": 0, "left_roll": 0 },
+    "eyes": [
+      { "center_proj_x": 0.5, "center_proj_y": 0.5, "rotate_180": 0 },
+      { "center_proj_x": 0.5, "center_proj_y": 0.5, "rotate_180": 0 }
+    ]
+  }
+})";
+
+/// Largest difference in any channel that counts as the same color.  The
+/// mesh is only exact at its vertices, so the two can be a little apart
+/// in between.
+static const int sameColorTolerance = 8;
+
+/// Fraction of pixels that may differ by more than sameColorTolerance,
+/// such as along the rim of each eye, where the mesh and the exact
+/// distortion cross the edge of the rendered image at slightly different
+/// places.
+static const double maxDifferentFraction = 0.005;
+
+/// Largest mean difference over all pixels and channels.
+static const double maxMeanDifference = 0.5;
+
+/// @brief OpenGL RenderManager that keeps a copy of each display's image
+/// as it was drawn, before it is swapped to the screen.
+class ReadbackRenderManager : public RenderManagerOpenGL {
+  public:
+    ReadbackRenderManager(ConstructorParameters p)
+        : RenderManagerOpenGL(nullptr, p) {}
+
+    bool usingAnalyticDistortion() const { return m_analyticDistortion; }
+
+    std::vector<uint8_t> m_image; //< RGBA, bottom line first
+
+  protected:
+    bool PresentDisplayFinalize(size_t display) override {
+        m_image.assign(static_cast<size_t>(m_displayWidth) *
+                           static_cast<size_t>(m_displayHeight) * 4,
+                       0);
+        glReadBuffer(GL_BACK);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, m_displayWidth, m_displayHeight, GL_RGBA,
+                     GL_UNSIGNED_BYTE, m_image.data());
+        return RenderManagerOpenGL::PresentDisplayFinalize(display);
+    }
+};
+
+/// Makes a pose source for a head that does not move.
+static std::shared_ptr<ScriptedPoseSource> makePoseSource() {
+    std::shared_ptr<ScriptedPoseSource> source(new ScriptedPoseSource);
+    OSVR_PoseState pose;
+    pose.translation.data[0] = 0;
+    pose.translation.data[1] = 1.7;
+    pose.translation.data[2] = 0;
+    osvrQuatSetIdentity(&pose.rotation);
+    OSVR_TimeValue time = {1, 0};
+    source->AddPose("/me/head", time, pose);
+    source->SetTime(time);
+    source->Update();
+    return source;
+}
+
+/// Fills in the constructor parameters the way createRenderManager() does
+/// for the polynomial display, with the given distortion method.
+static RenderManager::ConstructorParameters makeParameters(
+    RenderManager::ConstructorParameters::Distortion_Method method) {
+    RenderManager::ConstructorParameters p;
+    p.m_renderLibrary = "OpenGL";
+    p.m_poseSource = makePoseSource();
+    p.m_displayConfiguration = OSVRDisplayConfiguration(polynomialDisplay);
+    p.m_distortionCorrection = true;
+    p.m_distortionMethod = method;
+    p.m_windowTitle = "AnalyticDistortionTest";
+    const OSVRDisplayConfiguration& d = p.m_displayConfiguration;
+    RenderManager::DistortionParameters distortion;
+    distortion.m_desiredTriangles = 200 * 64;
+    distortion.m_distortionD = {d.getDistortionDistanceScaleX(),
+                                d.getDistortionDistanceScaleY()};
+    distortion.m_distortionPolynomialRed = d.getDistortionPolynomalRed();
+    distortion.m_distortionPolynomialGreen = d.getDistortionPolynomalGreen();
+    distortion.m_distortionPolynomialBlue = d.getDistortionPolynomalBlue();
+    for (size_t i = 0; i < d.getEyes().size(); i++) {
+        distortion.m_distortionCOP = {
+            static_cast<float>(d.getEyes()[i].m_CenterProjX),
+            static_cast<float>(d.getEyes()[i].m_CenterProjY)};
+        p.m_distortionParameters.push_back(distortion);
+    }
+    return p;
+}
+
+/// Presents one frame of a smooth pattern with the given distortion
+/// method and returns the image that was drawn, or an empty image if no
+/// window could be opened.  Sets failed if something else went wrong.
+static std::vector<uint8_t> presentPattern(
+    RenderManager::ConstructorParameters::Distortion_Method method,
+    bool& failed) {
+    ReadbackRenderManager render(makeParameters(method));
+    if (render.OpenDisplay().status == RenderManager::OpenStatus::FAILURE) {
+        return std::vector<uint8_t>();
+    }
+    bool analytic = method ==
+                    RenderManager::ConstructorParameters::AnalyticDistortion;
+    if (render.usingAnalyticDistortion() != analytic) {
+        std::cerr << "The analytic distortion method is "
+                  << (analytic ? "not " : "") << "in use" << std::endl;
+        failed = true;
+        return std::vector<uint8_t>();
+    }
+
+    // Ramps in red and green, and waves in blue, so that each part of the
+    // image has its own color and a misplaced pixel changes it smoothly.
+    std::vector<RenderInfo> renderInfo = render.GetRenderInfo();
+    std::vector<GLuint> textures(renderInfo.size());
+    std::vector<RenderBufferOpenGL> names(renderInfo.size());
+    std::vector<RenderBuffer> buffers(renderInfo.size());
+    glGenTextures(static_cast<GLsizei>(textures.size()), textures.data());
+    for (size_t eye = 0; eye < renderInfo.size(); eye++) {
+        size_t width = static_cast<size_t>(renderInfo[eye].viewport.width);
+        size_t height = static_cast<size_t>(renderInfo[eye].viewport.height);
+        std::vector<uint8_t> pattern(width * height * 4);
+        for (size_t y = 0; y < height; y++) {
+            for (size_t x = 0; x < width; x++) {
+                uint8_t* pixel = &pattern[(y * width + x) * 4];
+                pixel[0] = static_cast<uint8_t>(255 * x / (width - 1));
+                pixel[1] = static_cast<uint8_t>(255 * y / (height - 1));
+                pixel[2] = static_cast<uint8_t>(
+                    127.5 + 127.5 * std::sin(2 * pi * (x + y) / 60.0));
+                pixel[3] = 255;
+            }
+        }
+        glBindTexture(GL_TEXTURE_2D, textures[eye]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8,
+                     static_cast<GLsizei>(width), static_cast<GLsizei>(height),
+                     0, GL_RGBA, GL_UNSIGNED_BYTE, pattern.data());
+        names[eye].colorBufferName = textures[eye];
+        names[eye].depthStencilBufferName = 0;
+        buffers[eye].OpenGL = &names[eye];
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (!render.RegisterRenderBuffers(buffers) ||
+        !render.PresentRenderBuffers(buffers, renderInfo)) {
+        std::cerr << "Could not present the pattern" << std::endl;
+        failed = true;
+    }
+    glDeleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
+    return render.m_image;
+}
+
+int main() {
+    bool failed = false;
+    std::vector<uint8_t> mesh = presentPattern(
+        RenderManager::ConstructorParameters::MeshDistortion, failed);
+    if (mesh.empty() && !failed) {
+        std::cout << "Could not open an OpenGL window, skipping" << std::endl;
+        return skipReturnCode;
+    }
+    std::vector<uint8_t> analytic = presentPattern(
+        RenderManager::ConstructorParameters::AnalyticDistortion, failed);
+    if (failed || analytic.size() != mesh.size()) {
+        return EXIT_FAILURE;
+    }
+
+    size_t different = 0;
+    double totalDifference = 0;
+    size_t pixels = mesh.size() / 4;
+    for (size_t i = 0; i < pixels; i++) {
+        int worst = 0;
+        for (size_t c = 0; c < 3; c++) {
+            int diff = std::abs(static_cast<int>(mesh[i * 4 + c]) -
+                                static_cast<int>(analytic[i * 4 + c]));
+            worst = std::max(worst, diff);
+            totalDifference += diff;
+        }
+        if (worst > sameColorTolerance) {
+            different++;
+        }
+    }
+    double differentFraction = static_cast<double>(different) / pixels;
+    double meanDifference = totalDifference / (pixels * 3);
+    std::cout << "Mean difference " << meanDifference << ", "
+              << differentFraction * 100 << "% of pixels differ by more than "
+              << sameColorTolerance << std::endl;
+    if (differentFraction > maxDifferentFraction ||
+        meanDifference > maxMeanDifference) {
+        std::cerr << "The analytic and mesh distortion images differ"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,326 @@
+/** @file
+    @brief Tests of the pose prediction module: the closed-form constant
+           velocity prediction against the loop-and-slerp prediction it
+           replaced, the degenerate inputs that skip angular prediction,
+           negative intervals, constant acceleration and the alpha-beta
+           predictor.
+
+    @date 2016
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com/osvr>
+*/
+
+// Copyright 2016 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include "PosePrediction.h"
+
+// Library/third-party includes
+#include <osvr/Util/QuaternionC.h>
+#include <osvr/Util/QuatlibInteropC.h>
+#include <quat.h>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+// Standard includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+using namespace osvr::renderkit;
+
+static int s_failures = 0;
+
+/// Report a failed check, with the values involved, and keep going.
+#define CHECK_NEAR(actual, expected, tolerance, what)                          \
+    do {                                                                       \
+        double a_ = (actual);                                                  \
+        double e_ = (expected);                                                \
+        if (!(std::abs(a_ - e_) <= (tolerance))) {                             \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": " << what           \
+                      << ": got " << a_ << ", expected " << e_ << std::endl;   \
+            s_failures++;                                                      \
+        }                                                                      \
+    } while (0)
+
+static Eigen::Quaterniond toEigen(OSVR_Quaternion const& q) {
+    return Eigen::Quaterniond(osvrQuatGetW(&q), osvrQuatGetX(&q),
+                              osvrQuatGetY(&q), osvrQuatGetZ(&q));
+}
+
+static OSVR_Quaternion fromEigen(Eigen::Quaterniond const& in) {
+    OSVR_Quaternion q;
+    osvrQuatSetW(&q, in.w());
+    osvrQuatSetX(&q, in.x());
+    osvrQuatSetY(&q, in.y());
+    osvrQuatSetZ(&q, in.z());
+    return q;
+}
+
+/// Angle in radians between two orientations.
+static double angleBetween(OSVR_Quaternion const& a, OSVR_Quaternion const& b) {
+    return toEigen(a).angularDistance(toEigen(b));
+}
+
+static OSVR_PoseState makePose(Eigen::Quaterniond const& rotation,
+                               Eigen::Vector3d const& translation) {
+    OSVR_PoseState pose;
+    pose.rotation = fromEigen(rotation);
+    for (int i = 0; i < 3; i++) {
+        pose.translation.data[i] = translation[i];
+    }
+    return pose;
+}
+
+/// Velocity of rate radians per second about axis and the given linear
+/// velocity, reported as the rotation over dt.
+static OSVR_VelocityState makeVelocity(Eigen::Vector3d const& axis,
+                                       double rate, double dt,
+                                       Eigen::Vector3d const& linear) {
+    OSVR_VelocityState vel;
+    vel.angularVelocityValid = true;
+    vel.angularVelocity.dt = dt;
+    vel.angularVelocity.incrementalRotation =
+        fromEigen(Eigen::Quaterniond(Eigen::AngleAxisd(rate * dt, axis)));
+    vel.linearVelocityValid = true;
+    for (int i = 0; i < 3; i++) {
+        vel.linearVelocity.data[i] = linear[i];
+    }
+    return vel;
+}
+
+/// The prediction RenderManager::PredictFuturePose() used before the
+/// PosePrediction module: apply the incremental rotation once for every
+/// whole dt in the interval and slerp the rest.
+static void loopAndSlerpPredict(OSVR_PoseState const& poseIn,
+                                OSVR_VelocityState const& vel,
+                                double predictionIntervalSec,
+                                OSVR_PoseState& poseOut) {
+    OSVR_PoseState out = poseIn;
+    if (vel.angularVelocityValid) {
+        q_type newOrientation;
+        osvrQuatToQuatlib(newOrientation, &poseIn.rotation);
+        q_type rotationAmount;
+        osvrQuatToQuatlib(rotationAmount,
+                          &vel.angularVelocity.incrementalRotation);
+        double remaining = predictionIntervalSec;
+        while (remaining > vel.angularVelocity.dt) {
+            q_mult(newOrientation, rotationAmount, newOrientation);
+            remaining -= vel.angularVelocity.dt;
+        }
+        double fractionTime = remaining / vel.angularVelocity.dt;
+        q_type identity = {0, 0, 0, 1};
+        q_type fractionRotation;
+        q_slerp(fractionRotation, identity, rotationAmount, fractionTime);
+        q_mult(newOrientation, fractionRotation, newOrientation);
+        osvrQuatFromQuatlib(&out.rotation, newOrientation);
+    }
+    if (vel.linearVelocityValid) {
+        for (int i = 0; i < 3; i++) {
+            out.translation.data[i] +=
+                vel.linearVelocity.data[i] * predictionIntervalSec;
+        }
+    }
+    poseOut = out;
+}
+
+static void testMatchesLoopAndSlerp() {
+    const double dts[] = {1e-4, 1e-3, 1.0 / 90, 1.0 / 60};
+    const double rates[] = {0, 0.5, 3, 10};
+    const double intervals[] = {0, 0.004, 0.0137, 0.05, 0.1};
+    Eigen::Vector3d axis = Eigen::Vector3d(1, 2, -3).normalized();
+    Eigen::Quaterniond start(Eigen::AngleAxisd(0.7, Eigen::Vector3d::UnitY()));
+    OSVR_PoseState pose = makePose(start, Eigen::Vector3d(0.1, 1.7, -0.2));
+    for (double dt : dts) {
+        for (double rate : rates) {
+            OSVR_VelocityState vel =
+                makeVelocity(axis, rate, dt, Eigen::Vector3d(0.3, 0, -0.1));
+            for (double t : intervals) {
+                OSVR_PoseState expected, actual;
+                loopAndSlerpPredict(pose, vel, t, expected);
+                predictPose(pose, vel, t, actual);
+                CHECK_NEAR(angleBetween(actual.rotation, expected.rotation), 0,
+                           1e-9, "rotation vs. loop-and-slerp, dt "
+                                     << dt << " rate " << rate << " t " << t);
+                for (int i = 0; i < 3; i++) {
+                    CHECK_NEAR(actual.translation.data[i],
+                               expected.translation.data[i], 1e-12,
+                               "translation vs. loop-and-slerp");
+                }
+            }
+        }
+    }
+}
+
+static void testDegenerateAngularVelocity() {
+    Eigen::Quaterniond start(Eigen::AngleAxisd(0.4, Eigen::Vector3d::UnitX()));
+    OSVR_PoseState pose = makePose(start, Eigen::Vector3d::Zero());
+    Eigen::Vector3d axis = Eigen::Vector3d::UnitY();
+
+    // A zero or negative dt must skip angular prediction (the old loop
+    // never finished for a zero dt).
+    const double badDts[] = {0, -0.01};
+    for (double dt : badDts) {
+        OSVR_VelocityState vel =
+            makeVelocity(axis, 2, 0.01, Eigen::Vector3d::Zero());
+        vel.angularVelocity.dt = dt;
+        OSVR_PoseState out;
+        predictPose(pose, vel, 0.05, out);
+        CHECK_NEAR(angleBetween(out.rotation, pose.rotation), 0, 1e-15,
+                   "rotation with dt " << dt);
+        AngularRate rate;
+        CHECK_NEAR(angularRateFromIncrementalRotation(vel.angularVelocity,
+                                                      rate),
+                   false, 0, "rate reported valid for dt " << dt);
+    }
+
+    // So must an incremental rotation that is not a rotation at all.
+    OSVR_VelocityState vel =
+        makeVelocity(axis, 2, 0.01, Eigen::Vector3d::Zero());
+    osvrQuatSetIdentity(&vel.angularVelocity.incrementalRotation);
+    osvrQuatSetW(&vel.angularVelocity.incrementalRotation, 0);
+    OSVR_PoseState out;
+    predictPose(pose, vel, 0.05, out);
+    CHECK_NEAR(angleBetween(out.rotation, pose.rotation), 0, 1e-15,
+               "rotation with a zero quaternion");
+    AngularRate rate;
+    CHECK_NEAR(angularRateFromIncrementalRotation(vel.angularVelocity, rate),
+               false, 0, "rate reported valid for a zero quaternion");
+}
+
+static void testNegativeInterval() {
+    Eigen::Vector3d axis = Eigen::Vector3d(0.2, 1, 0.1).normalized();
+    Eigen::Quaterniond start(Eigen::AngleAxisd(1.1, Eigen::Vector3d::UnitZ()));
+    OSVR_PoseState pose = makePose(start, Eigen::Vector3d(0, 1.5, 0));
+    OSVR_VelocityState vel =
+        makeVelocity(axis, 4, 1.0 / 90, Eigen::Vector3d(0.5, 0, 0));
+    const double t = 0.03;
+
+    // Going back by t rotates by the inverse of going forward by t.
+    OSVR_PoseState back;
+    predictPose(pose, vel, -t, back);
+    Eigen::Quaterniond expected =
+        Eigen::Quaterniond(Eigen::AngleAxisd(-4 * t, axis)) * start;
+    CHECK_NEAR(angleBetween(back.rotation, fromEigen(expected)), 0, 1e-12,
+               "rotation for a negative interval");
+    CHECK_NEAR(back.translation.data[0], -0.5 * t, 1e-12,
+               "translation for a negative interval");
+
+    // And going forward again gets back to where we started.
+    OSVR_PoseState there;
+    predictPose(back, vel, t, there);
+    CHECK_NEAR(angleBetween(there.rotation, pose.rotation), 0, 1e-12,
+               "rotation after going back and forward");
+}
+
+static void testConstantAcceleration() {
+    // Spinning up about a fixed axis, the angle is w t + a t^2 / 2.
+    Eigen::Vector3d axis = Eigen::Vector3d::UnitY();
+    const double w = 1.5, alpha = 6, dt = 0.01, t = 0.05;
+    OSVR_PoseState pose =
+        makePose(Eigen::Quaterniond::Identity(), Eigen::Vector3d::Zero());
+    OSVR_VelocityState vel = makeVelocity(axis, w, dt, Eigen::Vector3d::Zero());
+    OSVR_AccelerationState accel;
+    accel.angularAccelerationValid = true;
+    accel.angularAcceleration.dt = dt;
+    accel.angularAcceleration.incrementalRotation = fromEigen(
+        Eigen::Quaterniond(Eigen::AngleAxisd(alpha * dt * dt, axis)));
+    accel.linearAccelerationValid = true;
+    accel.linearAcceleration.data[0] = 2;
+    accel.linearAcceleration.data[1] = 0;
+    accel.linearAcceleration.data[2] = 0;
+    OSVR_PoseState out;
+    predictPose(pose, vel, accel, t, out);
+    Eigen::Quaterniond expected(
+        Eigen::AngleAxisd(w * t + 0.5 * alpha * t * t, axis));
+    CHECK_NEAR(angleBetween(out.rotation, fromEigen(expected)), 0, 1e-12,
+               "rotation with constant angular acceleration");
+    CHECK_NEAR(out.translation.data[0], 0.5 * 2 * t * t, 1e-12,
+               "translation with constant linear acceleration");
+}
+
+static OSVR_TimeValue timeAt(double seconds) {
+    OSVR_TimeValue time;
+    time.seconds = static_cast<OSVR_TimeValue_Seconds>(std::floor(seconds));
+    time.microseconds = static_cast<OSVR_TimeValue_Microseconds>(
+        std::round((seconds - std::floor(seconds)) * 1e6));
+    return time;
+}
+
+static void testAlphaBeta() {
+    // Reports at 90 Hz of a head turning at a constant rate and moving at
+    // a constant velocity, with no velocity reported.
+    Eigen::Vector3d axis = Eigen::Vector3d(0, 1, 0.3).normalized();
+    const double rate = 2.0;
+    Eigen::Vector3d velocity(0.2, 0, -0.1);
+    auto truth = [&](double t) {
+        return makePose(Eigen::Quaterniond(Eigen::AngleAxisd(rate * t, axis)),
+                        Eigen::Vector3d(0, 1.7, 0) + velocity * t);
+    };
+    OSVR_VelocityState noVel = {};
+    OSVR_AccelerationState noAccel = {};
+    AlphaBetaPredictor predictor(0.5, 0.1);
+
+    OSVR_PoseState out;
+    CHECK_NEAR(predictor.Predict(0.01, out), false, 0,
+               "prediction before any report");
+
+    const double period = 1.0 / 90;
+    double t = 0;
+    for (int i = 0; i < 300; i++) {
+        t = 1 + i * period;
+        predictor.AddReport(timeAt(t), truth(t), noVel, noAccel);
+        // Repeats of the same report must not disturb the filter.
+        predictor.AddReport(timeAt(t), truth(t), noVel, noAccel);
+    }
+    const double ahead = 0.05;
+    CHECK_NEAR(predictor.Predict(ahead, out), true, 0,
+               "prediction after reports");
+    CHECK_NEAR(angleBetween(out.rotation, truth(t + ahead).rotation), 0, 1e-4,
+               "alpha-beta rotation converged to a constant rate");
+    for (int i = 0; i < 3; i++) {
+        CHECK_NEAR(out.translation.data[i],
+                   truth(t + ahead).translation.data[i], 1e-5,
+                   "alpha-beta translation converged to a constant velocity");
+    }
+
+    // After a gap longer than maxGapSec, the filter starts over at rest
+    // from the next report.
+    t += 0.5;
+    predictor.AddReport(timeAt(t), truth(t), noVel, noAccel);
+    predictor.Predict(ahead, out);
+    CHECK_NEAR(angleBetween(out.rotation, truth(t).rotation), 0, 1e-12,
+               "alpha-beta rotation after a gap");
+    for (int i = 0; i < 3; i++) {
+        CHECK_NEAR(out.translation.data[i], truth(t).translation.data[i],
+                   1e-12, "alpha-beta translation after a gap");
+    }
+}
+
+int main() {
+    testMatchesLoopAndSlerp();
+    testDegenerateAngularVelocity();
+    testNegativeInterval();
+    testConstantAcceleration();
+    testAlphaBeta();
+    if (s_failures > 0) {
+        std::cerr << s_failures << " checks failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "All pose prediction checks passed" << std::endl;
+    return EXIT_SUCCESS;
+}
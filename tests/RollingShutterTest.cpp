@@ -0,0 +1,222 @@
+/** @file
+    @brief Test of rolling-shutter time warp in the Software renderer: a
+           vertical stripe rendered while the head turns at a constant rate
+           must be moved by the turn up to when each line is scanned out,
+           so it leans across the eye.
+
+    @date 2016
+
+    @author
+    Sensics, Inc.
+    <http://sensics.com/osvr>
+*/
+
+// Copyright 2016 Sensics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Internal Includes
+#include <osvr/RenderKit/RenderManager.h>
+#include <osvr/RenderKit/RenderManagerSoftware.h>
+#include <osvr/RenderKit/PoseSource.h>
+
+// Library/third-party includes
+// - none
+
+// Standard includes
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace osvr::renderkit;
+
+// A 400x400 pixel, 90 by 90 degree eye on each half of an 800x400 display,
+// with no distortion.
+static const char* display = R"({
+  "hmd": {
+    "device": { "vendor": "OSVR", "model": "Test", "Version": "1" },
+    "field_of_view": {
+      "monocular_horizontal": 90, "monocular_vertical": 90,
+      "overlap_percent": 100, "pitch_tilt": 0
+    },
+    "resolutions": [ {
+      "width": 800, "height": 400, "video_inputs": 1,
+      "display_mode": "horz_side_by_side", "swap_eyes": 0
+    } ],
+    "rendering": { "right_roll": 0, "left_roll": 0 },
+    "eyes": [
+      { "center_proj_x": 0.5, "center_proj_y": 0.5, "rotate_180": 0 },
+      { "center_proj_x": 0.5, "center_proj_y": 0.5, "rotate_180": 0 }
+    ]
+  }
+})";
+
+static const double yawRate = 4.0; //< Radians per second, to the left
+static const double renderToPresent = 0.005; //< Seconds from GetRenderInfo
+static const double scanOutMS = 10.0; //< Top to bottom line of the display
+
+/// Half the width of the stripe, in render-buffer pixels.
+static const int stripeHalfWidth = 4;
+
+/// @brief Software RenderManager made directly from constructor parameters.
+class TestRenderManager : public RenderManagerSoftware {
+  public:
+    TestRenderManager(ConstructorParameters p)
+        : RenderManagerSoftware(nullptr, p) {}
+};
+
+/// Makes an orientation that is yawed by the specified angle.
+static OSVR_Quaternion yaw(double radians) {
+    OSVR_Quaternion q;
+    osvrQuatSetW(&q, std::cos(radians / 2));
+    osvrQuatSetX(&q, 0);
+    osvrQuatSetY(&q, std::sin(radians / 2));
+    osvrQuatSetZ(&q, 0);
+    return q;
+}
+
+/// Builds a pose source holding two seconds of a head turning at yawRate,
+/// reported at 1 kHz, with the clock set to the middle of it.
+static std::shared_ptr<ScriptedPoseSource> makePoseSource() {
+    std::shared_ptr<ScriptedPoseSource> source(new ScriptedPoseSource);
+    for (int i = 0; i < 2000; i++) {
+        OSVR_TimeValue time;
+        time.seconds = static_cast<OSVR_TimeValue_Seconds>(i / 1000);
+        time.microseconds =
+            static_cast<OSVR_TimeValue_Microseconds>((i % 1000) * 1000);
+        OSVR_PoseState pose;
+        pose.translation.data[0] = 0;
+        pose.translation.data[1] = 1.7;
+        pose.translation.data[2] = 0;
+        pose.rotation = yaw(yawRate * i / 1000.0);
+        source->AddPose("/me/head", time, pose);
+    }
+    OSVR_TimeValue now = {1, 0};
+    source->SetTime(now);
+    source->Update();
+    return source;
+}
+
+/// Finds the horizontal center of the red in one row of the left half of
+/// an image, in pixels from its left edge.  Returns -1 if it is empty.
+static double stripeCenter(RenderBufferSoftware const& image, size_t row,
+                           size_t width) {
+    double sum = 0;
+    double weighted = 0;
+    for (size_t x = 0; x < width; x++) {
+        double red = image.colorBuffer[(row * image.width + x) * 4];
+        sum += red;
+        weighted += red * (x + 0.5);
+    }
+    return sum > 0 ? weighted / sum : -1;
+}
+
+int main() {
+    std::shared_ptr<ScriptedPoseSource> source = makePoseSource();
+    RenderManager::ConstructorParameters p;
+    p.m_renderLibrary = "Software";
+    p.m_poseSource = source;
+    p.m_displayConfiguration = OSVRDisplayConfiguration(display);
+    p.m_distortionCorrection = false;
+    p.m_distortionParameters.resize(2);
+    for (auto& distort : p.m_distortionParameters) {
+        distort.m_desiredTriangles = 2 * 32 * 32;
+    }
+    p.m_enableTimeWarp = true;
+    p.m_clientPredictionEnabled = true;
+    p.m_eyeDelaysMS = {0.0f, 0.0f};
+    p.m_rollingShutterTimeWarp = true;
+    p.m_scanOutMS = static_cast<float>(scanOutMS);
+    TestRenderManager render(p);
+    if (render.OpenDisplay().status == RenderManager::OpenStatus::FAILURE) {
+        std::cerr << "Could not open the display" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Render a red stripe down the middle of each eye.
+    std::vector<RenderInfo> renderInfo = render.GetRenderInfo();
+    if (renderInfo.size() != 2) {
+        std::cerr << "Got " << renderInfo.size() << " RenderInfos, expected 2"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::vector<RenderBufferSoftware> images(renderInfo.size());
+    std::vector<RenderBuffer> buffers(renderInfo.size());
+    for (size_t eye = 0; eye < renderInfo.size(); eye++) {
+        RenderBufferSoftware& image = images[eye];
+        image.width = static_cast<size_t>(renderInfo[eye].viewport.width);
+        image.height = static_cast<size_t>(renderInfo[eye].viewport.height);
+        image.colorBuffer.assign(image.width * image.height * 4, 0);
+        int center = static_cast<int>(image.width / 2);
+        for (size_t y = 0; y < image.height; y++) {
+            for (int x = center - stripeHalfWidth;
+                 x < center + stripeHalfWidth; x++) {
+                uint8_t* pixel =
+                    &image.colorBuffer[(y * image.width + x) * 4];
+                pixel[0] = 255;
+                pixel[3] = 255;
+            }
+        }
+        buffers[eye].Software = &image;
+    }
+    if (!render.RegisterRenderBuffers(buffers)) {
+        std::cerr << "Could not register the buffers" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // The head keeps turning while the frame is rendered, then presented.
+    // The top line is seen renderToPresent after the frame was rendered
+    // and the bottom line scanOutMS after that.
+    source->AdvanceTime(renderToPresent);
+    if (!render.PresentRenderBuffers(buffers, renderInfo)) {
+        std::cerr << "Could not present the buffers" << std::endl;
+        return EXIT_FAILURE;
+    }
+    RenderBufferSoftware presented;
+    if (!render.GetPresentedImage(0, presented)) {
+        std::cerr << "Could not get the presented image" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Turning left moves the scene to the right by the tangent of the
+    // angle turned, as the projection maps tangents to pixels.  Compare
+    // lines near the top, at the middle and near the bottom of the left
+    // eye; the image is stored bottom line first.
+    OSVR_ProjectionMatrix const& projection = renderInfo[0].projection;
+    size_t eyeWidth = presented.width / 2;
+    double pixelsPerTangent = eyeWidth * projection.nearClip /
+                              (projection.right - projection.left);
+    double unmoved = eyeWidth * -projection.left /
+                     (projection.right - projection.left);
+    int failures = 0;
+    const double fractionsDown[] = {0.05, 0.5, 0.95};
+    for (double down : fractionsDown) {
+        size_t fromTop = static_cast<size_t>(down * presented.height);
+        double scanned = (fromTop + 0.5) / presented.height;
+        double angle = yawRate * (renderToPresent + scanned * scanOutMS / 1e3);
+        double expected = unmoved + std::tan(angle) * pixelsPerTangent;
+        double actual =
+            stripeCenter(presented, presented.height - 1 - fromTop, eyeWidth);
+        std::cout << "Line " << fromTop << ": stripe at " << actual
+                  << ", expected " << expected << std::endl;
+        if (!(std::abs(actual - expected) <= 0.5)) {
+            std::cerr << "Stripe in line " << fromTop << " is at " << actual
+                      << " pixels, expected " << expected << std::endl;
+            failures++;
+        }
+    }
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}